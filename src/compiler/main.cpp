@@ -1,5 +1,6 @@
 #include <cxxopts.hpp>
 
+#include <cstdio>
 #include <iostream>
 
 #include <flatmessage/compiler.hpp>
@@ -16,6 +17,12 @@ int main(int argc, char** argv)
         ("o,outputDirectory", "The directory where all of your compiled flatmessage files will be written to", cxxopts::value<std::string>())
         ("m,mergeOutputs", "Merges all outputs into one big file", cxxopts::value<bool>()->default_value("false"))
 		("d,includeDirectory", "A directory that imported files will be searched in", cxxopts::value<std::vector<boost::filesystem::path>>())
+        ("c,cacheDirectory", "A directory that caches generated files so that they can be reused across checkouts", cxxopts::value<std::string>()->default_value(""))
+        ("cacheMaxSize", "The size in MiB that the cache directory shouldn't exceed", cxxopts::value<std::uintmax_t>()->default_value("1024"))
+        ("cacheHardLinks", "Hard links cached files into the output directory instead of copying them", cxxopts::value<bool>()->default_value("false"))
+        ("b,batches", "Groups the outputs into this many unity files of roughly equal size that include them", cxxopts::value<int>()->default_value("0"))
+        ("layoutReport", "Prints the memory size and padding of every data and message", cxxopts::value<bool>()->default_value("false"))
+        ("shard", "Only generates the i-th of N shares of the outputs, given as i/N with 1 <= i <= N", cxxopts::value<std::string>()->default_value("1/1"))
         ;
     // clang-format on
 
@@ -37,13 +44,30 @@ int main(int argc, char** argv)
         auto outDir = result["o"].as<std::string>();
         auto merge = result["m"].as<bool>();
         auto include_directories = result["d"].as<std::vector<boost::filesystem::path>>();
+        auto cache_directory = result["c"].as<std::string>();
+        auto cache_max_size = result["cacheMaxSize"].as<std::uintmax_t>();
+        auto cache_hard_links = result["cacheHardLinks"].as<bool>();
+
+        auto batch_count = result["b"].as<int>();
+
+        int shard_index = 0, shard_count = 0;
+        auto shard = result["shard"].as<std::string>();
+        if (std::sscanf(shard.c_str(), "%d/%d", &shard_index, &shard_count) != 2)
+        {
+            std::cerr << "flatmessage_compiler:\nInvalid shard '" << shard << "'. Expected i/N\n";
+            return -1;
+        }
 
         if (extension.empty() || inputs.empty() || tmplate.empty() || outDir.empty())
             return -1;
 
         auto flags = merge ? flatmessage::compiler_flags::merge_translation_units : flatmessage::compiler_flags::none;
+        if (result["layoutReport"].as<bool>())
+            flags |= flatmessage::compiler_flags::layout_report;
         flatmessage::compiler compiler;
-        compiler.compile_files(inputs, {tmplate, 1, outDir, extension, flags, include_directories});
+        compiler.compile_files(inputs, {tmplate, 1, outDir, extension, flags, include_directories, cache_directory,
+                                        cache_max_size * 1024 * 1024, cache_hard_links, shard_index - 1, shard_count,
+                                        batch_count});
     }
     catch (std::exception& e)
     {
@@ -34,6 +34,7 @@ namespace flatmessage::ast
     };
     struct data;
     struct message;
+    struct tagged_union;
     struct attribute;
     struct enumeration;
     struct enum_value;
@@ -43,6 +44,7 @@ namespace flatmessage::ast
     {
         std::string name;
         boost::optional<annotation_value_t> value;
+        std::vector<annotation_value_t> arguments;
     };
 
     struct data : x3::position_tagged
@@ -59,6 +61,14 @@ namespace flatmessage::ast
         std::vector<attribute> attributes;
     };
 
+    // Holds exactly one of its attributes, the alternatives, or none of them
+    struct tagged_union : x3::position_tagged
+    {
+        std::vector<annotation> annotations;
+        std::string name;
+        std::vector<attribute> alternatives;
+    };
+
     using default_value_t = x3::variant<int, double, std::string>;
     struct attribute : x3::position_tagged
     {
@@ -99,7 +109,8 @@ namespace flatmessage::ast
         std::string name;
     };
 
-    using ast = std::vector<x3::variant<message, enumeration, data, module_decl, import_decl, protocol_decl>>;
+    using ast = std::vector<
+        x3::variant<message, enumeration, data, tagged_union, module_decl, import_decl, protocol_decl>>;
 
     // print functions for debugging
     inline std::ostream& operator<<(std::ostream& out, nil)
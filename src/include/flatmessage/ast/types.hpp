@@ -0,0 +1,337 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace flatmessage::ast
+{
+    // Describes one of the language's build-in types
+    struct builtin_type
+    {
+        // The name of the type
+        char const* name;
+        // The amount of bytes that a value of this type occupies on the wire or 0 if its size is variable
+        int size;
+        // Is it one of the integer types?
+        bool is_integer;
+        // Can it hold negative values?
+        bool is_signed;
+    };
+
+    // Returns the build-in type with the given name or nullptr if there is none
+    builtin_type const* find_builtin_type(std::string const& name);
+
+    // Returns the annotation with the given name or nullptr if there is none
+    annotation const* find_annotation(std::vector<annotation> const& annotations, std::string const& name);
+
+    // How an integer attribute is written to the wire
+    enum class integer_encoding
+    {
+        // The full width of the type
+        fixed,
+        // LEB128: 7 bits per byte, the highest bit marks that more bytes follow
+        varint,
+        // Maps signed values to unsigned ones so that small negative values stay small, then writes them as varint
+        zigzag,
+    };
+
+    // Returns the name of the given encoding as it is exposed to templates
+    char const* to_string(integer_encoding encoding);
+
+    // Returns the encoding of the given attribute of a message or data with the given container_annotations. An
+    // attribute's own 'fixed', 'varint' or 'zigzag' annotation wins over the container's. A 'varint' container encodes
+    // all of its integers as varint, a 'zigzag' container its signed integers as zigzag and its unsigned ones as
+    // varint. Sets out_error if the attribute's own annotations don't fit its type
+    integer_encoding get_integer_encoding(attribute const& attribute,
+                                          std::vector<annotation> const& container_annotations,
+                                          std::string& out_error);
+
+    // How a quantized float attribute is stored
+    enum class quantization_kind
+    {
+        // [quantize(min, max, bits)]: the value is clamped to [min, max] and mapped to an unsigned integer of bits bits
+        range,
+        // [fixed=step]: the value is rounded to a multiple of step and that multiple is written as zigzag varint
+        fixed_point,
+    };
+
+    // Describes how a float attribute is quantized before it is written to the wire
+    struct quantization
+    {
+        quantization_kind kind = quantization_kind::range;
+        double min = 0;
+        double max = 0;
+        int bits = 0;
+        // The distance between two representable values
+        double step = 0;
+    };
+
+    // Returns the name of the given kind of quantization as it is exposed to templates
+    char const* to_string(quantization_kind kind);
+
+    // Reads the 'quantize' or valued 'fixed' annotation of the given attribute into out_quantization. Returns whether
+    // the attribute is quantized. Sets out_error if the annotation is malformed or doesn't fit the attribute's type
+    bool get_quantization(attribute const& attribute, quantization& out_quantization, std::string& out_error);
+
+    // The maximum amount of attributes of a [delta] message, whose dirty fields are tracked in a 64 bit mask
+    constexpr std::size_t max_delta_fields = 64;
+
+    // The largest id that an 'id' annotation may pin. Ids index the dense dispatch table of their protocol, so they
+    // have to stay small
+    constexpr int max_message_id = 65535;
+
+    // An inclusive range of integer values
+    struct value_range
+    {
+        std::int64_t min = 0;
+        std::int64_t max = 0;
+    };
+
+    // Returns the amount of bits that are needed to store every value of the given range as its distance to the
+    // range's minimum. A range of a single value still takes one bit
+    int bit_width(value_range const& range);
+
+    // Returns the range of the values of the given enumeration
+    value_range get_value_range(enumeration const& enumeration);
+
+    // Returns the distinct values of the given enumeration in ascending order if they leave gaps in its range, and
+    // nothing if every value of the range belongs to an enumerator
+    std::vector<std::int64_t> get_sparse_values(enumeration const& enumeration);
+
+    // Reads the 'range=lo..hi' annotation of the given attribute into out_range. Returns whether the attribute has one.
+    // Sets out_error if the annotation is malformed or doesn't fit the attribute's type
+    bool get_range(attribute const& attribute, value_range& out_range, std::string& out_error);
+
+    // Returns the amount of bits that the given attribute occupies in a bitpacked message or data and sets out_offset
+    // to the value that is subtracted before packing. Bools take one bit, enums and ranged integers as many bits as
+    // their range needs. Returns 0 for all attributes that keep their full width. enum_ranges holds the ranges of all
+    // known enums
+    int get_packed_bits(attribute const& attribute, std::unordered_map<std::string, value_range> const& enum_ranges,
+                        std::int64_t& out_offset);
+
+    // The width of the words of the presence bitmap that precedes the fields of a message or data with optional
+    // attributes
+    constexpr std::size_t presence_word_bits = 32;
+
+    // Returns whether the given attribute is optional
+    bool is_optional(attribute const& attribute);
+
+    // Returns the amount of optional attributes among the given attributes
+    std::size_t count_optionals(std::vector<attribute> const& attributes);
+
+    // Returns the amount of words of the presence bitmap of a message or data with the given optional_count
+    std::size_t presence_words(std::size_t optional_count);
+
+    // The size of a type or attribute on the wire. The default wire format writes builtins at their width, enums at
+    // their alignment, data inline, arrays as their elements, strings and repeated attributes as a length prefix
+    // followed by their elements and omits absent optional attributes behind a presence bitmap. varint and zigzag
+    // integers take up to one byte per 7 bits, except for signed varints whose negative values are written as 64 bit
+    // varints, quantized floats the bytes of their bits or a fixed point varint, and bitpacked containers pack their
+    // bools, enums, ranged integers and quantized floats into one bitstream
+    struct wire_size
+    {
+        // The exact size if is_fixed, otherwise the maximum size if is_bounded
+        std::size_t size = 0;
+        // Does every value have the same size?
+        bool is_fixed = true;
+        // Is there a maximum size?
+        bool is_bounded = true;
+    };
+
+    // The wire sizes of enums, data and messages by name
+    using wire_size_table = std::unordered_map<std::string, wire_size>;
+
+    // The size of the length prefix of strings and repeated attributes
+    constexpr std::size_t length_prefix_size = 4;
+
+    // Returns the wire size of a single element of the given attribute, ignoring its specifier and array size. Sets
+    // out_packed_bits to its bits if it belongs to the bitstream of its bitpacked container, in which case the
+    // returned size is 0
+    wire_size get_element_size(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                               wire_size_table const& types,
+                               std::unordered_map<std::string, value_range> const& enum_ranges, int& out_packed_bits);
+
+    // Returns the wire size of the given attribute. Sets out_packed_bits to the bits it occupies in the bitstream of
+    // its bitpacked container, in which case the returned size is 0
+    wire_size get_attribute_size(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                                 wire_size_table const& types,
+                                 std::unordered_map<std::string, value_range> const& enum_ranges,
+                                 int& out_packed_bits);
+
+    // Returns the wire size of a message or data with the given attributes and annotations. Sets out_fixed_part to the
+    // size of everything but the attributes whose size varies
+    wire_size get_container_size(std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+                                 wire_size_table const& types,
+                                 std::unordered_map<std::string, value_range> const& enum_ranges,
+                                 std::size_t& out_fixed_part);
+
+    // The size of the tag that precedes the alternative of a union on the wire. Tag 0 marks an empty union, the
+    // alternatives are tagged from 1 on in their order
+    constexpr std::size_t union_tag_size = 1;
+
+    // The maximum amount of alternatives of a union, whose tag is a single byte
+    constexpr std::size_t max_union_alternatives = 255;
+
+    // Returns the wire size of a union with the given alternatives and annotations, which is its tag followed by the
+    // alternative it holds. It is never fixed, since an empty union is only its tag
+    wire_size get_union_size(std::vector<attribute> const& alternatives, std::vector<annotation> const& annotations,
+                             wire_size_table const& types,
+                             std::unordered_map<std::string, value_range> const& enum_ranges);
+
+    // Returns the wire width of a single element of the given array or repeated attribute if its elements are written
+    // as their plain little endian bytes and can therefore be copied in bulk. That holds for integers, chars and floats
+    // at their full width and for enums. Returns 0 for all other attributes, including bools whose bytes have to be
+    // validated when they are read
+    int get_bulk_width(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                       wire_size_table const& types, std::unordered_map<std::string, value_range> const& enum_ranges);
+
+    // Returns the offset from the start of the encoding of every attribute of a message or data with the given
+    // attributes and annotations that can be written in place, i.e. at the same offset with the same size for every
+    // value. That holds for the attributes behind the presence bitmap up to the first one whose size varies, which
+    // together with the presence bitmap make up the in place region whose size is set to out_in_place_size. All other
+    // attributes have to be appended in order behind it. Bitpacked containers have no attributes that are written in
+    // place
+    std::vector<std::optional<std::size_t>> get_in_place_offsets(
+        std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+        wire_size_table const& types, std::unordered_map<std::string, value_range> const& enum_ranges,
+        std::size_t& out_in_place_size);
+
+    // Where the generated struct of a message or data places an attribute in memory. Hot attributes go first so that
+    // the ones a tight loop touches share the first cache lines, cold attributes go last
+    enum class temperature
+    {
+        hot,
+        normal,
+        cold,
+    };
+
+    // Returns the name of the given temperature as it is exposed to templates
+    char const* to_string(temperature temperature);
+
+    // Returns the temperature that the 'hot' or 'cold' annotation of the given attribute sets. Sets out_error if the
+    // attribute has both of them
+    temperature get_temperature(attribute const& attribute, std::string& out_error);
+
+    // The size and alignment of a type or attribute in memory. Generated types hold builtins at their width, enums at
+    // their alignment, strings as std::string, repeated attributes as std::vector, arrays as their elements, data and
+    // messages as a struct of their attributes in memory order followed by their presence bitmap and unions as
+    // std::variant. The standard library types are sized as on the common 64 bit standard libraries
+    struct memory_size
+    {
+        std::size_t size = 0;
+        std::size_t alignment = 1;
+    };
+
+    // The memory sizes of enums, data, unions and messages by name
+    using memory_size_table = std::unordered_map<std::string, memory_size>;
+
+    // Returns the memory size of the given attribute
+    memory_size get_memory_size(attribute const& attribute, memory_size_table const& types);
+
+    // Where the attributes of a message or data are placed in memory
+    struct field_layout
+    {
+        // The indices of the attributes in memory order
+        std::vector<std::size_t> order;
+        // The offset of every attribute, by attribute index
+        std::vector<std::size_t> offsets;
+        // The offset of the presence bitmap that follows the attributes
+        std::size_t presence_offset = 0;
+        // The size and alignment of the whole struct
+        memory_size size;
+        // The bytes of padding between the attributes and at the end of the struct
+        std::size_t padding = 0;
+    };
+
+    // Returns the memory order that wastes the least padding while keeping hot attributes first and cold attributes
+    // last: every temperature is sorted by decreasing alignment, attributes of the same alignment keep their order
+    std::vector<std::size_t> optimize_field_order(std::vector<attribute> const& attributes,
+                                                  memory_size_table const& types);
+
+    // Returns the layout of the attributes of the given order, in that order and naturally aligned. They are followed
+    // by the presence bitmap of all optional attributes if with_presence is set
+    field_layout get_field_layout(std::vector<attribute> const& attributes, std::vector<std::size_t> const& order,
+                                  memory_size_table const& types, bool with_presence = true);
+
+    // The size of a cache line, which the hot part of a split message or data should fit into
+    constexpr std::size_t cache_line_size = 64;
+
+    // Returns whether the given attribute of a message or data with the given container_annotations is moved into a
+    // separately allocated cold block. That holds for every attribute of a [split] container that isn't [hot]
+    bool is_cold_block_attribute(attribute const& attribute, std::vector<annotation> const& container_annotations);
+
+    // Where the attributes of a [split] message or data are placed in memory. The generated type holds a struct of its
+    // hot attributes, its presence bitmap and a pointer to the struct of its other attributes
+    struct split_layout
+    {
+        // The layout of the struct of the hot attributes
+        field_layout hot;
+        // The layout of the struct of the attributes in the cold block
+        field_layout cold;
+        // The offset of the presence bitmap
+        std::size_t presence_offset = 0;
+        // The size and alignment of the whole type
+        memory_size size;
+    };
+
+    // Returns the layout of a [split] message or data with the given attributes. Both parts keep the optimized order
+    split_layout get_split_layout(std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+                                  memory_size_table const& types);
+
+    // Computes the memory sizes of every enum, data, union and message of the given asts, with the attributes of data
+    // and messages in their optimized order and split types without their cold block. Types that contain themselves
+    // directly are sized as if they were empty
+    memory_size_table compute_memory_sizes(std::vector<ast const*> const& asts);
+
+    // A column of the structure of arrays that a [soa] attribute is stored as, i.e. one attribute of its data type
+    struct soa_column
+    {
+        // The name of the attribute
+        std::string name;
+        // The type of the attribute
+        std::string type;
+        // The wire width of a single value, which is also its width in memory
+        int width = 0;
+    };
+
+    // The columns of every data that a [soa] attribute can be stored as, by name
+    using soa_column_table = std::unordered_map<std::string, std::vector<soa_column>>;
+
+    // Sets out_columns to the columns of the given data and returns true if a repeated attribute of it can be stored
+    // as structure of arrays. That holds if every attribute of the data is a single, required value that can be
+    // copied in bulk, i.e. a number or an enum that is neither quantized nor varint encoded, and if the data is
+    // neither [bitpacked] nor [split]. Returns false otherwise
+    bool get_soa_columns(data const& data, wire_size_table const& types,
+                         std::unordered_map<std::string, value_range> const& enum_ranges,
+                         std::vector<soa_column>& out_columns);
+
+    // Computes the columns of every data of the given asts that a [soa] attribute can be stored as
+    soa_column_table compute_soa_columns(std::vector<ast const*> const& asts, wire_size_table const& types,
+                                         std::unordered_map<std::string, value_range> const& enum_ranges);
+
+    // Computes the wire sizes of every enum, data, union and message of the given asts. Types that contain themselves
+    // are unbounded
+    wire_size_table compute_wire_sizes(std::vector<ast const*> const& asts);
+}
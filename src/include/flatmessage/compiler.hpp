@@ -17,6 +17,9 @@ limitations under the License.
 #pragma once
 
 #include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace flatmessage
@@ -28,8 +31,12 @@ namespace flatmessage
         none = 0,
         // Parses the translation units as if they are in one big file
         merge_translation_units = 1,
+        // Prints the memory size and padding of every data and message with optimized and with declared field order
+        layout_report = 2,
     };
 
+    class file_system;
+
     // A set of options to configure the compiler's behaviour
     struct compiler_options
     {
@@ -45,6 +52,43 @@ namespace flatmessage
         compiler_flags flags = compiler_flags::none;
 		// A list of include directories
         std::vector<boost::filesystem::path> include_directories;
+        // The directory of a generation_cache that may be shared between checkouts. Caching is disabled if empty
+        boost::filesystem::path cache_directory;
+        // The size in bytes that the generation_cache shouldn't exceed
+        std::uintmax_t cache_max_size = 1024 * 1024 * 1024;
+        // Should hits from the generation_cache be hard linked into the output_path instead of being copied?
+        bool cache_hard_links = false;
+        // The 0-based index of the shard that this compilation generates. All shards parse and analyze the same files
+        // but each one only generates its part of the translation units
+        int shard_index = 0;
+        // The amount of shards that the translation units are distributed across
+        int shard_count = 1;
+        // If greater than 0, the outputs of the translation units are additionally grouped into this many unity files
+        // of roughly equal size that include them, so that a build only has to compile the unity files. Shards then
+        // distribute the unity files
+        int batch_count = 0;
+        // The file system that inputs and templates are read from and outputs are written to. Uses the file system of
+        // the operating system if nullptr
+        std::shared_ptr<flatmessage::file_system> file_system;
+    };
+
+    class module_cache;
+
+    // A single compilation with a fixed set of compiler_options. Every compile_files call starts from a clean state and
+    // keeps all of its state to itself, so independent sessions can be used concurrently from different threads
+    class compile_session
+    {
+      public:
+        // Constructs a session that compiles with the given options. If a module_cache is given, files that are already
+        // cached won't be parsed again. The same module_cache may be shared by any number of sessions
+        explicit compile_session(compiler_options options, std::shared_ptr<module_cache> modules = nullptr);
+
+        // Compiles the given list of files and returns whether or not it succeeded
+        bool compile_files(std::vector<boost::filesystem::path> const& files) const;
+
+      private:
+        compiler_options _options;
+        std::shared_ptr<module_cache> _modules;
     };
 
     // Handles compilation of file_template_pairs
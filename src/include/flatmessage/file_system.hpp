@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace flatmessage
+{
+    // The file system the compiler reads its inputs and templates from and writes its outputs to
+    class file_system
+    {
+      public:
+        virtual ~file_system() = default;
+
+        // Reads the file at the given path into out_content and returns whether it succeeded
+        virtual bool read_file(boost::filesystem::path const& path, std::string& out_content) const = 0;
+
+        // Returns the paths of all files that are directly inside the given directory
+        virtual std::vector<boost::filesystem::path> list_directory(boost::filesystem::path const& directory) const = 0;
+
+        // Writes the given content into the file at the given path and returns whether it succeeded. Missing parent
+        // directories are created
+        virtual bool write_file(boost::filesystem::path const& path, std::string const& content) = 0;
+    };
+
+    // The file system of the operating system
+    class os_file_system : public file_system
+    {
+      public:
+        bool read_file(boost::filesystem::path const& path, std::string& out_content) const override;
+        std::vector<boost::filesystem::path> list_directory(boost::filesystem::path const& directory) const override;
+        // Replaces the file instead of writing through it, so hard links to the previous file stay untouched
+        bool write_file(boost::filesystem::path const& path, std::string const& content) override;
+    };
+
+    // A thread-safe file system that only lives in memory. Lets tools that already hold their schemas in memory
+    // compile them without touching the disk
+    class memory_file_system : public file_system
+    {
+      public:
+        bool read_file(boost::filesystem::path const& path, std::string& out_content) const override;
+        std::vector<boost::filesystem::path> list_directory(boost::filesystem::path const& directory) const override;
+        bool write_file(boost::filesystem::path const& path, std::string const& content) override;
+
+        // Returns whether there is a file at the given path
+        bool exists(boost::filesystem::path const& path) const;
+
+      private:
+        // Stores the content of the files by their normalized paths
+        std::map<std::string, std::string> _files;
+        mutable std::mutex _mutex;
+    };
+}
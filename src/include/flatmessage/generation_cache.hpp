@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace flatmessage
+{
+    // A content-addressed store of generated files that can be shared between checkouts and processes. Every entry is
+    // stored under a key that is derived from everything that influences the generated output, so a hit can simply be
+    // copied (or hard linked) into place instead of being generated again
+    class generation_cache
+    {
+      public:
+        // Constructs a cache that lives inside the given directory and that should not grow larger than max_size bytes
+        generation_cache(boost::filesystem::path const& directory, std::uintmax_t max_size);
+
+        // Returns the key for the given key_material. The key_material has to contain everything that influences the
+        // generated output
+        static std::string make_key(std::string const& key_material);
+
+        // Places the entry stored under the given key at the given destination and returns whether it was found. Uses
+        // a hard link instead of a copy if hard_link is true
+        bool fetch(std::string const& key, boost::filesystem::path const& destination, bool hard_link = false);
+
+        // Reads the entry stored under the given key into out_content and returns whether it was found
+        bool load(std::string const& key, std::string& out_content);
+
+        // Stores the given content under the given key
+        void store(std::string const& key, std::string const& content);
+
+        // Removes the least recently used entries until the cache no longer exceeds its maximum size
+        void evict();
+
+      private:
+        // Returns the path of the entry that is stored under the given key
+        boost::filesystem::path entry_path(std::string const& key) const;
+
+        boost::filesystem::path _directory;
+        std::uintmax_t _max_size;
+    };
+}
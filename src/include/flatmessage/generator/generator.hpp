@@ -17,8 +17,7 @@ limitations under the License.
 #pragma once
 
 #include "../ast/ast.hpp"
-
-#include <unordered_set>
+#include "../symbol_table.hpp"
 
 namespace flatmessage
 {
@@ -26,10 +25,7 @@ namespace flatmessage
     {
         struct generator
         {
-            virtual bool generate(std::ostream& out, ast::ast const& ast,
-                                  std::unordered_set<std::string> const& exported_enums,
-                                  std::unordered_set<std::string> const& exported_data)
-                = 0;
+            virtual bool generate(std::ostream& out, ast::ast const& ast, symbol_table const& symbols) = 0;
         };
     }
 }
\ No newline at end of file
@@ -18,8 +18,14 @@ limitations under the License.
 
 #include "generator.hpp"
 
+#include <optional>
+#include <string>
+#include <vector>
+
 namespace flatmessage
 {
+    class file_system;
+
     namespace generator
     {
         // A code generator that uses a template to generate code
@@ -28,13 +34,21 @@ namespace flatmessage
           public:
             // Constructs the template_generator by parsing the given template_file_path
             template_generator(std::string const& template_file_path);
+            // Constructs the template_generator from the given template_content. Templates that are included by it are
+            // read from the given file_system, relative to the template that includes them. The first of them to be
+            // read for an include name is used wherever that name is included
+            template_generator(std::string const& template_file_path, std::string template_content,
+                               file_system const& file_system);
             // Generates the code from the given ast and writes it into the given stream
-            bool generate(std::ostream& stream, ast::ast const& ast,
-                          std::unordered_set<std::string> const& exported_enums,
-                          std::unordered_set<std::string> const& exported_data) override;
+            bool generate(std::ostream& stream, ast::ast const& ast, symbol_table const& symbols) override;
 
           private:
             std::string _template;
+            std::optional<std::string> _content;
+            file_system const* _file_system = nullptr;
         };
+
+        // Returns the names of the templates that the given template_content includes, in the order of their includes
+        std::vector<std::string> find_includes(std::string const& template_content);
     }
 }
\ No newline at end of file
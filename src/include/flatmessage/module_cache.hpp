@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <flatmessage/ast/ast.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace flatmessage
+{
+    class file_system;
+
+    // A thread-safe cache of parsed files. The cached ASTs are immutable, so a single module_cache can be shared by
+    // any number of concurrent compile_sessions that then only have to parse files that changed in between
+    class module_cache
+    {
+      public:
+        // Returns the AST of the file at the given file_path inside the given file_system. The file is only parsed if
+        // it isn't cached yet or if its content changed since it was cached. Returns nullptr and sets out_error if
+        // parsing failed
+        std::shared_ptr<ast::ast const> parse_file(file_system const& file_system,
+                                                   boost::filesystem::path const& file_path, std::string& out_error);
+
+        // Removes every cached AST
+        void clear();
+
+      private:
+        struct entry
+        {
+            // The content of the file when it was parsed
+            std::string content;
+            // The parsed content
+            std::shared_ptr<ast::ast const> ast;
+        };
+
+        // Stores entries by the absolute path of their files
+        std::unordered_map<std::string, entry> _entries;
+        std::shared_mutex _mutex;
+    };
+}
@@ -27,6 +27,8 @@ namespace boost::filesystem
 
 namespace flatmessage
 {
+    class file_system;
+
     namespace parser
     {
         // Parses the given string and returns an AST representing its content if parsing succeeded. If it failed the
@@ -38,5 +40,10 @@ namespace flatmessage
         // Parses the file at the given file_path and returns an AST representing its content if it succeeded. If it
         // failed the given out_error will contain the failure reason
         std::optional<ast::ast> parse_file(boost::filesystem::path const& file_path, std::string& out_error);
+
+        // Parses the file at the given file_path inside the given file_system and returns an AST representing its
+        // content if it succeeded. If it failed the given out_error will contain the failure reason
+        std::optional<ast::ast> parse_file(file_system const& file_system, boost::filesystem::path const& file_path,
+                                           std::string& out_error);
     }
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // A memory_resource that hands out memory by bumping a pointer through a list of chunks and frees nothing until
+        // it is reset. Resetting keeps the chunks, so a decode loop that resets its arena once per tick stops
+        // allocating as soon as the chunks fit the largest tick. Use it through std::pmr::polymorphic_allocator, e.g.
+        // with std::pmr::string and std::pmr::vector attributes. Not thread-safe
+        class arena final : public std::pmr::memory_resource
+        {
+          public:
+            // Constructs an arena whose chunks have at least chunk_size bytes
+            explicit arena(std::size_t chunk_size = 64 * 1024) : _chunk_size{chunk_size} {}
+
+            arena(arena const&) = delete;
+            arena& operator=(arena const&) = delete;
+
+            // Invalidates everything that was allocated and starts over at the first chunk
+            void reset() noexcept
+            {
+                _current = 0;
+                _used = 0;
+                _allocated = 0;
+            }
+
+            // Returns the amount of bytes handed out since the last reset
+            std::size_t allocated() const noexcept { return _allocated; }
+
+            // Returns the amount of bytes of all chunks
+            std::size_t capacity() const noexcept
+            {
+                std::size_t capacity = 0;
+                for (auto& chunk : _chunks)
+                    capacity += chunk.size;
+
+                return capacity;
+            }
+
+            // Returns the amount of chunks that were allocated from the heap
+            std::size_t chunk_count() const noexcept { return _chunks.size(); }
+
+          private:
+            struct chunk
+            {
+                std::unique_ptr<std::byte[]> data;
+                std::size_t size;
+            };
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+                // Chunks that are too small for this allocation are skipped but kept for the next tick
+                for (; _current < _chunks.size(); ++_current, _used = 0)
+                {
+                    if (auto* memory = take(_chunks[_current], bytes, alignment))
+                        return memory;
+                }
+
+                auto size = std::max(_chunk_size, bytes + alignment);
+                _chunks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+                _used = 0;
+                return take(_chunks.back(), bytes, alignment);
+            }
+
+            void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+            bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+            // Returns aligned memory of the given size from the unused part of the given chunk or nullptr if it is too
+            // small
+            void* take(chunk& chunk, std::size_t bytes, std::size_t alignment) noexcept
+            {
+                auto const address = reinterpret_cast<std::uintptr_t>(chunk.data.get()) + _used;
+                auto const padding = (alignment - address % alignment) % alignment;
+                if (padding + bytes > chunk.size - _used)
+                    return nullptr;
+
+                _used += padding + bytes;
+                _allocated += bytes;
+                return chunk.data.get() + (_used - bytes);
+            }
+
+            std::size_t _chunk_size;
+            std::vector<chunk> _chunks;
+            // The chunk that is allocated from and how much of it is used
+            std::size_t _current = 0;
+            std::size_t _used = 0;
+            std::size_t _allocated = 0;
+        };
+    }
+}
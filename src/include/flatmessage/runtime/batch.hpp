@@ -0,0 +1,279 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "stream_decoder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#endif
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The size of the message id at the start of every frame of a batch
+        constexpr std::size_t FRAME_ID_SIZE = 4;
+
+        // A message inside a batch
+        struct frame
+        {
+            std::uint32_t id = 0;
+            std::span<std::uint8_t const> payload;
+        };
+
+        // Packs many encoded messages into one output, so that a tick's messages are sent with a single write. Every
+        // message becomes a frame of the stream_decoder format whose content starts with the 32 bit little endian
+        // message id. Small pieces are copied into one contiguous buffer, large ones like strings and byte arrays
+        // can be referenced in place and are sent from where they are by a gathering write like writev
+        class frame_batch
+        {
+          public:
+            // A contiguous piece of the batch
+            using segment = std::span<std::uint8_t const>;
+
+            // Starts a frame of the message with the given id
+            void begin_frame(std::uint32_t id)
+            {
+                _frame_start = _buffer.size();
+                _frame_size = FRAME_ID_SIZE;
+                _buffer.resize(_frame_start + FRAME_HEADER_SIZE + FRAME_ID_SIZE);
+
+                // The id is a 32 bit little endian value just like the header, whose size is known at end_frame
+                write_frame_header(id, _buffer.data() + _frame_start + FRAME_HEADER_SIZE);
+            }
+
+            // Copies the given bytes into the current frame
+            void write(std::span<std::uint8_t const> bytes)
+            {
+                _buffer.insert(_buffer.end(), bytes.begin(), bytes.end());
+                _frame_size += bytes.size();
+            }
+
+            // Returns room for size bytes at the end of the current frame that the caller writes to directly, e.g.
+            // with a wire_builder. The room is only valid until the batch is changed again
+            std::span<std::uint8_t> reserve(std::size_t size)
+            {
+                auto offset = _buffer.size();
+                _buffer.resize(offset + size);
+                _frame_size += size;
+                return {_buffer.data() + offset, size};
+            }
+
+            // Gives back the unused part of the room that the last reserve returned
+            void shrink(std::size_t unused) noexcept
+            {
+                _buffer.resize(_buffer.size() - unused);
+                _frame_size -= unused;
+            }
+
+            // Adds the given bytes to the current frame without copying them. They have to stay valid until the batch
+            // is sent. Pieces smaller than copy_threshold are cheaper to copy than to send as their own segment
+            void reference(std::span<std::uint8_t const> bytes)
+            {
+                if (bytes.size() < copy_threshold)
+                {
+                    write(bytes);
+                    return;
+                }
+
+                _references.push_back({_buffer.size(), bytes});
+                _frame_size += bytes.size();
+            }
+
+            // Finishes the current frame
+            void end_frame() noexcept
+            {
+                write_frame_header(static_cast<std::uint32_t>(_frame_size), _buffer.data() + _frame_start);
+                ++_frame_count;
+            }
+
+            // Adds a whole frame of the given id and payload
+            void add(std::uint32_t id, std::span<std::uint8_t const> payload)
+            {
+                begin_frame(id);
+                write(payload);
+                end_frame();
+            }
+
+            // Returns the batch as segments in the order they have to be sent
+            std::vector<segment> segments() const
+            {
+                std::vector<segment> segments;
+                segments.reserve(2 * _references.size() + 1);
+
+                std::size_t copied = 0;
+                for (auto& reference : _references)
+                {
+                    if (reference.position > copied)
+                        segments.emplace_back(_buffer.data() + copied, reference.position - copied);
+
+                    segments.push_back(reference.bytes);
+                    copied = reference.position;
+                }
+
+                if (_buffer.size() > copied)
+                    segments.emplace_back(_buffer.data() + copied, _buffer.size() - copied);
+
+                return segments;
+            }
+
+            // Returns whether the batch is a single contiguous buffer, i.e. nothing is referenced
+            bool is_contiguous() const noexcept { return _references.empty(); }
+
+            // Returns the batch if it is contiguous
+            std::span<std::uint8_t const> contiguous() const noexcept { return _buffer; }
+
+            // Returns the amount of bytes of the batch
+            std::size_t size() const noexcept
+            {
+                auto size = _buffer.size();
+                for (auto& reference : _references)
+                    size += reference.bytes.size();
+
+                return size;
+            }
+
+            // Returns the amount of frames of the batch
+            std::size_t frame_count() const noexcept { return _frame_count; }
+
+            // Removes all frames but keeps the buffer's capacity for the next tick
+            void clear() noexcept
+            {
+                _buffer.clear();
+                _references.clear();
+                _frame_count = 0;
+            }
+
+            // Referenced pieces smaller than this are copied instead
+            std::size_t copy_threshold = 256;
+
+          private:
+            // A referenced piece and the position in the buffer that it follows
+            struct referenced
+            {
+                std::size_t position;
+                std::span<std::uint8_t const> bytes;
+            };
+
+            std::vector<std::uint8_t> _buffer;
+            std::vector<referenced> _references;
+            std::size_t _frame_start = 0;
+            std::size_t _frame_size = 0;
+            std::size_t _frame_count = 0;
+        };
+
+        // Iterates the frames of a batch that was received as a whole without copying them
+        class batch_reader
+        {
+          public:
+            // Constructs a reader that reads from [in, end)
+            batch_reader(std::uint8_t const* in, std::uint8_t const* end) noexcept : _in{in}, _end{end} {}
+
+            // Reads the next frame into out_frame. Returns false at the end of the batch or if it is truncated, which
+            // is distinguished by failed
+            bool next(frame& out_frame) noexcept
+            {
+                if (_in == _end)
+                    return false;
+
+                auto const available = static_cast<std::size_t>(_end - _in);
+                auto const size = available < FRAME_HEADER_SIZE ? 0 : read(_in);
+                if (size < FRAME_ID_SIZE || available - FRAME_HEADER_SIZE < size)
+                {
+                    _failed = true;
+                    return false;
+                }
+
+                out_frame = parse_frame({_in + FRAME_HEADER_SIZE, size});
+                _in += FRAME_HEADER_SIZE + size;
+                return true;
+            }
+
+            // Returns whether the batch is truncated or corrupt
+            bool failed() const noexcept { return _failed; }
+
+            // Splits the content of a frame, like one that a stream_decoder hands out, into id and payload. The
+            // content must have at least FRAME_ID_SIZE bytes
+            static frame parse_frame(std::span<std::uint8_t const> content) noexcept
+            {
+                return {read(content.data()), content.subspan(FRAME_ID_SIZE)};
+            }
+
+          private:
+            static std::uint32_t read(std::uint8_t const* in) noexcept
+            {
+                std::uint32_t value;
+                std::memcpy(&value, in, sizeof(value));
+                if constexpr (std::endian::native == std::endian::big)
+                    value = std::byteswap(value);
+
+                return value;
+            }
+
+            std::uint8_t const* _in;
+            std::uint8_t const* _end;
+            bool _failed = false;
+        };
+
+#if __has_include(<sys/uio.h>)
+        // Writes the given batch to the given file descriptor with a single gathering write per IOV_MAX segments.
+        // Returns the amount of bytes written, which is less than the batch's size if the descriptor is non-blocking
+        // or an error occurred, in which case errno tells which
+        inline std::size_t write_batch(int descriptor, frame_batch const& batch)
+        {
+            auto segments = batch.segments();
+            std::vector<iovec> vectors(segments.size());
+            for (std::size_t i = 0; i < segments.size(); ++i)
+                vectors[i] = {const_cast<std::uint8_t*>(segments[i].data()), segments[i].size()};
+
+            std::size_t written = 0;
+            for (std::size_t first = 0; first < vectors.size();)
+            {
+                auto const count = std::min<std::size_t>(vectors.size() - first, IOV_MAX);
+                auto const result = ::writev(descriptor, vectors.data() + first, static_cast<int>(count));
+                if (result <= 0)
+                    break;
+
+                written += static_cast<std::size_t>(result);
+
+                // Skip the segments that were written completely and continue a partly written one
+                auto remaining = static_cast<std::size_t>(result);
+                while (first < vectors.size() && remaining >= vectors[first].iov_len)
+                    remaining -= vectors[first++].iov_len;
+
+                if (remaining != 0)
+                {
+                    vectors[first].iov_base = static_cast<std::uint8_t*>(vectors[first].iov_base) + remaining;
+                    vectors[first].iov_len -= remaining;
+                }
+            }
+
+            return written;
+        }
+#endif
+    }
+}
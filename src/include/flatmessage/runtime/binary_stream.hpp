@@ -0,0 +1,619 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "bit_stream.hpp"
+#include "bulk.hpp"
+#include "delta.hpp"
+#include "presence.hpp"
+#include "quantize.hpp"
+#include "soa.hpp"
+#include "varint.hpp"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Writes messages and data in the default wire format to a growing buffer: builtins at their width in little
+        // endian, strings as 32 bit length followed by their characters and presence bitmaps as their words. Arrays
+        // and repeated attributes of bulk elements are copied in bulk, structures of arrays column by column, integers
+        // with a varint or zigzag encoding as varints, quantized floats as their quantized integers and the bitstream
+        // of a bitpacked container through a bit_writer. Other arrays and repeated attributes are written element by
+        // element. The generated operator<< overloads write their attributes one after the other through it and live
+        // in the namespace of their types, where the element by element overloads find them
+        class binary_encoder
+        {
+          public:
+            template <bulk_element T> binary_encoder& operator<<(T value)
+            {
+                encode_bulk(std::span<T const>{&value, 1}, reserve(sizeof(T)));
+                return *this;
+            }
+
+            binary_encoder& operator<<(bool value) { return *this << static_cast<std::uint8_t>(value); }
+
+            binary_encoder& operator<<(std::string_view value)
+            {
+                *this << static_cast<std::uint32_t>(value.size());
+                if (!value.empty())
+                    std::memcpy(reserve(value.size()), value.data(), value.size());
+
+                return *this;
+            }
+
+            template <std::size_t OptionalCount>
+            binary_encoder& operator<<(presence_bits<OptionalCount> const& presence)
+            {
+                presence.encode(reserve(presence_bits<OptionalCount>::size));
+                return *this;
+            }
+
+            // Writes an array as its elements one after the other, an array of bulk elements in bulk
+            template <typename T, std::size_t Size> binary_encoder& operator<<(std::array<T, Size> const& values)
+            {
+                if constexpr (bulk_element<T>)
+                    return write_bulk(values);
+                else
+                {
+                    for (auto const& value : values)
+                        *this << value;
+
+                    return *this;
+                }
+            }
+
+            // Writes repeated values as 32 bit count followed by the values one after the other, repeated bulk elements
+            // in bulk
+            template <typename T, typename Allocator>
+            binary_encoder& operator<<(std::vector<T, Allocator> const& values)
+            {
+                if constexpr (bulk_element<T>)
+                    return write_bulk(values);
+                else
+                {
+                    *this << static_cast<std::uint32_t>(values.size());
+                    for (auto const& value : values)
+                        *this << value;
+
+                    return *this;
+                }
+            }
+
+            // Writes an array as its elements
+            template <bulk_element T, std::size_t Size> binary_encoder& write_bulk(std::array<T, Size> const& values)
+            {
+                encode_bulk(std::span<T const>{values}, reserve(sizeof(T) * Size));
+                return *this;
+            }
+
+            // Writes repeated values as 32 bit count followed by the values
+            template <bulk_element T, typename Allocator>
+            binary_encoder& write_bulk(std::vector<T, Allocator> const& values)
+            {
+                encode_repeated_bulk(values, reserve(sizeof(std::uint32_t) + values.size() * sizeof(T)));
+                return *this;
+            }
+
+            // Writes repeated values that are stored as structure of arrays as 32 bit count followed by their columns
+            template <typename Row, auto... Members>
+            binary_encoder& write_columns(soa_vector<Row, Members...> const& values)
+            {
+                constexpr std::size_t row_size = (sizeof(member_type<Members>) + ...);
+                encode_columns(values, reserve(sizeof(std::uint32_t) + values.size() * row_size));
+                return *this;
+            }
+
+            // Writes an integer as varint. Signed integers are sign extended, so that negative ones take
+            // MAX_VARINT_SIZE bytes
+            template <std::integral T> binary_encoder& write_varint(T value)
+            {
+                write_varints(std::span<T const>{&value, 1}, encode_varints<T>);
+                return *this;
+            }
+
+            // Writes an array of integers as varints
+            template <std::integral T, std::size_t Size>
+            binary_encoder& write_varint(std::array<T, Size> const& values)
+            {
+                write_varints(std::span<T const>{values}, encode_varints<T>);
+                return *this;
+            }
+
+            // Writes repeated integers as 32 bit count followed by the values as varints
+            template <std::integral T, typename Allocator>
+            binary_encoder& write_varint(std::vector<T, Allocator> const& values)
+            {
+                *this << static_cast<std::uint32_t>(values.size());
+                write_varints(std::span<T const>{values}, encode_varints<T>);
+                return *this;
+            }
+
+            // Writes a signed integer as zigzag encoded varint
+            template <std::signed_integral T> binary_encoder& write_zigzag(T value)
+            {
+                write_varints(std::span<T const>{&value, 1}, encode_zigzags<T>);
+                return *this;
+            }
+
+            // Writes an array of signed integers as zigzag encoded varints
+            template <std::signed_integral T, std::size_t Size>
+            binary_encoder& write_zigzag(std::array<T, Size> const& values)
+            {
+                write_varints(std::span<T const>{values}, encode_zigzags<T>);
+                return *this;
+            }
+
+            // Writes repeated signed integers as 32 bit count followed by the values as zigzag encoded varints
+            template <std::signed_integral T, typename Allocator>
+            binary_encoder& write_zigzag(std::vector<T, Allocator> const& values)
+            {
+                *this << static_cast<std::uint32_t>(values.size());
+                write_varints(std::span<T const>{values}, encode_zigzags<T>);
+                return *this;
+            }
+
+            // Writes a float quantized to bits as the (bits + 7) / 8 bytes of its quantized value in little endian
+            binary_encoder& write_quantized(float value, float min, float max, int bits)
+            {
+                auto const quantized = quantize(value, min, max, bits);
+                auto* out = reserve(quantized_size(bits));
+                for (std::size_t i = 0; i < quantized_size(bits); ++i)
+                    out[i] = static_cast<std::uint8_t>(quantized >> (8 * i));
+
+                return *this;
+            }
+
+            // Writes an array of floats quantized to bits
+            template <std::size_t Size>
+            binary_encoder& write_quantized(std::array<float, Size> const& values, float min, float max, int bits)
+            {
+                for (auto value : values)
+                    write_quantized(value, min, max, bits);
+
+                return *this;
+            }
+
+            // Writes repeated floats as 32 bit count followed by the values quantized to bits
+            template <typename Allocator>
+            binary_encoder& write_quantized(std::vector<float, Allocator> const& values, float min, float max,
+                                            int bits)
+            {
+                *this << static_cast<std::uint32_t>(values.size());
+                for (auto value : values)
+                    write_quantized(value, min, max, bits);
+
+                return *this;
+            }
+
+            // Writes a float as zigzag encoded varint of the multiple of step that is closest to it
+            binary_encoder& write_fixed_point(float value, double step)
+            {
+                return write_zigzag(to_fixed_point(value, step));
+            }
+
+            // Writes an array of floats as fixed point numbers
+            template <std::size_t Size>
+            binary_encoder& write_fixed_point(std::array<float, Size> const& values, double step)
+            {
+                for (auto value : values)
+                    write_fixed_point(value, step);
+
+                return *this;
+            }
+
+            // Writes repeated floats as 32 bit count followed by the values as fixed point numbers
+            template <typename Allocator>
+            binary_encoder& write_fixed_point(std::vector<float, Allocator> const& values, double step)
+            {
+                *this << static_cast<std::uint32_t>(values.size());
+                for (auto value : values)
+                    write_fixed_point(value, step);
+
+                return *this;
+            }
+
+            // Returns a writer for a bitstream of the given bits. The writer has to be finished before anything else
+            // is written
+            bit_writer write_bits(std::size_t bit_count) { return bit_writer{reserve((bit_count + 7) / 8)}; }
+
+            // Writes the mask of the fields that a delta frame of a message with the given field_count carries as its
+            // presence bitmap
+            binary_encoder& write_presence(std::uint64_t mask, std::size_t field_count)
+            {
+                runtime::write_presence(mask, field_count, reserve(presence_size(field_count)));
+                return *this;
+            }
+
+            // Returns everything that has been written
+            std::span<std::uint8_t const> bytes() const noexcept { return _buffer; }
+
+            // Discards everything that has been written but keeps the buffer's capacity
+            void clear() noexcept { _buffer.clear(); }
+
+          private:
+            // Grows the buffer by size bytes and returns where they start
+            std::uint8_t* reserve(std::size_t size)
+            {
+                auto const offset = _buffer.size();
+                _buffer.resize(offset + size);
+                return _buffer.data() + offset;
+            }
+
+            // Writes the given values with encode, which takes at most MAX_VARINT_SIZE bytes per value, and gives back
+            // the bytes that it didn't use
+            template <typename T, typename Encode> void write_varints(std::span<T const> values, Encode encode)
+            {
+                auto const offset = _buffer.size();
+                auto const size = encode(values, reserve(values.size() * MAX_VARINT_SIZE));
+                _buffer.resize(offset + size);
+            }
+
+            std::vector<std::uint8_t> _buffer;
+        };
+
+        // Reads what a binary_encoder wrote from an input buffer. A read that runs past the end of the input or finds
+        // an invalid value marks the decoder as failed, every read after that leaves its target untouched
+        class binary_decoder
+        {
+          public:
+            // Constructs a decoder that reads from the given input
+            explicit binary_decoder(std::span<std::uint8_t const> input) noexcept
+              : _position{input.data()}, _end{input.data() + input.size()}
+            {
+            }
+
+            template <bulk_element T> binary_decoder& operator>>(T& out_value) noexcept
+            {
+                if (auto const* in = consume(sizeof(T)))
+                    decode_bulk(in, _end, std::span<T>{&out_value, 1});
+
+                return *this;
+            }
+
+            binary_decoder& operator>>(bool& out_value) noexcept
+            {
+                std::uint8_t byte = 0;
+                *this >> byte;
+                if (byte > 1)
+                    fail();
+                else if (!_failed)
+                    out_value = byte != 0;
+
+                return *this;
+            }
+
+            // The length is checked against the input before anything is allocated, so a corrupt length can't cause
+            // a huge allocation
+            binary_decoder& operator>>(std::string& out_value)
+            {
+                std::uint32_t length = 0;
+                *this >> length;
+                if (auto const* in = consume(length); in != nullptr)
+                    out_value.assign(reinterpret_cast<char const*>(in), length);
+
+                return *this;
+            }
+
+            template <std::size_t OptionalCount>
+            binary_decoder& operator>>(presence_bits<OptionalCount>& out_presence) noexcept
+            {
+                if (auto const* in = consume(presence_bits<OptionalCount>::size))
+                    out_presence.decode(in, _end);
+
+                return *this;
+            }
+
+            // Reads an array that was written by operator<<
+            template <typename T, std::size_t Size> binary_decoder& operator>>(std::array<T, Size>& out_values)
+            {
+                if constexpr (bulk_element<T>)
+                    return read_bulk(out_values);
+                else
+                {
+                    for (std::size_t i = 0; i < Size && !_failed; ++i)
+                        *this >> out_values[i];
+
+                    return *this;
+                }
+            }
+
+            // Reads repeated values that were written by operator<<
+            template <typename T, typename Allocator>
+            binary_decoder& operator>>(std::vector<T, Allocator>& out_values)
+            {
+                if constexpr (bulk_element<T>)
+                    return read_bulk(out_values);
+                else
+                {
+                    if (!read_count(out_values))
+                        return *this;
+
+                    for (std::size_t i = 0; i < out_values.size() && !_failed; ++i)
+                    {
+                        // The elements of a std::vector<bool> can't be bound to a bool&
+                        if constexpr (std::is_same_v<T, bool>)
+                        {
+                            bool value = false;
+                            *this >> value;
+                            out_values[i] = value;
+                        }
+                        else
+                            *this >> out_values[i];
+                    }
+
+                    return *this;
+                }
+            }
+
+            // Reads an array that was written by write_bulk
+            template <bulk_element T, std::size_t Size>
+            binary_decoder& read_bulk(std::array<T, Size>& out_values) noexcept
+            {
+                if (auto const* in = consume(sizeof(T) * Size))
+                    decode_bulk(in, _end, std::span<T>{out_values});
+
+                return *this;
+            }
+
+            // Reads repeated values that were written by write_bulk
+            template <bulk_element T, typename Allocator>
+            binary_decoder& read_bulk(std::vector<T, Allocator>& out_values)
+            {
+                auto const read = _failed ? std::size_t{0} : decode_repeated_bulk(_position, _end, out_values);
+                if (read != 0)
+                    _position += read;
+                else
+                    fail();
+
+                return *this;
+            }
+
+            // Reads repeated values that were written by write_columns
+            template <typename Row, auto... Members>
+            binary_decoder& read_columns(soa_vector<Row, Members...>& out_values)
+            {
+                auto const read = _failed ? std::size_t{0} : decode_columns(_position, _end, out_values);
+                if (read != 0)
+                    _position += read;
+                else
+                    fail();
+
+                return *this;
+            }
+
+            // Reads an integer that was written by write_varint. A value outside of T fails the decoder
+            template <std::integral T> binary_decoder& read_varint(T& out_value) noexcept
+            {
+                return read_varints(std::span<T>{&out_value, 1}, narrow_varint<T>);
+            }
+
+            // Reads an array that was written by write_varint
+            template <std::integral T, std::size_t Size>
+            binary_decoder& read_varint(std::array<T, Size>& out_values) noexcept
+            {
+                return read_varints(std::span<T>{out_values}, narrow_varint<T>);
+            }
+
+            // Reads repeated integers that were written by write_varint
+            template <std::integral T, typename Allocator>
+            binary_decoder& read_varint(std::vector<T, Allocator>& out_values)
+            {
+                if (read_count(out_values))
+                    read_varints(std::span<T>{out_values}, narrow_varint<T>);
+
+                return *this;
+            }
+
+            // Reads a signed integer that was written by write_zigzag. A value outside of T fails the decoder
+            template <std::signed_integral T> binary_decoder& read_zigzag(T& out_value) noexcept
+            {
+                return read_varints(std::span<T>{&out_value, 1}, narrow_zigzag<T>);
+            }
+
+            // Reads an array that was written by write_zigzag
+            template <std::signed_integral T, std::size_t Size>
+            binary_decoder& read_zigzag(std::array<T, Size>& out_values) noexcept
+            {
+                return read_varints(std::span<T>{out_values}, narrow_zigzag<T>);
+            }
+
+            // Reads repeated signed integers that were written by write_zigzag
+            template <std::signed_integral T, typename Allocator>
+            binary_decoder& read_zigzag(std::vector<T, Allocator>& out_values)
+            {
+                if (read_count(out_values))
+                    read_varints(std::span<T>{out_values}, narrow_zigzag<T>);
+
+                return *this;
+            }
+
+            // Reads a float that was written by write_quantized. A value with bits beyond the given ones fails the
+            // decoder
+            binary_decoder& read_quantized(float& out_value, float min, float max, int bits) noexcept
+            {
+                auto const* in = consume(quantized_size(bits));
+                if (!in)
+                    return *this;
+
+                std::uint64_t quantized = 0;
+                for (std::size_t i = 0; i < quantized_size(bits); ++i)
+                    quantized |= std::uint64_t{in[i]} << (8 * i);
+
+                if (quantized >> bits != 0)
+                    fail();
+                else
+                    out_value = dequantize(quantized, min, max, bits);
+
+                return *this;
+            }
+
+            // Reads an array that was written by write_quantized
+            template <std::size_t Size>
+            binary_decoder& read_quantized(std::array<float, Size>& out_values, float min, float max, int bits) noexcept
+            {
+                for (auto& value : out_values)
+                    read_quantized(value, min, max, bits);
+
+                return *this;
+            }
+
+            // Reads repeated floats that were written by write_quantized
+            template <typename Allocator>
+            binary_decoder& read_quantized(std::vector<float, Allocator>& out_values, float min, float max, int bits)
+            {
+                if (read_count(out_values))
+                    for (auto& value : out_values)
+                        read_quantized(value, min, max, bits);
+
+                return *this;
+            }
+
+            // Reads a float that was written by write_fixed_point
+            binary_decoder& read_fixed_point(float& out_value, double step) noexcept
+            {
+                std::int64_t value = 0;
+                if (!read_zigzag(value).failed())
+                    out_value = from_fixed_point(value, step);
+
+                return *this;
+            }
+
+            // Reads an array that was written by write_fixed_point
+            template <std::size_t Size>
+            binary_decoder& read_fixed_point(std::array<float, Size>& out_values, double step) noexcept
+            {
+                for (auto& value : out_values)
+                    read_fixed_point(value, step);
+
+                return *this;
+            }
+
+            // Reads repeated floats that were written by write_fixed_point
+            template <typename Allocator>
+            binary_decoder& read_fixed_point(std::vector<float, Allocator>& out_values, double step)
+            {
+                if (read_count(out_values))
+                    for (auto& value : out_values)
+                        read_fixed_point(value, step);
+
+                return *this;
+            }
+
+            // Returns a reader for a bitstream of the given bits that was written by write_bits. If the input ends
+            // before the bitstream does, the decoder fails and the reader reads nothing
+            bit_reader read_bits(std::size_t bit_count) noexcept
+            {
+                auto const size = (bit_count + 7) / 8;
+                if (auto const* in = consume(size))
+                    return bit_reader{in, in + size};
+
+                bit_reader empty{_end, _end};
+                empty.fail();
+                return empty;
+            }
+
+            // Reads the mask of the fields of a delta frame that was written by write_presence. Fields beyond the
+            // given field_count fail the decoder
+            binary_decoder& read_presence(std::uint64_t& out_mask, std::size_t field_count) noexcept
+            {
+                std::uint64_t mask = 0;
+                if (auto const* in = consume(presence_size(field_count)))
+                    runtime::read_presence(in, _end, field_count, mask);
+                if (field_count < 64 && (mask >> field_count) != 0)
+                    fail();
+                if (!_failed)
+                    out_mask = mask;
+
+                return *this;
+            }
+
+            // Marks the input as invalid
+            void fail() noexcept
+            {
+                _failed = true;
+                _position = _end;
+            }
+
+            // Returns whether the input was invalid
+            bool failed() const noexcept { return _failed; }
+
+            // Returns the amount of bytes that haven't been read yet
+            std::size_t remaining() const noexcept { return static_cast<std::size_t>(_end - _position); }
+
+          private:
+            // Returns where the next size bytes start and skips them, or nullptr if the input ends before them
+            std::uint8_t const* consume(std::size_t size) noexcept
+            {
+                if (_failed || size > remaining())
+                {
+                    fail();
+                    return nullptr;
+                }
+
+                auto const* in = _position;
+                _position += size;
+                return in;
+            }
+
+            // Reads the 32 bit count of repeated values and resizes out_values to it. Every varint, string and
+            // generated type takes at least a byte, so a corrupt count fails before it can cause a huge allocation.
+            // Returns false if the decoder failed
+            template <typename T, typename Allocator> bool read_count(std::vector<T, Allocator>& out_values)
+            {
+                std::uint32_t count = 0;
+                *this >> count;
+                if (count > remaining())
+                    fail();
+                if (_failed)
+                    return false;
+
+                out_values.resize(count);
+                return true;
+            }
+
+            // Reads out_values.size() varints and narrows each with narrow
+            template <typename T, typename Narrow>
+            binary_decoder& read_varints(std::span<T> out_values, Narrow narrow) noexcept
+            {
+                if (_failed || out_values.empty())
+                    return *this;
+
+                if (auto const read = decode_narrowed_varints(_position, _end, out_values, narrow); read != 0)
+                    _position += read;
+                else
+                    fail();
+
+                return *this;
+            }
+
+            std::uint8_t const* _position;
+            std::uint8_t const* _end;
+            bool _failed = false;
+        };
+    }
+}
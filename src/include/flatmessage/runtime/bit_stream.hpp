@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "quantize.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Returns a mask of the lowest bits bits. bits has to be between 0 and 64
+        constexpr std::uint64_t low_bits(int bits) noexcept
+        {
+            return bits == 0 ? 0 : ~std::uint64_t{0} >> (64 - bits);
+        }
+
+        // Packs values of arbitrary bit widths tightly into bytes. Bits are collected in a register and stored a
+        // 64 bit word at a time in little endian order, so a value never costs more than a shift, an or and a rarely
+        // taken branch
+        class bit_writer
+        {
+          public:
+            // Constructs a writer that writes to out, which must have room for all written bits rounded up to bytes
+            explicit bit_writer(std::uint8_t* out) noexcept : _begin{out}, _out{out} {}
+
+            // Appends the lowest bits bits of value. bits has to be between 0 and 64
+            void write(std::uint64_t value, int bits) noexcept
+            {
+                value &= low_bits(bits);
+                _buffer |= value << _count;
+
+                _count += bits;
+                if (_count >= 64)
+                {
+                    store(_buffer);
+                    _count -= 64;
+
+                    // The bits of value that didn't fit into the word that was just stored
+                    _buffer = _count == 0 ? 0 : value >> (bits - _count);
+                }
+            }
+
+            // Appends a single bit
+            void write(bool value) noexcept { write(value ? 1u : 0u, 1); }
+
+            // Writes the bits that are still buffered and returns the amount of bytes written in total. The writer
+            // must not be used afterwards
+            std::size_t finish() noexcept
+            {
+                for (; _count > 0; _count -= 8)
+                {
+                    *_out++ = static_cast<std::uint8_t>(_buffer);
+                    _buffer >>= 8;
+                }
+
+                _count = 0;
+                return static_cast<std::size_t>(_out - _begin);
+            }
+
+          private:
+            void store(std::uint64_t word) noexcept
+            {
+                if constexpr (std::endian::native == std::endian::big)
+                    word = std::byteswap(word);
+
+                std::memcpy(_out, &word, sizeof(word));
+                _out += sizeof(word);
+            }
+
+            std::uint8_t* _begin;
+            std::uint8_t* _out;
+            std::uint64_t _buffer = 0;
+            int _count = 0;
+        };
+
+        // Reads values that were written by a bit_writer, a 64 bit word at a time
+        class bit_reader
+        {
+          public:
+            // Constructs a reader that reads from [in, end)
+            bit_reader(std::uint8_t const* in, std::uint8_t const* end) noexcept : _in{in}, _end{end} {}
+
+            // Reads the next bits bits. bits has to be between 0 and 64. Returns 0 and marks the reader as failed if
+            // the input ends before
+            std::uint64_t read(int bits) noexcept
+            {
+                if (bits <= _count)
+                {
+                    auto value = _buffer & low_bits(bits);
+                    _buffer = bits == 64 ? 0 : _buffer >> bits;
+                    _count -= bits;
+                    return value;
+                }
+
+                // The value starts with the buffered bits and continues in the next word
+                std::uint64_t word;
+                auto const loaded = load(word);
+                auto const missing = bits - _count;
+                if (loaded < missing)
+                {
+                    _failed = true;
+                    _count = 0;
+                    return 0;
+                }
+
+                auto value = (_buffer | (word << _count)) & low_bits(bits);
+                _buffer = missing == 64 ? 0 : word >> missing;
+                _count = loaded - missing;
+                return value;
+            }
+
+            // Reads a single bit
+            bool read_bool() noexcept { return read(1) != 0; }
+
+            // Marks the input as invalid, every read after that returns 0
+            void fail() noexcept
+            {
+                _failed = true;
+                _count = 0;
+                _in = _end;
+            }
+
+            // Returns whether a read went past the end of the input or the input was marked as invalid
+            bool failed() const noexcept { return _failed; }
+
+          private:
+            // Reads the next word of the input into out_word and returns how many of its bits are valid
+            int load(std::uint64_t& out_word) noexcept
+            {
+                if (_end - _in >= 8)
+                {
+                    std::memcpy(&out_word, _in, sizeof(out_word));
+                    if constexpr (std::endian::native == std::endian::big)
+                        out_word = std::byteswap(out_word);
+
+                    _in += sizeof(out_word);
+                    return 64;
+                }
+
+                out_word = 0;
+                int loaded = 0;
+                for (; _in < _end; loaded += 8)
+                    out_word |= static_cast<std::uint64_t>(*_in++) << loaded;
+
+                return loaded;
+            }
+
+            std::uint8_t const* _in;
+            std::uint8_t const* _end;
+            std::uint64_t _buffer = 0;
+            int _count = 0;
+            bool _failed = false;
+        };
+
+        // Appends a bool, an enum or an integer as its distance to offset in the given bits, which have to cover the
+        // distances of all of its valid values
+        template <typename T> void pack(bit_writer& writer, T value, std::int64_t offset, int bits) noexcept
+        {
+            std::int64_t integer;
+            if constexpr (std::is_enum_v<T>)
+                integer = static_cast<std::int64_t>(std::to_underlying(value));
+            else
+                integer = static_cast<std::int64_t>(value);
+
+            writer.write(static_cast<std::uint64_t>(integer) - static_cast<std::uint64_t>(offset), bits);
+        }
+
+        // Stores integer in out_value, or fails the reader if T can't represent it
+        template <typename T> void store_unpacked(bit_reader& reader, T& out_value, std::int64_t integer) noexcept
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                out_value = integer != 0;
+            else if constexpr (std::is_enum_v<T>)
+            {
+                if (std::in_range<std::underlying_type_t<T>>(integer))
+                    out_value = static_cast<T>(integer);
+                else
+                    reader.fail();
+            }
+            else if (std::in_range<T>(integer))
+                out_value = static_cast<T>(integer);
+            else
+                reader.fail();
+        }
+
+        // Reads a value that was written by pack with min as offset. A value above max or outside of T fails the
+        // reader, a failed reader leaves out_value untouched
+        template <typename T>
+        void unpack(bit_reader& reader, T& out_value, std::int64_t min, std::int64_t max, int bits) noexcept
+        {
+            auto const distance = reader.read(bits);
+            if (reader.failed())
+                return;
+
+            auto const offset = static_cast<std::uint64_t>(min);
+            if (distance > static_cast<std::uint64_t>(max) - offset)
+                reader.fail();
+            else
+                store_unpacked(reader, out_value, static_cast<std::int64_t>(distance + offset));
+        }
+
+        // Reads an enum that was written by pack with min as offset. A value that isn't one of the enumerators fails
+        // the reader, a failed reader leaves out_value untouched
+        template <typename T>
+        void unpack(bit_reader& reader, T& out_value, std::int64_t min, std::initializer_list<std::int64_t> enumerators,
+                    int bits) noexcept
+        {
+            auto const integer = static_cast<std::int64_t>(reader.read(bits) + static_cast<std::uint64_t>(min));
+            if (reader.failed())
+                return;
+
+            if (std::find(enumerators.begin(), enumerators.end(), integer) == enumerators.end())
+                reader.fail();
+            else
+                store_unpacked(reader, out_value, integer);
+        }
+
+        // Appends a float quantized to the given bits
+        inline void pack_quantized(bit_writer& writer, float value, float min, float max, int bits) noexcept
+        {
+            writer.write(quantize(value, min, max, bits), bits);
+        }
+
+        // Reads a float that was written by pack_quantized. A failed reader leaves out_value untouched
+        inline void unpack_quantized(bit_reader& reader, float& out_value, float min, float max, int bits) noexcept
+        {
+            auto const quantized = reader.read(bits);
+            if (!reader.failed())
+                out_value = dequantize(quantized, min, max, bits);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "bulk.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Serializes a message or data straight into its output buffer while its attributes are set, without an
+        // intermediate object. The encoding starts with the in place region, which holds the presence bitmap and the
+        // attributes at fixed offsets that may be set in any order. Every other attribute is appended behind it in
+        // declaration order. Generated builders wrap it with one setter per attribute, whose setters of appended
+        // attributes call begin_append before they append. Writes that don't fit the buffer and appended attributes
+        // that are set out of order mark the builder as failed
+        class wire_builder
+        {
+          public:
+            // Constructs a builder that writes to buffer and whose in place region has in_place_size bytes
+            wire_builder(std::span<std::uint8_t> buffer, std::size_t in_place_size) noexcept
+              : _buffer{buffer}, _end{in_place_size}
+            {
+                if (in_place_size > buffer.size())
+                {
+                    _failed = true;
+                    _end = 0;
+                }
+                else
+                    std::memset(buffer.data(), 0, in_place_size);
+            }
+
+            // Writes a value at the given offset of the in place region
+            template <bulk_element T> void set(std::size_t offset, T value) noexcept
+            {
+                if (!_failed)
+                    encode_bulk(std::span<T const>{&value, 1}, _buffer.data() + offset);
+            }
+
+            // Writes an array at the given offset of the in place region
+            template <bulk_element T, std::size_t Extent>
+            void set(std::size_t offset, std::span<T const, Extent> values) noexcept
+            {
+                if (!_failed)
+                    encode_bulk(std::span<T const>{values}, _buffer.data() + offset);
+            }
+
+            // Marks the optional attribute with the given presence index as present
+            void set_present(std::size_t index) noexcept
+            {
+                if (_failed)
+                    return;
+
+                auto& byte = _buffer[index / 32 * 4 + index % 32 / 8];
+                byte = static_cast<std::uint8_t>(byte | (1u << (index % 8)));
+            }
+
+            // Starts appending the attribute with the given index, which numbers the appended attributes of the
+            // message or data in declaration order. Attributes may be skipped, e.g. absent optional ones, but an
+            // attribute that is set after a later one or set twice would corrupt the encoding and fails the builder
+            void begin_append(std::size_t index) noexcept
+            {
+                if (index < _next_append)
+                    _failed = true;
+                else
+                    _next_append = index + 1;
+            }
+
+            // Appends a value at its full width
+            template <bulk_element T> void append(T value) noexcept
+            {
+                if (auto* out = reserve(sizeof(T)))
+                    encode_bulk(std::span<T const>{&value, 1}, out);
+            }
+
+            // Appends an array, whose elements are written without a count
+            template <bulk_element T, std::size_t Extent> void append_array(std::span<T const, Extent> values) noexcept
+            {
+                if (auto* out = reserve(values.size_bytes()))
+                    encode_bulk(std::span<T const>{values}, out);
+            }
+
+            // Appends a repeated attribute as 32 bit count followed by its elements
+            template <bulk_element T> void append_repeated(std::span<T const> values) noexcept
+            {
+                append(static_cast<std::uint32_t>(values.size()));
+                append_array(values);
+            }
+
+            // Appends a string as 32 bit length followed by its characters
+            void append(std::string_view value) noexcept
+            {
+                append(static_cast<std::uint32_t>(value.size()));
+                if (auto* out = reserve(value.size()); out != nullptr && !value.empty())
+                    std::memcpy(out, value.data(), value.size());
+            }
+
+            // Returns the encoding or an empty span if it didn't fit the buffer
+            std::span<std::uint8_t const> finish() const noexcept
+            {
+                return _failed ? std::span<std::uint8_t const>{} : std::span<std::uint8_t const>{_buffer.data(), _end};
+            }
+
+            // Returns whether a write didn't fit the buffer
+            bool failed() const noexcept { return _failed; }
+
+          private:
+            // Returns where the next size bytes are appended or nullptr if they don't fit
+            std::uint8_t* reserve(std::size_t size) noexcept
+            {
+                if (_failed || size > _buffer.size() - _end)
+                {
+                    _failed = true;
+                    return nullptr;
+                }
+
+                auto* out = _buffer.data() + _end;
+                _end += size;
+                return out;
+            }
+
+            std::span<std::uint8_t> _buffer;
+            std::size_t _end;
+            std::size_t _next_append = 0;
+            bool _failed = false;
+        };
+    }
+}
@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Element types that are written as their plain little endian bytes, so that arrays and repeated attributes of
+        // them can be copied in bulk. Bools are excluded since every byte that is read has to be validated
+        template <typename T>
+        concept bulk_element = ((std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) || std::is_enum_v<T>) &&
+                               (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+        // Copies count elements of Size bytes from in to out while reversing the bytes of each element. Written as a
+        // plain loop over whole words, which compilers turn into vector shuffles
+        template <std::size_t Size>
+        void swap_bytes(std::uint8_t const* in, std::size_t count, std::uint8_t* out) noexcept
+        {
+            using word = std::conditional_t<Size == 2, std::uint16_t,
+                                            std::conditional_t<Size == 4, std::uint32_t, std::uint64_t>>;
+            static_assert(sizeof(word) == Size);
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                word value;
+                std::memcpy(&value, in + i * Size, Size);
+                value = std::byteswap(value);
+                std::memcpy(out + i * Size, &value, Size);
+            }
+        }
+
+        // Writes the given values to out, which must have room for values.size_bytes() bytes. Returns the amount of
+        // bytes written
+        template <bulk_element T> std::size_t encode_bulk(std::span<T const> values, std::uint8_t* out) noexcept
+        {
+            auto const* in = reinterpret_cast<std::uint8_t const*>(values.data());
+            if constexpr (sizeof(T) == 1 || std::endian::native == std::endian::little)
+            {
+                if (!values.empty())
+                    std::memcpy(out, in, values.size_bytes());
+            }
+            else
+                swap_bytes<sizeof(T)>(in, values.size(), out);
+
+            return values.size_bytes();
+        }
+
+        // Reads out_values.size() values from [in, end) into out_values. Returns the amount of bytes read or 0 if the
+        // input ends before the values do
+        template <bulk_element T>
+        std::size_t decode_bulk(std::uint8_t const* in, std::uint8_t const* end, std::span<T> out_values) noexcept
+        {
+            if (static_cast<std::size_t>(end - in) < out_values.size_bytes())
+                return 0;
+
+            auto* out = reinterpret_cast<std::uint8_t*>(out_values.data());
+            if constexpr (sizeof(T) == 1 || std::endian::native == std::endian::little)
+            {
+                if (!out_values.empty())
+                    std::memcpy(out, in, out_values.size_bytes());
+            }
+            else
+                swap_bytes<sizeof(T)>(in, out_values.size(), out);
+
+            return out_values.size_bytes();
+        }
+
+        // Writes the given repeated values as 32 bit little endian count followed by the values to out, which must
+        // have room for 4 + values.size() * sizeof(T) bytes. Returns the amount of bytes written
+        template <bulk_element T, typename Allocator>
+        std::size_t encode_repeated_bulk(std::vector<T, Allocator> const& values, std::uint8_t* out) noexcept
+        {
+            auto count = static_cast<std::uint32_t>(values.size());
+            if constexpr (std::endian::native == std::endian::big)
+                count = std::byteswap(count);
+
+            std::memcpy(out, &count, sizeof(count));
+            return sizeof(count) + encode_bulk(std::span<T const>{values}, out + sizeof(count));
+        }
+
+        // Reads repeated values that were written by encode_repeated_bulk from [in, end) into out_values. Returns the
+        // amount of bytes read or 0 if the input ends before the values do. The count is checked against the input
+        // before anything is allocated, so a corrupt count can't cause a huge allocation
+        template <bulk_element T, typename Allocator>
+        std::size_t decode_repeated_bulk(std::uint8_t const* in, std::uint8_t const* end,
+                                         std::vector<T, Allocator>& out_values)
+        {
+            std::uint32_t count;
+            if (end - in < static_cast<std::ptrdiff_t>(sizeof(count)))
+                return 0;
+
+            std::memcpy(&count, in, sizeof(count));
+            if constexpr (std::endian::native == std::endian::big)
+                count = std::byteswap(count);
+
+            in += sizeof(count);
+            if (static_cast<std::size_t>(end - in) / sizeof(T) < count)
+                return 0;
+
+            out_values.resize(count);
+            return sizeof(count) + decode_bulk(in, end, std::span<T>{out_values});
+        }
+    }
+}
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Holds the cold attributes of a [split] message or data in a separate allocation, so that an array of such
+        // types only walks over their hot attributes. The block is allocated on the first write access, reading a
+        // block that was never written yields the default values without allocating. Copies are deep
+        template <typename T> class cold_block
+        {
+          public:
+            cold_block() noexcept = default;
+
+            cold_block(cold_block const& other) : _value{other._value ? std::make_unique<T>(*other._value) : nullptr}
+            {
+            }
+
+            cold_block(cold_block&& other) noexcept = default;
+
+            cold_block& operator=(cold_block const& other)
+            {
+                if (this != &other)
+                    _value = other._value ? std::make_unique<T>(*other._value) : nullptr;
+
+                return *this;
+            }
+
+            cold_block& operator=(cold_block&& other) noexcept = default;
+
+            // Returns the cold attributes for writing, allocating them in their default state if necessary
+            T& get()
+            {
+                if (!_value)
+                    _value = std::make_unique<T>();
+
+                return *_value;
+            }
+
+            // Returns the cold attributes for reading
+            T const& get() const noexcept { return _value ? *_value : default_value(); }
+
+            T* operator->() { return &get(); }
+            T const* operator->() const noexcept { return &get(); }
+
+            // Returns whether the block has been allocated
+            bool is_allocated() const noexcept { return _value != nullptr; }
+
+            // Frees the block, which returns all cold attributes to their default values
+            void reset() noexcept { _value.reset(); }
+
+          private:
+            static T const& default_value() noexcept
+            {
+                static T const value{};
+                return value;
+            }
+
+            std::unique_ptr<T> _value;
+        };
+    }
+}
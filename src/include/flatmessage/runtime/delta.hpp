@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Tracks which fields of a [delta] message changed. Generated setters mark their field, the sender takes the
+        // mask whenever it sends the message
+        template <std::size_t FieldCount> class dirty_fields
+        {
+            static_assert(FieldCount <= 64, "dirty fields are tracked in a 64 bit mask");
+
+          public:
+            // A mask with the bits of all fields set
+            static constexpr std::uint64_t all = FieldCount == 64 ? ~std::uint64_t{0}
+                                                                  : (std::uint64_t{1} << FieldCount) - 1;
+
+            // Marks the field with the given index as changed
+            constexpr void mark(std::size_t index) noexcept { _mask |= std::uint64_t{1} << index; }
+
+            // Marks every field as changed
+            constexpr void mark_all() noexcept { _mask = all; }
+
+            // Returns whether the field with the given index changed
+            constexpr bool is_dirty(std::size_t index) const noexcept { return (_mask >> index) & 1; }
+
+            // Returns the mask of all changed fields
+            constexpr std::uint64_t mask() const noexcept { return _mask; }
+
+            // Returns the mask of all changed fields and clears it
+            constexpr std::uint64_t take() noexcept
+            {
+                auto mask = _mask;
+                _mask = 0;
+                return mask;
+            }
+
+          private:
+            std::uint64_t _mask = 0;
+        };
+
+        // Returns the amount of bytes of the presence bitmap of a message with the given field_count
+        constexpr std::size_t presence_size(std::size_t field_count) noexcept
+        {
+            return (field_count + 7) / 8;
+        }
+
+        // Writes the presence bitmap of a message with the given field_count to out and returns the position behind it
+        inline std::uint8_t* write_presence(std::uint64_t mask, std::size_t field_count, std::uint8_t* out) noexcept
+        {
+            for (std::size_t i = 0; i < presence_size(field_count); ++i)
+                *out++ = static_cast<std::uint8_t>(mask >> (i * 8));
+
+            return out;
+        }
+
+        // Reads the presence bitmap of a message with the given field_count from [in, end) into out_mask. Returns the
+        // position behind it or nullptr if the input is too short
+        inline std::uint8_t const* read_presence(std::uint8_t const* in, std::uint8_t const* end,
+                                                 std::size_t field_count, std::uint64_t& out_mask) noexcept
+        {
+            auto size = presence_size(field_count);
+            if (static_cast<std::size_t>(end - in) < size)
+                return nullptr;
+
+            out_mask = 0;
+            for (std::size_t i = 0; i < size; ++i)
+                out_mask |= static_cast<std::uint64_t>(*in++) << (i * 8);
+
+            return in;
+        }
+
+        // Calls f with the index of every field in the given mask, in ascending order
+        template <typename F> void for_each_field(std::uint64_t mask, F&& f)
+        {
+            for (; mask != 0; mask &= mask - 1)
+                f(static_cast<std::size_t>(std::countr_zero(mask)));
+        }
+
+        // Describes one delta encoded send of a message
+        struct delta_frame
+        {
+            // Numbers the sends of the message, starting at 1
+            std::uint32_t sequence;
+            // The sequence of the send that the delta is relative to or 0 if the frame carries every field
+            std::uint32_t baseline;
+            // The fields that the frame carries
+            std::uint64_t fields;
+        };
+
+        // The sender's side of a stream of delta encoded messages. It records which fields changed with every send, so
+        // that a delta against the last send that the receiver acknowledged covers exactly the fields that changed
+        // since then, no matter which sends in between got lost. History has to match the receiver's
+        template <std::size_t History = 64> class delta_sender
+        {
+          public:
+            // Starts the next send of a message whose fields in dirty changed since the previous send. all_fields is
+            // the mask of all of its fields
+            delta_frame next(std::uint64_t dirty, std::uint64_t all_fields) noexcept
+            {
+                auto sequence = ++_sequence;
+                _changes[sequence % History] = dirty;
+
+                // Without an acknowledged send, or with one that the receiver may have forgotten, everything is sent
+                if (_acknowledged == 0 || sequence - _acknowledged >= History)
+                    return {sequence, 0, all_fields};
+
+                std::uint64_t fields = 0;
+                for (auto s = _acknowledged + 1; s <= sequence; ++s)
+                    fields |= _changes[s % History];
+
+                return {sequence, _acknowledged, fields};
+            }
+
+            // Marks the send with the given sequence as received. Deltas are relative to the newest received send
+            void acknowledge(std::uint32_t sequence) noexcept
+            {
+                if (sequence > _acknowledged && sequence <= _sequence)
+                    _acknowledged = sequence;
+            }
+
+            // Forgets every acknowledgement, so that the next send carries every field again
+            void reset() noexcept { _acknowledged = 0; }
+
+            // Returns the sequence of the newest acknowledged send or 0 if there is none
+            std::uint32_t acknowledged() const noexcept { return _acknowledged; }
+
+          private:
+            std::uint32_t _sequence = 0;
+            std::uint32_t _acknowledged = 0;
+            std::array<std::uint64_t, History> _changes{};
+        };
+
+        // The receiver's side of a stream of delta encoded messages. It keeps the states of the most recent sends, so
+        // that a delta can be applied to the baseline that the sender chose
+        template <typename Message, std::size_t History = 64> class delta_receiver
+        {
+          public:
+            // Returns the state that a frame with the given baseline is applied to or nullptr if it is unknown. A
+            // frame without a baseline is applied to a default constructed state
+            Message const* baseline(std::uint32_t sequence) const noexcept
+            {
+                if (sequence == 0)
+                    return &_empty;
+
+                auto& entry = _states[sequence % History];
+                return entry.sequence == sequence ? &entry.state : nullptr;
+            }
+
+            // Remembers the given state as the result of the send with the given sequence. A reordered send that is
+            // older than the history is ignored, so that it can't evict a newer state. Returns the sequence to
+            // acknowledge, which is the newest one received so far
+            std::uint32_t store(std::uint32_t sequence, Message const& state)
+            {
+                auto& entry = _states[sequence % History];
+                if ((sequence < _latest && _latest - sequence >= History) || entry.sequence > sequence)
+                    return _latest;
+
+                entry.sequence = sequence;
+                entry.state = state;
+
+                if (sequence > _latest)
+                    _latest = sequence;
+
+                return _latest;
+            }
+
+            // Returns the newest state or the default constructed state if nothing was received yet
+            Message const& latest() const noexcept { return *baseline(_latest); }
+
+          private:
+            struct entry
+            {
+                std::uint32_t sequence = 0;
+                Message state{};
+            };
+
+            std::array<entry, History> _states{};
+            Message _empty{};
+            std::uint32_t _latest = 0;
+        };
+    }
+}
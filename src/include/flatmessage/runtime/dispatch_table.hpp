@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        template <std::size_t Size, typename Signature> struct dispatch_table;
+
+        // A dense table that routes a message id to the function that handles the message with a single indexed call.
+        // Generated code fills it with one entry per id of a protocol and nullptr for unused ids
+        template <std::size_t Size, typename R, typename... Args> struct dispatch_table<Size, R(Args...)>
+        {
+            using handler_type = R (*)(Args...);
+
+            // Calls the handler of the given id with the given args. Returns false if there is no such handler and
+            // otherwise the result of handlers that return bool or true for all others
+            template <typename... CallArgs> constexpr bool dispatch(std::uint32_t id, CallArgs&&... args) const
+            {
+                if (id >= Size || !handlers[id])
+                    return false;
+
+                if constexpr (std::is_same_v<R, bool>)
+                    return handlers[id](std::forward<CallArgs>(args)...);
+
+                handlers[id](std::forward<CallArgs>(args)...);
+                return true;
+            }
+
+            // Returns whether there is a handler for the given id
+            constexpr bool contains(std::uint32_t id) const noexcept { return id < Size && handlers[id]; }
+
+            std::array<handler_type, Size> handlers;
+        };
+
+        // Decodes a Message from the given decoder and passes it on to the given handler. Returns what the handler
+        // returns
+        template <typename Message, typename Decoder, typename Handler> bool handle(Decoder& decoder, Handler& handler)
+        {
+            Message message;
+            decoder >> message;
+            return handler(message);
+        }
+    }
+}
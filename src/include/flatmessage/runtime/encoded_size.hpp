@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "quantize.hpp"
+#include "soa.hpp"
+#include "varint.hpp"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The size of the length prefix of strings and repeated attributes
+        constexpr std::size_t LENGTH_PREFIX_SIZE = 4;
+
+        // The size of the tag that precedes the alternative of a union
+        constexpr std::size_t UNION_TAG_SIZE = 1;
+
+        // Types whose every value has the same encoded size, like generated types with a fixed_size constant
+        template <typename T>
+        concept fixed_size_type = std::is_arithmetic_v<T> || std::is_enum_v<T> || requires {
+            {
+                T::fixed_size
+            } -> std::convertible_to<std::size_t>;
+        };
+
+        // Generated types whose encoded size depends on their value
+        template <typename T>
+        concept variable_size_type = requires(T const& value) {
+            {
+                value.encoded_size()
+            } -> std::convertible_to<std::size_t>;
+        };
+
+        // Returns the encoded size of every value of the given fixed size type
+        template <fixed_size_type T> constexpr std::size_t fixed_encoded_size() noexcept
+        {
+            if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+                return sizeof(T);
+            else
+                return T::fixed_size;
+        }
+
+        inline std::size_t encoded_size(std::string const& value) noexcept;
+        template <typename T, std::size_t Size> constexpr std::size_t encoded_size(std::array<T, Size> const& values);
+        template <typename T, typename Allocator> std::size_t encoded_size(std::vector<T, Allocator> const& values);
+        template <typename Row, auto... Members>
+        std::size_t encoded_size(soa_vector<Row, Members...> const& values) noexcept;
+        template <typename... Alternatives>
+        std::size_t encoded_size(std::variant<std::monostate, Alternatives...> const& value);
+
+        // Returns the encoded size of the given value of a builtin or generated type
+        template <typename T>
+            requires fixed_size_type<T> || variable_size_type<T>
+        constexpr std::size_t encoded_size(T const& value)
+        {
+            if constexpr (fixed_size_type<T>)
+                return fixed_encoded_size<T>();
+            else
+                return value.encoded_size();
+        }
+
+        // Returns the encoded size of the given string, which is written as length prefix followed by its characters
+        inline std::size_t encoded_size(std::string const& value) noexcept
+        {
+            return LENGTH_PREFIX_SIZE + value.size();
+        }
+
+        // Returns the encoded size of the given array, which is written as its elements
+        template <typename T, std::size_t Size> constexpr std::size_t encoded_size(std::array<T, Size> const& values)
+        {
+            if constexpr (fixed_size_type<T>)
+                return Size * fixed_encoded_size<T>();
+
+            std::size_t size = 0;
+            for (auto const& value : values)
+                size += encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given repeated values, which are written as length prefix followed by the
+        // values
+        template <typename T, typename Allocator> std::size_t encoded_size(std::vector<T, Allocator> const& values)
+        {
+            if constexpr (fixed_size_type<T>)
+                return LENGTH_PREFIX_SIZE + values.size() * fixed_encoded_size<T>();
+
+            std::size_t size = LENGTH_PREFIX_SIZE;
+            for (auto const& value : values)
+                size += encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given repeated values that are stored as structure of arrays, which are
+        // written as length prefix followed by their columns
+        template <typename Row, auto... Members>
+        std::size_t encoded_size(soa_vector<Row, Members...> const& values) noexcept
+        {
+            return LENGTH_PREFIX_SIZE + values.size() * (sizeof(member_type<Members>) + ...);
+        }
+
+        // Returns the encoded size of the given union, which is written as its tag followed by the alternative it
+        // holds. An empty union is only its tag
+        template <typename... Alternatives>
+        std::size_t encoded_size(std::variant<std::monostate, Alternatives...> const& value)
+        {
+            std::size_t size = UNION_TAG_SIZE;
+            std::visit(
+                [&](auto const& alternative) {
+                    if constexpr (!std::is_same_v<std::decay_t<decltype(alternative)>, std::monostate>)
+                        size += encoded_size(alternative);
+                },
+                value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given integer as varint
+        template <std::integral T> constexpr std::size_t varint_encoded_size(T value) noexcept
+        {
+            return varint_size(static_cast<std::uint64_t>(value));
+        }
+
+        // Returns the encoded size of the given array of integers as varints
+        template <std::integral T, std::size_t Size>
+        constexpr std::size_t varint_encoded_size(std::array<T, Size> const& values) noexcept
+        {
+            std::size_t size = 0;
+            for (auto value : values)
+                size += varint_encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given repeated integers as length prefix followed by the values as varints
+        template <std::integral T, typename Allocator>
+        std::size_t varint_encoded_size(std::vector<T, Allocator> const& values) noexcept
+        {
+            std::size_t size = LENGTH_PREFIX_SIZE;
+            for (auto value : values)
+                size += varint_encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given signed integer as zigzag encoded varint
+        template <std::signed_integral T> constexpr std::size_t zigzag_encoded_size(T value) noexcept
+        {
+            return varint_size(zigzag_encode(value));
+        }
+
+        // Returns the encoded size of the given array of signed integers as zigzag encoded varints
+        template <std::signed_integral T, std::size_t Size>
+        constexpr std::size_t zigzag_encoded_size(std::array<T, Size> const& values) noexcept
+        {
+            std::size_t size = 0;
+            for (auto value : values)
+                size += zigzag_encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given repeated signed integers as length prefix followed by the values as
+        // zigzag encoded varints
+        template <std::signed_integral T, typename Allocator>
+        std::size_t zigzag_encoded_size(std::vector<T, Allocator> const& values) noexcept
+        {
+            std::size_t size = LENGTH_PREFIX_SIZE;
+            for (auto value : values)
+                size += zigzag_encoded_size(value);
+
+            return size;
+        }
+
+        // Returns the encoded size of a float that is quantized to the given bits
+        constexpr std::size_t quantized_encoded_size(float, int bits) noexcept
+        {
+            return quantized_size(bits);
+        }
+
+        // Returns the encoded size of the given array of floats that are quantized to the given bits
+        template <std::size_t Size>
+        constexpr std::size_t quantized_encoded_size(std::array<float, Size> const&, int bits) noexcept
+        {
+            return Size * quantized_size(bits);
+        }
+
+        // Returns the encoded size of the given repeated floats as length prefix followed by the values quantized to
+        // the given bits
+        template <typename Allocator>
+        std::size_t quantized_encoded_size(std::vector<float, Allocator> const& values, int bits) noexcept
+        {
+            return LENGTH_PREFIX_SIZE + values.size() * quantized_size(bits);
+        }
+
+        // Returns the encoded size of the given float as fixed point number of the given step
+        inline std::size_t fixed_point_encoded_size(float value, double step) noexcept
+        {
+            return zigzag_encoded_size(to_fixed_point(value, step));
+        }
+
+        // Returns the encoded size of the given array of floats as fixed point numbers of the given step
+        template <std::size_t Size>
+        std::size_t fixed_point_encoded_size(std::array<float, Size> const& values, double step) noexcept
+        {
+            std::size_t size = 0;
+            for (auto value : values)
+                size += fixed_point_encoded_size(value, step);
+
+            return size;
+        }
+
+        // Returns the encoded size of the given repeated floats as length prefix followed by the values as fixed point
+        // numbers of the given step
+        template <typename Allocator>
+        std::size_t fixed_point_encoded_size(std::vector<float, Allocator> const& values, double step) noexcept
+        {
+            std::size_t size = LENGTH_PREFIX_SIZE;
+            for (auto value : values)
+                size += fixed_point_encoded_size(value, step);
+
+            return size;
+        }
+    }
+}
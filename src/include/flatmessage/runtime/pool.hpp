@@ -0,0 +1,118 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Types that generated [pooled] messages and data provide to return every attribute to its default value
+        template <typename T> concept resettable = requires(T& value) { value.reset(); };
+
+        // Containers that can be emptied while keeping their storage
+        template <typename T> concept clearable = requires(T& value) { value.clear(); };
+
+        // Returns the given attribute to its default state. Containers keep their capacity, so a pooled object that is
+        // reused does not allocate again for content of a similar size
+        template <typename T> void reset_value(T& value)
+        {
+            if constexpr (resettable<T>)
+                value.reset();
+            else if constexpr (clearable<T>)
+                value.clear();
+            else
+                value = T{};
+        }
+
+        // Returns the given attribute to the default value that the schema assigns to it
+        template <typename T, typename Default> void reset_value(T& value, Default&& default_value)
+        {
+            value = std::forward<Default>(default_value);
+        }
+
+        // A free list of objects of one type for each thread. Objects are taken from the list by acquire and are reset
+        // and put back when the returned handle is destroyed, so a steady stream of messages of one type stops hitting
+        // the allocator after the first few. An object may be released on another thread than the one that acquired
+        // it, it then joins the free list of the releasing thread
+        template <resettable T> class pool
+        {
+          public:
+            struct releaser
+            {
+                void operator()(T* value) const noexcept { release(value); }
+            };
+
+            using handle = std::unique_ptr<T, releaser>;
+
+            // The maximum amount of idle objects that a single thread keeps, objects beyond it are deleted
+            static constexpr std::size_t max_free = 64;
+
+            // Returns an object in its default state, which is either reused from the free list or newly allocated.
+            // Generated types get the default values of their schema from reset, new objects are therefore reset too
+            static handle acquire()
+            {
+                auto& list = free_list();
+                if (list.empty())
+                {
+                    handle value{new T{}};
+                    value->reset();
+                    return value;
+                }
+
+                auto* value = list.back().release();
+                list.pop_back();
+                return handle{value};
+            }
+
+            // Returns the amount of idle objects in the free list of the calling thread
+            static std::size_t free_count() noexcept { return free_list().size(); }
+
+            // Deletes all idle objects in the free list of the calling thread
+            static void trim() noexcept { free_list().clear(); }
+
+          private:
+            static std::vector<std::unique_ptr<T>>& free_list() noexcept
+            {
+                thread_local std::vector<std::unique_ptr<T>> list;
+                return list;
+            }
+
+            static void release(T* value) noexcept
+            {
+                std::unique_ptr<T> owned{value};
+                auto& list = free_list();
+                if (list.size() >= max_free)
+                    return;
+
+                owned->reset();
+                try
+                {
+                    list.push_back(std::move(owned));
+                }
+                catch (...)
+                {
+                }
+            }
+        };
+    }
+}
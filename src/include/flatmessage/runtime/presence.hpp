@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The presence bitmap of the optional attributes of a message or data. On the wire it precedes the fields as
+        // 32 bit little endian words with one bit per optional attribute in declaration order, and fields whose bit is
+        // clear are omitted. In memory it replaces one boost::optional per field: the fields are plain members and
+        // their presence is kept here
+        template <std::size_t OptionalCount> class presence_bits
+        {
+          public:
+            // The amount of words of the bitmap
+            static constexpr std::size_t words = (OptionalCount + 31) / 32;
+            // The amount of bytes of the bitmap on the wire
+            static constexpr std::size_t size = words * sizeof(std::uint32_t);
+
+            // Returns whether the optional attribute with the given index is present
+            constexpr bool test(std::size_t index) const noexcept { return (_words[index / 32] >> (index % 32)) & 1; }
+
+            // Marks the optional attribute with the given index as present or absent without branching on value
+            constexpr void set(std::size_t index, bool value = true) noexcept
+            {
+                auto& word = _words[index / 32];
+                auto const bit = std::uint32_t{1} << (index % 32);
+                word = (word & ~bit) | ((std::uint32_t{0} - static_cast<std::uint32_t>(value)) & bit);
+            }
+
+            // Marks the optional attribute with the given index as absent
+            constexpr void reset(std::size_t index) noexcept { set(index, false); }
+
+            // Returns the amount of present attributes
+            constexpr std::size_t count() const noexcept
+            {
+                std::size_t result = 0;
+                for (auto word : _words)
+                    result += static_cast<std::size_t>(std::popcount(word));
+
+                return result;
+            }
+
+            // Writes the bitmap to out, which must have room for size bytes. Returns the position behind it
+            std::uint8_t* encode(std::uint8_t* out) const noexcept
+            {
+                for (auto word : _words)
+                {
+                    if constexpr (std::endian::native == std::endian::big)
+                        word = std::byteswap(word);
+
+                    std::memcpy(out, &word, sizeof(word));
+                    out += sizeof(word);
+                }
+
+                return out;
+            }
+
+            // Reads the bitmap from [in, end). Returns the position behind it or nullptr if the input is too short.
+            // Bits behind the last optional attribute are ignored
+            std::uint8_t const* decode(std::uint8_t const* in, std::uint8_t const* end) noexcept
+            {
+                if (static_cast<std::size_t>(end - in) < size)
+                    return nullptr;
+
+                for (auto& word : _words)
+                {
+                    std::memcpy(&word, in, sizeof(word));
+                    if constexpr (std::endian::native == std::endian::big)
+                        word = std::byteswap(word);
+
+                    in += sizeof(word);
+                }
+
+                if constexpr (OptionalCount % 32 != 0)
+                    _words.back() &= (std::uint32_t{1} << (OptionalCount % 32)) - 1;
+
+                return in;
+            }
+
+          private:
+            std::array<std::uint32_t, words> _words{};
+        };
+    }
+}
@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // Maps value onto an unsigned integer of the given bits (between 1 and 32) that covers [min, max] in equal
+        // steps. Values outside of the range are clamped, NaN becomes min
+        inline std::uint32_t quantize(float value, float min, float max, int bits) noexcept
+        {
+            auto const steps = static_cast<double>((std::uint64_t{1} << bits) - 1);
+            auto const clamped = value >= min ? std::min(value, max) : min;
+            auto const normalized = (static_cast<double>(clamped) - min) / (static_cast<double>(max) - min);
+            return static_cast<std::uint32_t>(normalized * steps + 0.5);
+        }
+
+        // Returns the amount of bytes that a value quantized to the given bits occupies outside of a bitstream
+        constexpr std::size_t quantized_size(int bits) noexcept
+        {
+            return static_cast<std::size_t>(bits + 7) / 8;
+        }
+
+        // Reverses quantize. The result differs from the original value by at most half a step
+        inline float dequantize(std::uint64_t value, float min, float max, int bits) noexcept
+        {
+            auto const steps = static_cast<double>((std::uint64_t{1} << bits) - 1);
+            return static_cast<float>(min + (max - static_cast<double>(min)) * (value / steps));
+        }
+
+        // Returns the multiple of step that is closest to value. Multiples beyond int64 are clamped, NaN becomes 0
+        inline std::int64_t to_fixed_point(float value, double step) noexcept
+        {
+            // 2^63 is the smallest double above int64, -2^63 still fits
+            constexpr double limit = 9223372036854775808.0;
+
+            auto const multiple = std::round(value / step);
+            if (std::isnan(multiple))
+                return 0;
+            if (multiple >= limit)
+                return std::numeric_limits<std::int64_t>::max();
+            if (multiple < -limit)
+                return std::numeric_limits<std::int64_t>::min();
+
+            return static_cast<std::int64_t>(multiple);
+        }
+
+        // Reverses to_fixed_point
+        inline float from_fixed_point(std::int64_t value, double step) noexcept
+        {
+            return static_cast<float>(value * step);
+        }
+    }
+}
@@ -0,0 +1,260 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The size of a cache line. Indices that different threads write are kept this far apart so that they don't
+        // share a line
+        constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+        // A bounded lock-free queue of a single producer thread and a single consumer thread that stores its elements
+        // inline. Meant for messages whose generated type has a fixed_size, which are small and trivially copied.
+        // Capacity has to be a power of two
+        template <typename T, std::size_t Capacity> class spsc_queue
+        {
+            static_assert(std::has_single_bit(Capacity), "Capacity has to be a power of two");
+
+          public:
+            // Appends the given value. Returns false if the queue is full. Only called by the producer
+            bool try_push(T value) noexcept(std::is_nothrow_move_assignable_v<T>)
+            {
+                auto const tail = _tail.load(std::memory_order_relaxed);
+                if (tail - _cached_head == Capacity)
+                {
+                    _cached_head = _head.load(std::memory_order_acquire);
+                    if (tail - _cached_head == Capacity)
+                        return false;
+                }
+
+                _slots[tail & (Capacity - 1)] = std::move(value);
+                _tail.store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Moves the oldest value into out_value. Returns false if the queue is empty. Only called by the consumer
+            bool try_pop(T& out_value) noexcept(std::is_nothrow_move_assignable_v<T>)
+            {
+                auto const head = _head.load(std::memory_order_relaxed);
+                if (head == _cached_tail)
+                {
+                    _cached_tail = _tail.load(std::memory_order_acquire);
+                    if (head == _cached_tail)
+                        return false;
+                }
+
+                out_value = std::move(_slots[head & (Capacity - 1)]);
+                _head.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Returns the amount of values in the queue, which may already be outdated when it returns
+            std::size_t size_approx() const noexcept
+            {
+                return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+            }
+
+          private:
+            // The producer's index and its last view of the consumer's one, followed by the consumer's counterparts
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail{0};
+            std::size_t _cached_head = 0;
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _head{0};
+            std::size_t _cached_tail = 0;
+            alignas(CACHE_LINE_SIZE) std::array<T, Capacity> _slots{};
+        };
+
+        // A bounded lock-free queue of any amount of producer threads and a single consumer thread that stores its
+        // elements inline. Every slot carries a sequence number that tells whether it is free for the producer that
+        // claimed it or filled for the consumer. Capacity has to be a power of two
+        template <typename T, std::size_t Capacity> class mpsc_queue
+        {
+            static_assert(std::has_single_bit(Capacity), "Capacity has to be a power of two");
+
+          public:
+            mpsc_queue() noexcept
+            {
+                for (std::size_t i = 0; i < Capacity; ++i)
+                    _slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+            // Appends the given value. Returns false if the queue is full. Thread-safe
+            bool try_push(T value) noexcept(std::is_nothrow_move_assignable_v<T>)
+            {
+                auto tail = _tail.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    auto& slot = _slots[tail & (Capacity - 1)];
+                    auto const sequence = slot.sequence.load(std::memory_order_acquire);
+                    auto const distance = static_cast<std::ptrdiff_t>(sequence - tail);
+
+                    if (distance == 0)
+                    {
+                        if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                        {
+                            slot.value = std::move(value);
+                            slot.sequence.store(tail + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (distance < 0)
+                        return false;
+                    else
+                        tail = _tail.load(std::memory_order_relaxed);
+                }
+            }
+
+            // Moves the oldest value into out_value. Returns false if the queue is empty. Only called by the consumer
+            bool try_pop(T& out_value) noexcept(std::is_nothrow_move_assignable_v<T>)
+            {
+                auto& slot = _slots[_head & (Capacity - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != _head + 1)
+                    return false;
+
+                out_value = std::move(slot.value);
+                slot.sequence.store(_head + Capacity, std::memory_order_release);
+                ++_head;
+                return true;
+            }
+
+          private:
+            struct slot
+            {
+                std::atomic<std::size_t> sequence;
+                T value{};
+            };
+
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail{0};
+            alignas(CACHE_LINE_SIZE) std::size_t _head = 0;
+            alignas(CACHE_LINE_SIZE) std::array<slot, Capacity> _slots;
+        };
+
+        // A bounded lock-free queue of encoded frames of a single producer thread and a single consumer thread, for
+        // messages whose size varies. Frames are stored as 32 bit length followed by their bytes in a ring of Capacity
+        // bytes, padded to 8 bytes. A frame that doesn't fit before the end of the ring starts over at its beginning.
+        // Capacity has to be a power of two
+        template <std::size_t Capacity> class spsc_frame_queue
+        {
+            static_assert(std::has_single_bit(Capacity) && Capacity >= 16, "Capacity has to be a power of two");
+
+          public:
+            // The largest frame that fits the queue
+            static constexpr std::size_t max_frame_size = Capacity / 2 - sizeof(std::uint32_t);
+
+            // Appends a copy of the given frame. Returns false if the queue is too full or the frame larger than
+            // max_frame_size. Only called by the producer
+            bool try_push(std::span<std::uint8_t const> frame) noexcept
+            {
+                if (frame.size() > max_frame_size)
+                    return false;
+
+                auto tail = _tail.load(std::memory_order_relaxed);
+                auto const needed = padded(frame.size());
+                auto const until_end = Capacity - (tail & (Capacity - 1));
+                auto const wraps = needed > until_end;
+
+                if (!has_room(tail, wraps ? until_end + needed : needed))
+                    return false;
+
+                // The rest of the ring is skipped, which the consumer recognizes by the wrap marker
+                if (wraps)
+                {
+                    store_length(tail, wrap_marker);
+                    tail += until_end;
+                }
+
+                store_length(tail, static_cast<std::uint32_t>(frame.size()));
+                if (!frame.empty())
+                    std::memcpy(&_ring[(tail & (Capacity - 1)) + sizeof(std::uint32_t)], frame.data(), frame.size());
+
+                _tail.store(tail + needed, std::memory_order_release);
+                return true;
+            }
+
+            // Calls handler with a std::span<std::uint8_t const> of the oldest frame and removes it afterwards. Returns
+            // false if the queue is empty. The span is only valid during the call. Only called by the consumer
+            template <typename Handler> bool try_pop(Handler&& handler)
+            {
+                auto head = _head.load(std::memory_order_relaxed);
+                if (head == _cached_tail)
+                {
+                    _cached_tail = _tail.load(std::memory_order_acquire);
+                    if (head == _cached_tail)
+                        return false;
+                }
+
+                auto length = load_length(head);
+                if (length == wrap_marker)
+                {
+                    head += Capacity - (head & (Capacity - 1));
+                    length = load_length(head);
+                }
+
+                auto const offset = (head & (Capacity - 1)) + sizeof(std::uint32_t);
+                handler(std::span<std::uint8_t const>{&_ring[offset], length});
+                _head.store(head + padded(length), std::memory_order_release);
+                return true;
+            }
+
+          private:
+            static constexpr std::uint32_t wrap_marker = 0xffffffff;
+
+            static constexpr std::size_t padded(std::size_t size) noexcept
+            {
+                return (sizeof(std::uint32_t) + size + 7) & ~std::size_t{7};
+            }
+
+            bool has_room(std::size_t tail, std::size_t needed) noexcept
+            {
+                if (Capacity - (tail - _cached_head) >= needed)
+                    return true;
+
+                _cached_head = _head.load(std::memory_order_acquire);
+                return Capacity - (tail - _cached_head) >= needed;
+            }
+
+            void store_length(std::size_t position, std::uint32_t length) noexcept
+            {
+                std::memcpy(&_ring[position & (Capacity - 1)], &length, sizeof(length));
+            }
+
+            std::uint32_t load_length(std::size_t position) const noexcept
+            {
+                std::uint32_t length;
+                std::memcpy(&length, &_ring[position & (Capacity - 1)], sizeof(length));
+                return length;
+            }
+
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail{0};
+            std::size_t _cached_head = 0;
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _head{0};
+            std::size_t _cached_tail = 0;
+            alignas(CACHE_LINE_SIZE) std::array<std::uint8_t, Capacity> _ring;
+        };
+    }
+}
@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <utility>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // An encoded message that is immutable once it is created and shared by reference counting, so that a message
+        // that is broadcast is encoded once and every connection and thread holds the same bytes instead of a copy.
+        // Count and bytes live in a single allocation. Copies are thread-safe, the bytes are never written after
+        // creation
+        class shared_message
+        {
+          public:
+            shared_message() noexcept = default;
+
+            // Creates a message of at most max_size bytes that encode writes. encode is called with a
+            // std::span<std::uint8_t> of max_size bytes and returns the amount of bytes it wrote
+            template <typename Encode> static shared_message encode(std::size_t max_size, Encode&& encode)
+            {
+                shared_message message{allocate(max_size)};
+                message._header->size = std::forward<Encode>(encode)(std::span<std::uint8_t>{data(message._header),
+                                                                                               max_size});
+                return message;
+            }
+
+            // Creates a message that holds a copy of the given bytes
+            static shared_message copy_of(std::span<std::uint8_t const> bytes)
+            {
+                return encode(bytes.size(), [&](std::span<std::uint8_t> out) {
+                    if (!bytes.empty())
+                        std::memcpy(out.data(), bytes.data(), bytes.size());
+                    return bytes.size();
+                });
+            }
+
+            shared_message(shared_message const& other) noexcept : _header{other._header}
+            {
+                if (_header != nullptr)
+                    _header->references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            shared_message(shared_message&& other) noexcept : _header{std::exchange(other._header, nullptr)} {}
+
+            shared_message& operator=(shared_message other) noexcept
+            {
+                std::swap(_header, other._header);
+                return *this;
+            }
+
+            ~shared_message() { release(); }
+
+            // Returns the encoded bytes, which stay valid as long as any copy of this message exists
+            std::span<std::uint8_t const> bytes() const noexcept
+            {
+                return _header != nullptr ? std::span<std::uint8_t const>{data(_header), _header->size}
+                                          : std::span<std::uint8_t const>{};
+            }
+
+            // Returns the amount of copies that share the bytes. Only exact while no other thread copies or destroys
+            // one of them
+            std::size_t use_count() const noexcept
+            {
+                return _header != nullptr ? _header->references.load(std::memory_order_relaxed) : 0;
+            }
+
+            explicit operator bool() const noexcept { return _header != nullptr; }
+
+          private:
+            struct header
+            {
+                std::atomic<std::uint32_t> references{1};
+                std::size_t size = 0;
+            };
+
+            explicit shared_message(header* header) noexcept : _header{header} {}
+
+            static header* allocate(std::size_t size)
+            {
+                return new (::operator new(sizeof(header) + size)) header{};
+            }
+
+            static std::uint8_t* data(header* header) noexcept { return reinterpret_cast<std::uint8_t*>(header + 1); }
+
+            void release() noexcept
+            {
+                // The last owner has to see every write of the others before it frees the bytes
+                if (_header != nullptr && _header->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    _header->~header();
+                    ::operator delete(_header);
+                }
+
+                _header = nullptr;
+            }
+
+            header* _header = nullptr;
+        };
+    }
+}
@@ -0,0 +1,376 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "bulk.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The type of the attribute that the given pointer to a data member points to
+        template <auto Member> struct member_traits;
+
+        template <typename Class, typename T, T Class::*Member> struct member_traits<Member>
+        {
+            using type = T;
+        };
+
+        template <auto Member> using member_type = typename member_traits<Member>::type;
+
+        // Stores a repeated attribute of a data type as structure of arrays: every given attribute of Row lives in a
+        // contiguous column of its own, so that bulk operations over one attribute are vectorized. Reading an element
+        // gathers a Row, writing one scatters it, which makes the container a drop in replacement for the
+        // std::vector<Row> that a repeated attribute is stored as otherwise. All columns share one allocation and
+        // start at a cache line, so the container is as large as a std::vector
+        template <typename Row, auto... Members>
+            requires(sizeof...(Members) > 0 && (bulk_element<member_type<Members>> && ...))
+        class soa_vector
+        {
+            template <std::size_t I> using column_type = std::tuple_element_t<I, std::tuple<member_type<Members>...>>;
+
+            // Returns the index of the column of the given member
+            template <auto Member> static constexpr std::size_t column_index()
+            {
+                constexpr std::array<bool, sizeof...(Members)> matches{[] {
+                    if constexpr (std::is_same_v<decltype(Member), decltype(Members)>)
+                        return Member == Members;
+                    else
+                        return false;
+                }()...};
+
+                constexpr auto index = std::find(matches.begin(), matches.end(), true) - matches.begin();
+                static_assert(index < sizeof...(Members), "The member isn't a column");
+                return index;
+            }
+
+          public:
+            using value_type = Row;
+            using size_type = std::size_t;
+
+            // The alignment of every column
+            static constexpr std::size_t column_alignment = 64;
+
+            // Refers to an element for reading it as a whole, writing it as a whole or accessing one of its attributes
+            class reference
+            {
+              public:
+                reference(reference const& other) noexcept = default;
+
+                operator Row() const { return _owner->get(_index); }
+
+                reference& operator=(Row const& row)
+                {
+                    _owner->set(_index, row);
+                    return *this;
+                }
+
+                // Copies the element that other refers to instead of rebinding the reference, like assigning one
+                // element of a std::vector to another does
+                reference& operator=(reference const& other) { return *this = static_cast<Row>(other); }
+
+                template <auto Member> member_type<Member>& get() const
+                {
+                    return _owner->template column<Member>()[_index];
+                }
+
+              private:
+                friend class soa_vector;
+
+                reference(soa_vector* owner, std::size_t index) noexcept : _owner{owner}, _index{index} {}
+
+                soa_vector* _owner;
+                std::size_t _index;
+            };
+
+            // Iterates over the elements, yielding a reference or, if Const is set, a Row
+            template <bool Const> class basic_iterator
+            {
+                using owner_type = std::conditional_t<Const, soa_vector const, soa_vector>;
+
+              public:
+                using value_type = Row;
+                using difference_type = std::ptrdiff_t;
+
+                basic_iterator() noexcept = default;
+
+                auto operator*() const { return (*_owner)[_index]; }
+
+                basic_iterator& operator++() noexcept
+                {
+                    ++_index;
+                    return *this;
+                }
+
+                basic_iterator operator++(int) noexcept
+                {
+                    auto copy = *this;
+                    ++_index;
+                    return copy;
+                }
+
+                bool operator==(basic_iterator const& other) const noexcept { return _index == other._index; }
+
+              private:
+                friend class soa_vector;
+
+                basic_iterator(owner_type* owner, std::size_t index) noexcept : _owner{owner}, _index{index} {}
+
+                owner_type* _owner = nullptr;
+                std::size_t _index = 0;
+            };
+
+            using iterator = basic_iterator<false>;
+            using const_iterator = basic_iterator<true>;
+
+            soa_vector() noexcept = default;
+
+            soa_vector(soa_vector const& other) { *this = other; }
+
+            soa_vector(soa_vector&& other) noexcept
+              : _data{std::move(other._data)}, _size{std::exchange(other._size, 0)},
+                _capacity{std::exchange(other._capacity, 0)}
+            {
+            }
+
+            soa_vector& operator=(soa_vector const& other)
+            {
+                if (this == &other)
+                    return *this;
+
+                clear();
+                reserve(other._size);
+                _size = other._size;
+                copy_columns(other, *this, _size, std::index_sequence_for<decltype(Members)...>{});
+                return *this;
+            }
+
+            soa_vector& operator=(soa_vector&& other) noexcept
+            {
+                _data = std::move(other._data);
+                _size = std::exchange(other._size, 0);
+                _capacity = std::exchange(other._capacity, 0);
+                return *this;
+            }
+
+            std::size_t size() const noexcept { return _size; }
+            bool empty() const noexcept { return _size == 0; }
+            std::size_t capacity() const noexcept { return _capacity; }
+
+            // Makes room for at least the given amount of elements
+            void reserve(std::size_t capacity)
+            {
+                if (capacity <= _capacity)
+                    return;
+
+                soa_vector grown;
+                grown._data = allocate(capacity);
+                grown._capacity = capacity;
+                copy_columns(*this, grown, _size, std::index_sequence_for<decltype(Members)...>{});
+                grown._size = _size;
+                *this = std::move(grown);
+            }
+
+            // Changes the amount of elements. New elements are zeroed, like the value initialized elements that a
+            // std::vector adds
+            void resize(std::size_t size)
+            {
+                if (size > _capacity)
+                    reserve(std::max(size, _capacity * 2));
+
+                if (size > _size)
+                    zero_columns(_size, size, std::index_sequence_for<decltype(Members)...>{});
+
+                _size = size;
+            }
+
+            void clear() noexcept { _size = 0; }
+
+            void push_back(Row const& row)
+            {
+                if (_size == _capacity)
+                    reserve(std::max<std::size_t>(_capacity * 2, column_alignment));
+
+                set(_size++, row);
+            }
+
+            void pop_back() noexcept { --_size; }
+
+            // Gathers the element at the given index
+            Row get(std::size_t index) const
+            {
+                Row row{};
+                ((row.*Members = column<Members>()[index]), ...);
+                return row;
+            }
+
+            // Scatters the given row into the element at the given index
+            void set(std::size_t index, Row const& row) { ((column<Members>()[index] = row.*Members), ...); }
+
+            Row operator[](std::size_t index) const { return get(index); }
+            reference operator[](std::size_t index) { return {this, index}; }
+
+            Row front() const { return get(0); }
+            Row back() const { return get(_size - 1); }
+
+            iterator begin() noexcept { return {this, 0}; }
+            iterator end() noexcept { return {this, _size}; }
+            const_iterator begin() const noexcept { return {this, 0}; }
+            const_iterator end() const noexcept { return {this, _size}; }
+
+            // Returns the column of the given member
+            template <auto Member> std::span<member_type<Member>> column() noexcept
+            {
+                return {column_data<column_index<Member>()>(_data.get(), _capacity), _size};
+            }
+
+            template <auto Member> std::span<member_type<Member> const> column() const noexcept
+            {
+                return {column_data<column_index<Member>()>(_data.get(), _capacity), _size};
+            }
+
+            // Returns the column of the given index, the columns are numbered in the order of the members
+            template <std::size_t I> std::span<column_type<I>> column_at() noexcept
+            {
+                return {column_data<I>(_data.get(), _capacity), _size};
+            }
+
+            template <std::size_t I> std::span<column_type<I> const> column_at() const noexcept
+            {
+                return {column_data<I>(_data.get(), _capacity), _size};
+            }
+
+            friend bool operator==(soa_vector const& lhs, soa_vector const& rhs) noexcept
+            {
+                return lhs._size == rhs._size
+                       && (std::ranges::equal(lhs.template column<Members>(), rhs.template column<Members>()) && ...);
+            }
+
+          private:
+            struct deallocate
+            {
+                void operator()(std::byte* data) const noexcept
+                {
+                    ::operator delete[](data, std::align_val_t{column_alignment});
+                }
+            };
+
+            // Returns the offset of the column of the given index inside an allocation for the given capacity
+            template <std::size_t I> static constexpr std::size_t column_offset(std::size_t capacity) noexcept
+            {
+                if constexpr (I == 0)
+                    return 0;
+                else
+                {
+                    auto end = column_offset<I - 1>(capacity) + capacity * sizeof(column_type<I - 1>);
+                    return (end + column_alignment - 1) / column_alignment * column_alignment;
+                }
+            }
+
+            template <std::size_t I> static column_type<I>* column_data(std::byte* data, std::size_t capacity) noexcept
+            {
+                return data ? reinterpret_cast<column_type<I>*>(data + column_offset<I>(capacity)) : nullptr;
+            }
+
+            static std::unique_ptr<std::byte[], deallocate> allocate(std::size_t capacity)
+            {
+                auto size = column_offset<sizeof...(Members)>(capacity);
+                auto* data = static_cast<std::byte*>(::operator new[](size, std::align_val_t{column_alignment}));
+                return std::unique_ptr<std::byte[], deallocate>{data};
+            }
+
+            template <std::size_t... I>
+            static void copy_columns(soa_vector const& from, soa_vector& to, std::size_t count,
+                                     std::index_sequence<I...>) noexcept
+            {
+                if (count != 0)
+                    (std::memcpy(column_data<I>(to._data.get(), to._capacity),
+                                 column_data<I>(from._data.get(), from._capacity), count * sizeof(column_type<I>)),
+                     ...);
+            }
+
+            template <std::size_t... I>
+            void zero_columns(std::size_t first, std::size_t last, std::index_sequence<I...>) noexcept
+            {
+                (std::fill(column_data<I>(_data.get(), _capacity) + first,
+                           column_data<I>(_data.get(), _capacity) + last, column_type<I>{}),
+                 ...);
+            }
+
+            std::unique_ptr<std::byte[], deallocate> _data;
+            std::size_t _size = 0;
+            std::size_t _capacity = 0;
+        };
+
+        // Writes the given values as 32 bit little endian count followed by one column after the other to out, which
+        // must have room for 4 + values.size() bytes per byte of a row. Returns the amount of bytes written
+        template <typename Row, auto... Members>
+        std::size_t encode_columns(soa_vector<Row, Members...> const& values, std::uint8_t* out) noexcept
+        {
+            auto count = static_cast<std::uint32_t>(values.size());
+            if constexpr (std::endian::native == std::endian::big)
+                count = std::byteswap(count);
+
+            std::memcpy(out, &count, sizeof(count));
+
+            std::size_t written = sizeof(count);
+            ((written += encode_bulk(values.template column<Members>(), out + written)), ...);
+            return written;
+        }
+
+        // Reads values that were written by encode_columns from [in, end) into out_values. Returns the amount of bytes
+        // read or 0 if the input ends before the values do. The count is checked against the input before anything is
+        // allocated, so a corrupt count can't cause a huge allocation
+        template <typename Row, auto... Members>
+        std::size_t decode_columns(std::uint8_t const* in, std::uint8_t const* end,
+                                   soa_vector<Row, Members...>& out_values)
+        {
+            std::uint32_t count;
+            if (end - in < static_cast<std::ptrdiff_t>(sizeof(count)))
+                return 0;
+
+            std::memcpy(&count, in, sizeof(count));
+            if constexpr (std::endian::native == std::endian::big)
+                count = std::byteswap(count);
+
+            constexpr std::size_t row_size = (sizeof(member_type<Members>) + ...);
+            in += sizeof(count);
+            if (static_cast<std::size_t>(end - in) / row_size < count)
+                return 0;
+
+            out_values.clear();
+            out_values.resize(count);
+
+            std::size_t read = 0;
+            ((read += decode_bulk(in + read, end, out_values.template column<Members>())), ...);
+            return sizeof(count) + read;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The size of the 32 bit little endian length that precedes every frame of a stream
+        constexpr std::size_t FRAME_HEADER_SIZE = 4;
+
+        // Splits a byte stream that arrives in chunks of arbitrary size, like the reads of a TCP socket, into frames
+        // of a 32 bit little endian length followed by that many bytes. It is a state machine that resumes wherever the
+        // previous chunk ended, so frames are handed out as soon as their last byte arrives. Frames that lie
+        // completely inside one chunk are handed out as a span of that chunk without being copied, only frames that
+        // are split across chunks are assembled in an internal buffer
+        class stream_decoder
+        {
+          public:
+            // Constructs a decoder that treats frames larger than max_frame_size as a corrupt stream
+            explicit stream_decoder(std::size_t max_frame_size = 16 * 1024 * 1024) noexcept
+              : _max_frame_size{max_frame_size}
+            {
+            }
+
+            // Consumes the given chunk and calls handler with a std::span<std::uint8_t const> of every frame that it
+            // completes. The span is only valid during the call. Returns false if the stream is corrupt, in which case
+            // the decoder has to be reset before it is fed again
+            template <typename Handler> bool feed(std::span<std::uint8_t const> chunk, Handler&& handler)
+            {
+                auto const* in = chunk.data();
+                auto const* end = in + chunk.size();
+
+                while (in != end)
+                {
+                    if (_failed)
+                        return false;
+
+                    // Fast path: nothing is buffered and the whole frame is inside the chunk
+                    if (_buffer.empty() && end - in >= static_cast<std::ptrdiff_t>(FRAME_HEADER_SIZE))
+                    {
+                        auto const size = read_size(in);
+                        if (!check(size))
+                            return false;
+
+                        if (static_cast<std::size_t>(end - in) - FRAME_HEADER_SIZE >= size)
+                        {
+                            handler(std::span<std::uint8_t const>{in + FRAME_HEADER_SIZE, size});
+                            in += FRAME_HEADER_SIZE + size;
+                            continue;
+                        }
+                    }
+
+                    // Slow path: collect the header and then the frame in the buffer
+                    auto const needed = _buffer.size() < FRAME_HEADER_SIZE
+                                            ? FRAME_HEADER_SIZE
+                                            : FRAME_HEADER_SIZE + read_size(_buffer.data());
+                    auto const taken = std::min(needed - _buffer.size(), static_cast<std::size_t>(end - in));
+                    _buffer.insert(_buffer.end(), in, in + taken);
+                    in += taken;
+
+                    if (_buffer.size() == FRAME_HEADER_SIZE)
+                    {
+                        auto const size = read_size(_buffer.data());
+                        if (!check(size))
+                            return false;
+
+                        _buffer.reserve(FRAME_HEADER_SIZE + size);
+                    }
+
+                    if (_buffer.size() >= FRAME_HEADER_SIZE &&
+                        _buffer.size() == FRAME_HEADER_SIZE + read_size(_buffer.data()))
+                    {
+                        handler(std::span<std::uint8_t const>{_buffer.data() + FRAME_HEADER_SIZE,
+                                                              _buffer.size() - FRAME_HEADER_SIZE});
+                        _buffer.clear();
+                    }
+                }
+
+                return !_failed;
+            }
+
+            // Returns the amount of bytes of an incomplete frame that are buffered
+            std::size_t buffered() const noexcept { return _buffer.size(); }
+
+            // Drops a buffered incomplete frame and recovers from a corrupt stream
+            void reset() noexcept
+            {
+                _buffer.clear();
+                _failed = false;
+            }
+
+          private:
+            static std::size_t read_size(std::uint8_t const* in) noexcept
+            {
+                std::uint32_t size;
+                std::memcpy(&size, in, sizeof(size));
+                if constexpr (std::endian::native == std::endian::big)
+                    size = std::byteswap(size);
+
+                return size;
+            }
+
+            bool check(std::size_t size) noexcept
+            {
+                _failed = size > _max_frame_size;
+                return !_failed;
+            }
+
+            std::size_t _max_frame_size;
+            std::vector<std::uint8_t> _buffer;
+            bool _failed = false;
+        };
+
+        // Writes the header of a frame of the given size to out, which must have room for FRAME_HEADER_SIZE bytes
+        inline void write_frame_header(std::uint32_t size, std::uint8_t* out) noexcept
+        {
+            if constexpr (std::endian::native == std::endian::big)
+                size = std::byteswap(size);
+
+            std::memcpy(out, &size, sizeof(size));
+        }
+    }
+}
@@ -0,0 +1,233 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // The maximum amount of bytes that a 64 bit value occupies as varint
+        constexpr std::size_t MAX_VARINT_SIZE = 10;
+
+        // Maps signed values to unsigned ones so that values of a small magnitude stay small: 0, -1, 1, -2, ... become
+        // 0, 1, 2, 3, ...
+        constexpr std::uint64_t zigzag_encode(std::int64_t value) noexcept
+        {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        // Reverses zigzag_encode
+        constexpr std::int64_t zigzag_decode(std::uint64_t value) noexcept
+        {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        // Returns the amount of bytes that the given value occupies as varint
+        constexpr std::size_t varint_size(std::uint64_t value) noexcept
+        {
+            return (static_cast<std::size_t>(std::bit_width(value | 1)) + 6) / 7;
+        }
+
+        // Writes the given value as varint to out, which must have room for MAX_VARINT_SIZE bytes. Returns the amount
+        // of bytes written
+        inline std::size_t encode_varint(std::uint64_t value, std::uint8_t* out) noexcept
+        {
+            std::size_t size = 0;
+            while (value >= 0x80)
+            {
+                out[size++] = static_cast<std::uint8_t>(value | 0x80);
+                value >>= 7;
+            }
+
+            out[size++] = static_cast<std::uint8_t>(value);
+            return size;
+        }
+
+        // Reads a varint from [in, end) into out_value. Returns the amount of bytes read or 0 if the input ends before
+        // the varint does, if the varint is longer than MAX_VARINT_SIZE or if it doesn't fit into 64 bits
+        inline std::size_t decode_varint(std::uint8_t const* in, std::uint8_t const* end,
+                                         std::uint64_t& out_value) noexcept
+        {
+            // With 8 readable bytes the length of every varint that fits into them follows from a single word, so
+            // varints of up to 56 bits are decoded without a branch per byte
+            if (end - in >= 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, in, sizeof(word));
+                if constexpr (std::endian::native == std::endian::big)
+                    word = std::byteswap(word);
+
+                if (auto stops = ~word & 0x8080808080808080ull; stops != 0)
+                {
+                    auto size = static_cast<std::size_t>(std::countr_zero(stops) / 8 + 1);
+
+                    // Drop the bytes behind the varint and the continuation bits, then squeeze the 7 bit groups
+                    // together: pairs of bytes first, then pairs of 14 bit groups and finally pairs of 28 bit groups
+                    if (size < 8)
+                        word &= (1ull << (size * 8)) - 1;
+                    word &= 0x7f7f7f7f7f7f7f7full;
+                    word = (word & 0x007f007f007f007full) | ((word & 0x7f007f007f007f00ull) >> 1);
+                    word = (word & 0x00003fff00003fffull) | ((word & 0x3fff00003fff0000ull) >> 2);
+                    word = (word & 0x000000000fffffffull) | ((word & 0x0fffffff00000000ull) >> 4);
+
+                    out_value = word;
+                    return size;
+                }
+            }
+
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < MAX_VARINT_SIZE && in + i < end; ++i)
+            {
+                // The last byte only carries the 64th bit, anything else overflows or is overlong
+                if (i == MAX_VARINT_SIZE - 1 && in[i] > 1)
+                    return 0;
+
+                value |= static_cast<std::uint64_t>(in[i] & 0x7f) << (7 * i);
+                if ((in[i] & 0x80) == 0)
+                {
+                    out_value = value;
+                    return i + 1;
+                }
+            }
+
+            return 0;
+        }
+
+        // Writes the given values as varints to out, which must have room for values.size() * MAX_VARINT_SIZE bytes.
+        // Signed values are sign extended, use encode_zigzags for those that are likely negative. Returns the amount of
+        // bytes written
+        template <typename T> std::size_t encode_varints(std::span<T const> values, std::uint8_t* out) noexcept
+        {
+            static_assert(std::is_integral_v<T>);
+
+            std::size_t size = 0;
+            for (auto value : values)
+                size += encode_varint(static_cast<std::uint64_t>(value), out + size);
+
+            return size;
+        }
+
+        // Narrows a decoded varint to T. Signed values were sign extended by encode_varints. Returns false if the value
+        // is outside of T
+        template <typename T> constexpr bool narrow_varint(std::uint64_t value, T& out_value) noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                auto const signed_value = static_cast<std::int64_t>(value);
+                if (signed_value < std::numeric_limits<T>::min() || signed_value > std::numeric_limits<T>::max())
+                    return false;
+            }
+            else if (value > std::numeric_limits<T>::max())
+                return false;
+
+            out_value = static_cast<T>(value);
+            return true;
+        }
+
+        // Narrows a decoded zigzag encoded varint to T. Returns false if the value is outside of T
+        template <typename T> constexpr bool narrow_zigzag(std::uint64_t value, T& out_value) noexcept
+        {
+            auto const signed_value = zigzag_decode(value);
+            if (signed_value < std::numeric_limits<T>::min() || signed_value > std::numeric_limits<T>::max())
+                return false;
+
+            out_value = static_cast<T>(signed_value);
+            return true;
+        }
+
+        // Reads out_values.size() varints from [in, end) into out_values and narrows each with narrow. Returns the
+        // amount of bytes read or 0 if the input is invalid or a value doesn't fit
+        template <typename T, typename Narrow>
+        std::size_t decode_narrowed_varints(std::uint8_t const* in, std::uint8_t const* end, std::span<T> out_values,
+                                            Narrow narrow) noexcept
+        {
+            auto const* begin = in;
+            std::size_t i = 0;
+            while (i < out_values.size())
+            {
+                // Repeated fields tend to contain runs of small values. If the next 8 bytes all lack the continuation
+                // bit they are 8 complete values that are widened at once. 7 bits fit into every T, so narrowing them
+                // can't fail
+                if (out_values.size() - i >= 8 && end - in >= 8)
+                {
+                    std::uint64_t word;
+                    std::memcpy(&word, in, sizeof(word));
+                    if ((word & 0x8080808080808080ull) == 0)
+                    {
+                        for (std::size_t n = 0; n < 8; ++n)
+                            narrow(in[n], out_values[i + n]);
+
+                        i += 8;
+                        in += 8;
+                        continue;
+                    }
+                }
+
+                std::uint64_t value;
+                auto size = decode_varint(in, end, value);
+                if (size == 0 || !narrow(value, out_values[i]))
+                    return 0;
+
+                ++i;
+                in += size;
+            }
+
+            return static_cast<std::size_t>(in - begin);
+        }
+
+        // Reads out_values.size() varints from [in, end) into out_values. Returns the amount of bytes read or 0 if the
+        // input is invalid or a value is outside of T
+        template <typename T>
+        std::size_t decode_varints(std::uint8_t const* in, std::uint8_t const* end, std::span<T> out_values) noexcept
+        {
+            static_assert(std::is_integral_v<T>);
+
+            return decode_narrowed_varints(in, end, out_values, narrow_varint<T>);
+        }
+
+        // Writes the given signed values as zigzag encoded varints to out, which must have room for
+        // values.size() * MAX_VARINT_SIZE bytes. Returns the amount of bytes written
+        template <typename T> std::size_t encode_zigzags(std::span<T const> values, std::uint8_t* out) noexcept
+        {
+            static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+
+            std::size_t size = 0;
+            for (auto value : values)
+                size += encode_varint(zigzag_encode(value), out + size);
+
+            return size;
+        }
+
+        // Reads out_values.size() zigzag encoded varints from [in, end) into out_values. Returns the amount of bytes
+        // read or 0 if the input is invalid or a value is outside of T
+        template <typename T>
+        std::size_t decode_zigzags(std::uint8_t const* in, std::uint8_t const* end, std::span<T> out_values) noexcept
+        {
+            static_assert(std::is_integral_v<T> && std::is_signed_v<T>);
+
+            return decode_narrowed_varints(in, end, out_values, narrow_zigzag<T>);
+        }
+    }
+}
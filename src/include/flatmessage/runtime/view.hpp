@@ -0,0 +1,201 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "bulk.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace runtime
+    {
+        // A read-only view of elements that are stored as little endian bytes inside a receive buffer. Nothing is
+        // copied when the view is created, every element is loaded when it is accessed. The view is only valid as long
+        // as the buffer it points into
+        template <bulk_element T> class repeated_view
+        {
+          public:
+            class iterator
+            {
+              public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = T;
+
+                iterator() noexcept = default;
+                explicit iterator(std::uint8_t const* position) noexcept : _position{position} {}
+
+                T operator*() const noexcept { return load(_position); }
+
+                iterator& operator++() noexcept
+                {
+                    _position += sizeof(T);
+                    return *this;
+                }
+
+                iterator operator++(int) noexcept
+                {
+                    auto copy = *this;
+                    ++*this;
+                    return copy;
+                }
+
+                bool operator==(iterator const& other) const noexcept = default;
+
+              private:
+                std::uint8_t const* _position = nullptr;
+            };
+
+            repeated_view() noexcept = default;
+
+            // Constructs a view of count elements that start at data
+            repeated_view(std::uint8_t const* data, std::size_t count) noexcept : _data{data}, _count{count} {}
+
+            std::size_t size() const noexcept { return _count; }
+            bool empty() const noexcept { return _count == 0; }
+
+            T operator[](std::size_t index) const noexcept { return load(_data + index * sizeof(T)); }
+
+            iterator begin() const noexcept { return iterator{_data}; }
+            iterator end() const noexcept { return iterator{_data + _count * sizeof(T)}; }
+
+            // Returns the bytes of the elements as they are stored in the buffer
+            std::span<std::uint8_t const> bytes() const noexcept { return {_data, _count * sizeof(T)}; }
+
+          private:
+            // Elements are loaded with memcpy since the buffer gives no alignment guarantees. Compilers turn it into a
+            // plain load
+            static T load(std::uint8_t const* position) noexcept
+            {
+                T value;
+                if constexpr (sizeof(T) == 1 || std::endian::native == std::endian::little)
+                    std::memcpy(&value, position, sizeof(T));
+                else
+                    swap_bytes<sizeof(T)>(position, 1, reinterpret_cast<std::uint8_t*>(&value));
+
+                return value;
+            }
+
+            std::uint8_t const* _data = nullptr;
+            std::size_t _count = 0;
+        };
+
+        // Decodes attributes in place: strings become string_views and arrays and repeated attributes of bulk elements
+        // become repeated_views into the input, so decoding a message doesn't allocate. Everything it returns is only
+        // valid as long as the input. Reads past the end of the input return empty values and mark the reader as failed
+        class view_reader
+        {
+          public:
+            // Constructs a reader that reads from [in, end)
+            view_reader(std::uint8_t const* in, std::uint8_t const* end) noexcept : _in{in}, _end{end} {}
+
+            // Reads a single value that is written at its full width
+            template <bulk_element T> T read() noexcept
+            {
+                T value{};
+                if (auto const* position = take(sizeof(T)))
+                    value = repeated_view<T>{position, 1}[0];
+
+                return value;
+            }
+
+            // Reads a string that is written as 32 bit length followed by its characters
+            std::string_view read_string() noexcept
+            {
+                auto const size = read<std::uint32_t>();
+                auto const* position = take(size);
+                return position != nullptr ? std::string_view{reinterpret_cast<char const*>(position), size}
+                                           : std::string_view{};
+            }
+
+            // Reads an array of the given count of elements
+            template <bulk_element T> repeated_view<T> read_array(std::size_t count) noexcept
+            {
+                if (count > remaining() / sizeof(T))
+                    return fail<repeated_view<T>>();
+
+                return {take(count * sizeof(T)), count};
+            }
+
+            // Reads a repeated attribute that is written as 32 bit count followed by its elements
+            template <bulk_element T> repeated_view<T> read_repeated() noexcept
+            {
+                return read_array<T>(read<std::uint32_t>());
+            }
+
+            // Returns the amount of bytes that have not been read yet
+            std::size_t remaining() const noexcept { return static_cast<std::size_t>(_end - _in); }
+
+            // Returns whether a read went past the end of the input
+            bool failed() const noexcept { return _failed; }
+
+          private:
+            // Returns the position of the next size bytes and skips them or returns nullptr if there are less
+            std::uint8_t const* take(std::size_t size) noexcept
+            {
+                if (_failed || size > remaining())
+                    return fail<std::uint8_t const*>();
+
+                auto const* position = _in;
+                _in += size;
+                return position;
+            }
+
+            template <typename Result> Result fail() noexcept
+            {
+                _failed = true;
+                return Result{};
+            }
+
+            std::uint8_t const* _in;
+            std::uint8_t const* _end;
+            bool _failed = false;
+        };
+
+        // Copies the given string out of the buffer it points into, for values that have to outlive the buffer. The
+        // copy's storage comes from the given allocator, like a std::pmr::polymorphic_allocator of an arena
+        template <typename Allocator = std::allocator<char>>
+        auto to_owned(std::string_view value, Allocator const& allocator = {})
+        {
+            using char_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+            return std::basic_string<char, std::char_traits<char>, char_allocator>{value, char_allocator{allocator}};
+        }
+
+        // Copies the given elements out of the buffer they point into, for values that have to outlive the buffer. The
+        // copy's storage comes from the given allocator, like a std::pmr::polymorphic_allocator of an arena
+        template <bulk_element T, typename Allocator = std::allocator<T>>
+        auto to_owned(repeated_view<T> const& values, Allocator const& allocator = {})
+        {
+            using element_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+            std::vector<T, element_allocator> owned(values.size(), element_allocator{allocator});
+            decode_bulk(values.bytes().data(), values.bytes().data() + values.bytes().size(), std::span<T>{owned});
+            return owned;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <flatmessage/ast/types.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace flatmessage
+{
+    // Everything that the semantic analysis learned about the translation units of a compilation and that the
+    // generators need to know about
+    struct symbol_table
+    {
+        // The names of all enums that the translation units export
+        std::unordered_set<std::string> enums;
+        // The range of the values of every enum, by enum name
+        std::unordered_map<std::string, ast::value_range> enum_ranges;
+        // The values of every enum whose values leave gaps in its range, by enum name
+        std::unordered_map<std::string, std::vector<std::int64_t>> sparse_enum_values;
+        // The wire size of every enum, data structure and message, by name
+        ast::wire_size_table wire_sizes;
+        // The memory size of every enum, data structure, union and message, by name
+        ast::memory_size_table memory_sizes;
+        // The columns of every data structure that a [soa] attribute can be stored as, by name
+        ast::soa_column_table soa_columns;
+        // The names of all data structures that the translation units export
+        std::unordered_set<std::string> data;
+        // The wire ids of the messages of every protocol, by protocol name and then by message name. Only ids that
+        // are pinned with [id=N] are stable across schema changes
+        std::unordered_map<std::string, std::unordered_map<std::string, int>> message_ids;
+        // The module that declares every message of every protocol, by protocol name and then by message name
+        std::unordered_map<std::string, std::unordered_map<std::string, std::string>> message_modules;
+        // The module that generates the dispatch table of every protocol, by protocol name. It is the built module of
+        // the protocol whose name comes first
+        std::unordered_map<std::string, std::string> dispatch_modules;
+    };
+}
@@ -36,6 +36,7 @@ limitations under the License.
 BOOST_FUSION_ADAPT_STRUCT(flatmessage::ast::annotation,
     (std::string, name)
     (boost::optional<flatmessage::ast::annotation_value_t>, value)
+    (std::vector<flatmessage::ast::annotation_value_t>, arguments)
 )
 
 BOOST_FUSION_ADAPT_STRUCT(flatmessage::ast::data,
@@ -50,6 +51,12 @@ BOOST_FUSION_ADAPT_STRUCT(flatmessage::ast::message,
     (std::vector<flatmessage::ast::attribute>, attributes)
 )
 
+BOOST_FUSION_ADAPT_STRUCT(flatmessage::ast::tagged_union,
+    (std::vector<flatmessage::ast::annotation>, annotations)
+    (std::string, name)
+    (std::vector<flatmessage::ast::attribute>, alternatives)
+)
+
 BOOST_FUSION_ADAPT_STRUCT(flatmessage::ast::attribute,
     (std::vector<flatmessage::ast::annotation>, annotations)
     (boost::optional<std::string>, specifier)
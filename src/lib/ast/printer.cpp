@@ -28,6 +28,7 @@ namespace flatmessage::ast
         void operator()(attribute const& attribute);
         void operator()(message const& message);
         void operator()(data const& data);
+        void operator()(tagged_union const& tagged_union);
         void operator()(module_decl const& module_decl);
         void operator()(import_decl const& import_decl);
         void operator()(protocol_decl const& protocol_decl);
@@ -65,6 +66,18 @@ namespace flatmessage::ast
                 out << '=';
                 boost::apply_visitor(v, *annotation.value);
             }
+
+            if (!annotation.arguments.empty())
+            {
+                out << '(';
+                for (std::size_t i = 0; i < annotation.arguments.size(); ++i)
+                {
+                    if (i != 0)
+                        out << ',';
+                    boost::apply_visitor(v, annotation.arguments[i]);
+                }
+                out << ')';
+            }
             first = false;
         }
 
@@ -155,6 +168,18 @@ namespace flatmessage::ast
         out << '\n';
     }
 
+    void flatmessage::ast::visitor::operator()(tagged_union const& tagged_union)
+    {
+        out << "union ";
+        printAnnotation(tagged_union.annotations, out);
+        out << tagged_union.name << ' ';
+
+        for (auto const& alternative : tagged_union.alternatives)
+            (*this)(alternative);
+
+        out << '\n';
+    }
+
     void flatmessage::ast::visitor::operator()(module_decl const& module_decl)
     {
         out << "module " << module_decl.name << '\n';
@@ -0,0 +1,860 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <flatmessage/ast/types.hpp>
+
+#include <boost/variant/get.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <unordered_set>
+
+namespace flatmessage::ast
+{
+    // clang-format off
+    builtin_type const builtin_types[] = {
+        {"char",   1, false, false},
+        {"byte",   1, true,  false},
+        {"bool",   1, false, false},
+        {"uint8",  1, true,  false},
+        {"int8",   1, true,  true},
+        {"uint16", 2, true,  false},
+        {"int16",  2, true,  true},
+        {"uint32", 4, true,  false},
+        {"int32",  4, true,  true},
+        {"uint64", 8, true,  false},
+        {"int64",  8, true,  true},
+        {"float",  4, false, true},
+        {"string", 0, false, false},
+    };
+    // clang-format on
+
+    builtin_type const* find_builtin_type(std::string const& name)
+    {
+        auto itr = std::find_if(std::begin(builtin_types), std::end(builtin_types),
+                                [&](builtin_type const& type) { return name == type.name; });
+
+        return itr != std::end(builtin_types) ? itr : nullptr;
+    }
+
+    annotation const* find_annotation(std::vector<annotation> const& annotations, std::string const& name)
+    {
+        auto itr = std::find_if(annotations.begin(), annotations.end(),
+                                [&](annotation const& annotation) { return annotation.name == name; });
+
+        return itr != annotations.end() ? &*itr : nullptr;
+    }
+
+    char const* to_string(integer_encoding encoding)
+    {
+        switch (encoding)
+        {
+            case integer_encoding::varint:
+                return "varint";
+            case integer_encoding::zigzag:
+                return "zigzag";
+            default:
+                return "fixed";
+        }
+    }
+
+    integer_encoding get_integer_encoding(attribute const& attribute,
+                                          std::vector<annotation> const& container_annotations,
+                                          std::string& out_error)
+    {
+        auto const* type = find_builtin_type(attribute.type);
+        bool const is_integer = type && type->is_integer;
+
+        int own_annotations = 0;
+        auto encoding = integer_encoding::fixed;
+        for (auto candidate : {integer_encoding::fixed, integer_encoding::varint, integer_encoding::zigzag})
+        {
+            if (find_annotation(attribute.annotations, to_string(candidate)))
+            {
+                encoding = candidate;
+                ++own_annotations;
+            }
+        }
+
+        if (own_annotations > 1)
+        {
+            out_error = "Attribute '" + attribute.name + "' may only have one of 'fixed', 'varint' and 'zigzag'";
+            return integer_encoding::fixed;
+        }
+
+        if (own_annotations == 1)
+        {
+            if (encoding != integer_encoding::fixed && !is_integer)
+                out_error = "Attribute '" + attribute.name + "' of type '" + attribute.type + "' can't be a "
+                            + to_string(encoding) + " since it isn't an integer";
+            else if (encoding == integer_encoding::zigzag && !type->is_signed)
+                out_error = "Attribute '" + attribute.name + "' of type '" + attribute.type
+                            + "' can't be a zigzag since it is unsigned";
+
+            return out_error.empty() ? encoding : integer_encoding::fixed;
+        }
+
+        if (!is_integer)
+            return integer_encoding::fixed;
+
+        if (find_annotation(container_annotations, "zigzag"))
+            return type->is_signed ? integer_encoding::zigzag : integer_encoding::varint;
+
+        if (find_annotation(container_annotations, "varint"))
+            return integer_encoding::varint;
+
+        return integer_encoding::fixed;
+    }
+
+    char const* to_string(quantization_kind kind)
+    {
+        return kind == quantization_kind::fixed_point ? "fixed_point" : "range";
+    }
+
+    namespace
+    {
+        // Reads the given value into out_number if it is a number
+        bool get_number(annotation_value_t const& value, double& out_number)
+        {
+            if (auto* integer = boost::get<int>(&value))
+                out_number = *integer;
+            else if (auto* real = boost::get<double>(&value))
+                out_number = *real;
+            else
+                return false;
+
+            return true;
+        }
+    }
+
+    bool get_quantization(attribute const& attribute, quantization& out_quantization, std::string& out_error)
+    {
+        auto const* quantize = find_annotation(attribute.annotations, "quantize");
+        auto const* fixed = find_annotation(attribute.annotations, "fixed");
+        if (fixed && !fixed->value)
+            fixed = nullptr;
+
+        if (!quantize && !fixed)
+            return false;
+
+        auto const prefix = "Attribute '" + attribute.name + "' ";
+        if (quantize && fixed)
+        {
+            out_error = prefix + "may only have one of 'quantize' and 'fixed'";
+            return false;
+        }
+
+        if (attribute.type != "float")
+        {
+            out_error = prefix + "of type '" + attribute.type + "' can't be quantized since it isn't a float";
+            return false;
+        }
+
+        quantization result;
+        if (quantize)
+        {
+            if (quantize->value || quantize->arguments.size() != 3 || !get_number(quantize->arguments[0], result.min)
+                || !get_number(quantize->arguments[1], result.max) || !boost::get<int>(&quantize->arguments[2]))
+            {
+                out_error = prefix + "has to be quantized as 'quantize(min, max, bits)'";
+                return false;
+            }
+
+            result.bits = boost::get<int>(quantize->arguments[2]);
+            if (result.min >= result.max)
+            {
+                out_error = prefix + "has to be quantized to a range whose minimum is below its maximum";
+                return false;
+            }
+
+            if (result.bits < 1 || result.bits > 32)
+            {
+                out_error = prefix + "has to be quantized to between 1 and 32 bits";
+                return false;
+            }
+
+            result.kind = quantization_kind::range;
+            result.step = (result.max - result.min) / (std::ldexp(1.0, result.bits) - 1);
+        }
+        else
+        {
+            if (!get_number(*fixed->value, result.step) || result.step <= 0)
+            {
+                out_error = prefix + "has to be a fixed point number with a positive step as 'fixed=step'";
+                return false;
+            }
+
+            result.kind = quantization_kind::fixed_point;
+        }
+
+        out_quantization = result;
+        return true;
+    }
+
+    int bit_width(value_range const& range)
+    {
+        auto distance = static_cast<std::uint64_t>(range.max) - static_cast<std::uint64_t>(range.min);
+        return std::max(1, static_cast<int>(std::bit_width(distance)));
+    }
+
+    value_range get_value_range(enumeration const& enumeration)
+    {
+        if (enumeration.values.empty())
+            return {};
+
+        auto [min, max] = std::minmax_element(
+            enumeration.values.begin(), enumeration.values.end(),
+            [](enum_value const& lhs, enum_value const& rhs) { return lhs.value < rhs.value; });
+
+        return {min->value, max->value};
+    }
+
+    std::vector<std::int64_t> get_sparse_values(enumeration const& enumeration)
+    {
+        std::vector<std::int64_t> values;
+        for (auto& value : enumeration.values)
+            values.push_back(value.value);
+
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        if (values.empty() || static_cast<std::uint64_t>(values.back() - values.front()) + 1 == values.size())
+            return {};
+        return values;
+    }
+
+    bool get_range(attribute const& attribute, value_range& out_range, std::string& out_error)
+    {
+        auto const* range = find_annotation(attribute.annotations, "range");
+        if (!range)
+            return false;
+
+        auto const prefix = "Attribute '" + attribute.name + "' ";
+        auto const* type = find_builtin_type(attribute.type);
+        if (!type || !type->is_integer)
+        {
+            out_error = prefix + "of type '" + attribute.type + "' can't have a range since it isn't an integer";
+            return false;
+        }
+
+        if (find_annotation(attribute.annotations, "varint") || find_annotation(attribute.annotations, "zigzag"))
+        {
+            out_error = prefix + "can't have a range and be a varint at the same time";
+            return false;
+        }
+
+        // The grammar reads lo..hi as a single string
+        auto const* text = range->value ? boost::get<std::string>(&*range->value) : nullptr;
+        auto const separator = text ? text->find("..") : std::string::npos;
+        value_range result;
+        if (separator == std::string::npos
+            || std::from_chars(text->data(), text->data() + separator, result.min).ptr != text->data() + separator
+            || std::from_chars(text->data() + separator + 2, text->data() + text->size(), result.max).ptr
+                   != text->data() + text->size())
+        {
+            out_error = prefix + "has to have a range as 'range=lo..hi'";
+            return false;
+        }
+
+        if (result.min > result.max)
+        {
+            out_error = prefix + "has to have a range whose minimum isn't above its maximum";
+            return false;
+        }
+
+        // Ranges are read as int64, which is enough for every range that the grammar accepts
+        auto const value_bits = type->size * 8 - (type->is_signed ? 1 : 0);
+        auto const type_max = value_bits >= 63 ? std::numeric_limits<std::int64_t>::max()
+                                               : (std::int64_t{1} << value_bits) - 1;
+        auto const type_min = type->is_signed ? -type_max - 1 : 0;
+        if (result.min < type_min || result.max > type_max)
+        {
+            out_error = prefix + "has a range that exceeds its type '" + attribute.type + "'";
+            return false;
+        }
+
+        out_range = result;
+        return true;
+    }
+
+    int get_packed_bits(attribute const& attribute, std::unordered_map<std::string, value_range> const& enum_ranges,
+                        std::int64_t& out_offset)
+    {
+        out_offset = 0;
+        if (attribute.type == "bool")
+            return 1;
+
+        if (auto itr = enum_ranges.find(attribute.type); itr != enum_ranges.end())
+        {
+            out_offset = itr->second.min;
+            return bit_width(itr->second);
+        }
+
+        std::string error;
+        value_range range;
+        if (get_range(attribute, range, error))
+        {
+            out_offset = range.min;
+            return bit_width(range);
+        }
+
+        return 0;
+    }
+
+    bool is_optional(attribute const& attribute)
+    {
+        return attribute.specifier && *attribute.specifier == "optional";
+    }
+
+    std::size_t count_optionals(std::vector<attribute> const& attributes)
+    {
+        return static_cast<std::size_t>(std::count_if(attributes.begin(), attributes.end(), is_optional));
+    }
+
+    std::size_t presence_words(std::size_t optional_count)
+    {
+        return (optional_count + presence_word_bits - 1) / presence_word_bits;
+    }
+
+    namespace
+    {
+        wire_size const unbounded{0, false, false};
+
+        // A fixed point float is written as zigzag varint of a 64 bit integer
+        constexpr std::size_t MAX_FIXED_POINT_SIZE = 10;
+
+        // A negative signed varint is written as varint of its 64 bit two's complement
+        constexpr std::size_t MAX_SIGNED_VARINT_SIZE = 10;
+
+        // Returns the size of a followed by b
+        wire_size operator+(wire_size const& a, wire_size const& b)
+        {
+            return {a.size + b.size, a.is_fixed && b.is_fixed, a.is_bounded && b.is_bounded};
+        }
+
+        // Returns the size of count times a
+        wire_size operator*(wire_size const& a, std::size_t count)
+        {
+            return {a.size * count, a.is_fixed, a.is_bounded};
+        }
+
+        std::size_t enum_size(std::string const& alignment)
+        {
+            if (alignment == "word")
+                return 2;
+            if (alignment == "dword")
+                return 4;
+            if (alignment == "qword")
+                return 8;
+
+            return 1;
+        }
+    }
+
+    wire_size get_element_size(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                               wire_size_table const& types,
+                               std::unordered_map<std::string, value_range> const& enum_ranges, int& out_packed_bits)
+    {
+        out_packed_bits = 0;
+
+        std::string error;
+        quantization quantization;
+        bool const is_quantized = get_quantization(attribute, quantization, error);
+        bool const is_range_quantized = is_quantized && quantization.kind == quantization_kind::range;
+
+        // Optional and repeated attributes stay outside of the bitstream, so that they can be omitted or counted
+        if (find_annotation(container_annotations, "bitpacked") && !attribute.specifier)
+        {
+            std::int64_t offset;
+            out_packed_bits = is_range_quantized ? quantization.bits
+                                                 : get_packed_bits(attribute, enum_ranges, offset);
+            if (out_packed_bits != 0)
+                return {};
+        }
+
+        if (is_quantized)
+            return is_range_quantized ? wire_size{static_cast<std::size_t>(quantization.bits + 7) / 8}
+                                      : wire_size{MAX_FIXED_POINT_SIZE, false, true};
+
+        if (auto const* type = find_builtin_type(attribute.type))
+        {
+            if (type->size == 0)
+                return wire_size{length_prefix_size} + unbounded;
+
+            auto const bytes = static_cast<std::size_t>(type->size);
+            auto const encoding = get_integer_encoding(attribute, container_annotations, error);
+            if (encoding == integer_encoding::varint && type->is_signed)
+                return {MAX_SIGNED_VARINT_SIZE, false, true};
+            if (encoding != integer_encoding::fixed)
+                return {(bytes * 8 + 6) / 7, false, true};
+
+            return {bytes};
+        }
+
+        if (auto itr = types.find(attribute.type); itr != types.end())
+            return itr->second;
+
+        return unbounded;
+    }
+
+    wire_size get_attribute_size(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                                 wire_size_table const& types,
+                                 std::unordered_map<std::string, value_range> const& enum_ranges,
+                                 int& out_packed_bits)
+    {
+        auto size = get_element_size(attribute, container_annotations, types, enum_ranges, out_packed_bits);
+
+        if (attribute.arraySize)
+        {
+            auto const count = static_cast<std::size_t>(std::max(0, *attribute.arraySize));
+            size = size * count;
+            out_packed_bits *= static_cast<int>(count);
+        }
+
+        if (attribute.specifier && *attribute.specifier == "repeated")
+            return wire_size{length_prefix_size} + unbounded;
+
+        if (is_optional(attribute))
+            return {size.size, false, size.is_bounded};
+
+        return size;
+    }
+
+    wire_size get_container_size(std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+                                 wire_size_table const& types,
+                                 std::unordered_map<std::string, value_range> const& enum_ranges,
+                                 std::size_t& out_fixed_part)
+    {
+        wire_size size{presence_words(count_optionals(attributes)) * presence_word_bits / 8};
+        std::size_t packed_bits = 0;
+        out_fixed_part = size.size;
+
+        for (auto& attribute : attributes)
+        {
+            int bits;
+            auto attribute_size = get_attribute_size(attribute, annotations, types, enum_ranges, bits);
+            packed_bits += static_cast<std::size_t>(bits);
+
+            size = size + attribute_size;
+            if (attribute_size.is_fixed)
+                out_fixed_part += attribute_size.size;
+        }
+
+        auto const packed_size = (packed_bits + 7) / 8;
+        out_fixed_part += packed_size;
+        return size + wire_size{packed_size};
+    }
+
+    wire_size get_union_size(std::vector<attribute> const& alternatives, std::vector<annotation> const& annotations,
+                             wire_size_table const& types,
+                             std::unordered_map<std::string, value_range> const& enum_ranges)
+    {
+        wire_size size{union_tag_size, false, true};
+        for (auto& alternative : alternatives)
+        {
+            int packed_bits;
+            auto alternative_size = get_attribute_size(alternative, annotations, types, enum_ranges, packed_bits);
+
+            size.size = std::max(size.size, union_tag_size + alternative_size.size);
+            size.is_bounded = size.is_bounded && alternative_size.is_bounded;
+        }
+
+        return size;
+    }
+
+    int get_bulk_width(attribute const& attribute, std::vector<annotation> const& container_annotations,
+                       wire_size_table const& types, std::unordered_map<std::string, value_range> const& enum_ranges)
+    {
+        if (!attribute.arraySize && !(attribute.specifier && *attribute.specifier == "repeated"))
+            return 0;
+
+        // Quantized, varint and bitstream elements are transformed on their way to the wire
+        int packed_bits;
+        auto size = get_element_size(attribute, container_annotations, types, enum_ranges, packed_bits);
+        if (!size.is_fixed || packed_bits != 0)
+            return 0;
+
+        std::string error;
+        quantization quantization;
+        if (get_quantization(attribute, quantization, error))
+            return 0;
+
+        if (auto const* type = find_builtin_type(attribute.type))
+            return attribute.type == "bool" ? 0 : type->size;
+
+        return enum_ranges.count(attribute.type) != 0 ? static_cast<int>(size.size) : 0;
+    }
+
+    std::vector<std::optional<std::size_t>> get_in_place_offsets(
+        std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+        wire_size_table const& types, std::unordered_map<std::string, value_range> const& enum_ranges,
+        std::size_t& out_in_place_size)
+    {
+        std::vector<std::optional<std::size_t>> offsets(attributes.size());
+        out_in_place_size = presence_words(count_optionals(attributes)) * presence_word_bits / 8;
+
+        // The bitstream of a bitpacked container is written behind all of its attributes
+        if (find_annotation(annotations, "bitpacked"))
+            return offsets;
+
+        for (std::size_t i = 0; i < attributes.size(); ++i)
+        {
+            int packed_bits;
+            auto size = get_attribute_size(attributes[i], annotations, types, enum_ranges, packed_bits);
+            if (!size.is_fixed)
+                break;
+
+            offsets[i] = out_in_place_size;
+            out_in_place_size += size.size;
+        }
+
+        return offsets;
+    }
+
+    wire_size_table compute_wire_sizes(std::vector<ast const*> const& asts)
+    {
+        wire_size_table sizes;
+        std::unordered_map<std::string, value_range> enum_ranges;
+        std::unordered_map<std::string, std::pair<std::vector<attribute> const*, std::vector<annotation> const*>>
+            containers;
+        std::unordered_set<std::string> unions;
+
+        for (auto* elements : asts)
+        {
+            for (auto& elem : *elements)
+            {
+                if (auto* e = boost::get<enumeration>(&elem))
+                {
+                    sizes[e->name] = {enum_size(e->alignment)};
+                    enum_ranges[e->name] = get_value_range(*e);
+                }
+                else if (auto* d = boost::get<data>(&elem))
+                    containers[d->name] = {&d->attributes, &d->annotations};
+                else if (auto* m = boost::get<message>(&elem))
+                    containers[m->name] = {&m->attributes, &m->annotations};
+                else if (auto* u = boost::get<tagged_union>(&elem))
+                {
+                    containers[u->name] = {&u->alternatives, &u->annotations};
+                    unions.insert(u->name);
+                }
+            }
+        }
+
+        // Containers are sized after the types they contain. While a container is being sized it is registered as
+        // unbounded, so every type that reaches it again contains itself and ends up unbounded as well
+        std::function<void(std::string const&)> compute = [&](std::string const& name) {
+            if (!sizes.emplace(name, unbounded).second)
+                return;
+
+            auto [attributes, annotations] = containers[name];
+            for (auto& attribute : *attributes)
+            {
+                if (containers.count(attribute.type))
+                    compute(attribute.type);
+            }
+
+            if (unions.count(name))
+            {
+                sizes[name] = get_union_size(*attributes, *annotations, sizes, enum_ranges);
+                return;
+            }
+
+            std::size_t fixed_part;
+            sizes[name] = get_container_size(*attributes, *annotations, sizes, enum_ranges, fixed_part);
+        };
+
+        for (auto& [name, container] : containers)
+            compute(name);
+
+        return sizes;
+    }
+
+    char const* to_string(temperature temperature)
+    {
+        switch (temperature)
+        {
+            case temperature::hot:
+                return "hot";
+            case temperature::cold:
+                return "cold";
+            default:
+                return "normal";
+        }
+    }
+
+    temperature get_temperature(attribute const& attribute, std::string& out_error)
+    {
+        bool const is_hot = find_annotation(attribute.annotations, "hot") != nullptr;
+        bool const is_cold = find_annotation(attribute.annotations, "cold") != nullptr;
+
+        if (is_hot && is_cold)
+        {
+            out_error = "Attribute '" + attribute.name + "' can't be hot and cold";
+            return temperature::normal;
+        }
+
+        return is_hot ? temperature::hot : is_cold ? temperature::cold : temperature::normal;
+    }
+
+    namespace
+    {
+        // The sizes of std::string and std::vector, which both hold pointers
+        constexpr memory_size string_memory_size{32, 8};
+        constexpr memory_size vector_memory_size{24, 8};
+
+        // The cold block of a split type is held by a single pointer
+        constexpr memory_size cold_block_memory_size{8, 8};
+
+        std::size_t align_to(std::size_t offset, std::size_t alignment)
+        {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    memory_size get_memory_size(attribute const& attribute, memory_size_table const& types)
+    {
+        if (attribute.specifier && *attribute.specifier == "repeated")
+            return vector_memory_size;
+
+        memory_size size;
+        if (auto const* type = find_builtin_type(attribute.type))
+            size = type->size == 0 ? string_memory_size
+                                   : memory_size{static_cast<std::size_t>(type->size),
+                                                 static_cast<std::size_t>(type->size)};
+        else if (auto itr = types.find(attribute.type); itr != types.end())
+            size = itr->second;
+
+        if (attribute.arraySize)
+            size.size *= static_cast<std::size_t>(std::max(0, *attribute.arraySize));
+
+        return size;
+    }
+
+    std::vector<std::size_t> optimize_field_order(std::vector<attribute> const& attributes,
+                                                  memory_size_table const& types)
+    {
+        std::vector<std::size_t> order(attributes.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::string error;
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+            auto const lhs_temperature = get_temperature(attributes[lhs], error);
+            auto const rhs_temperature = get_temperature(attributes[rhs], error);
+            if (lhs_temperature != rhs_temperature)
+                return lhs_temperature < rhs_temperature;
+
+            return get_memory_size(attributes[lhs], types).alignment >
+                   get_memory_size(attributes[rhs], types).alignment;
+        });
+
+        return order;
+    }
+
+    field_layout get_field_layout(std::vector<attribute> const& attributes, std::vector<std::size_t> const& order,
+                                  memory_size_table const& types, bool with_presence)
+    {
+        field_layout layout;
+        layout.order = order;
+        layout.offsets.resize(attributes.size());
+
+        std::size_t offset = 0;
+        std::size_t used = 0;
+        auto place = [&](memory_size const& size) {
+            offset = align_to(offset, size.alignment);
+            layout.size.alignment = std::max(layout.size.alignment, size.alignment);
+
+            auto const placed_at = offset;
+            offset += size.size;
+            used += size.size;
+            return placed_at;
+        };
+
+        for (auto index : order)
+            layout.offsets[index] = place(get_memory_size(attributes[index], types));
+
+        // presence_bits holds an array of 32 bit words
+        if (auto const words = presence_words(count_optionals(attributes)); with_presence && words != 0)
+            layout.presence_offset = place({words * presence_word_bits / 8, presence_word_bits / 8});
+        else
+            layout.presence_offset = offset;
+
+        // An empty struct still occupies a byte
+        layout.size.size = std::max<std::size_t>(align_to(offset, layout.size.alignment), 1);
+        layout.padding = layout.size.size - std::min(used, layout.size.size);
+        return layout;
+    }
+
+    bool is_cold_block_attribute(attribute const& attribute, std::vector<annotation> const& container_annotations)
+    {
+        std::string error;
+        return find_annotation(container_annotations, "split")
+               && get_temperature(attribute, error) != temperature::hot;
+    }
+
+    split_layout get_split_layout(std::vector<attribute> const& attributes, std::vector<annotation> const& annotations,
+                                  memory_size_table const& types)
+    {
+        std::vector<std::size_t> hot_order, cold_order;
+        for (auto index : optimize_field_order(attributes, types))
+            (is_cold_block_attribute(attributes[index], annotations) ? cold_order : hot_order).push_back(index);
+
+        split_layout layout;
+        layout.hot = get_field_layout(attributes, hot_order, types, false);
+        layout.cold = get_field_layout(attributes, cold_order, types, false);
+
+        // The presence bitmap and the pointer to the cold block follow the struct of the hot attributes
+        std::size_t offset = layout.hot.size.size;
+        if (auto const words = presence_words(count_optionals(attributes)); words != 0)
+        {
+            offset = align_to(offset, presence_word_bits / 8);
+            layout.presence_offset = offset;
+            offset += words * presence_word_bits / 8;
+        }
+        else
+            layout.presence_offset = offset;
+
+        offset = align_to(offset, cold_block_memory_size.alignment) + cold_block_memory_size.size;
+
+        layout.size.alignment = std::max(layout.hot.size.alignment, cold_block_memory_size.alignment);
+        layout.size.size = align_to(offset, layout.size.alignment);
+        return layout;
+    }
+
+    memory_size_table compute_memory_sizes(std::vector<ast const*> const& asts)
+    {
+        memory_size_table sizes;
+        std::unordered_map<std::string, std::pair<std::vector<attribute> const*, std::vector<annotation> const*>>
+            containers;
+        std::unordered_set<std::string> unions;
+
+        for (auto* elements : asts)
+        {
+            for (auto& elem : *elements)
+            {
+                if (auto* e = boost::get<enumeration>(&elem))
+                {
+                    auto const size = enum_size(e->alignment);
+                    sizes[e->name] = {size, size};
+                }
+                else if (auto* d = boost::get<data>(&elem))
+                    containers[d->name] = {&d->attributes, &d->annotations};
+                else if (auto* m = boost::get<message>(&elem))
+                    containers[m->name] = {&m->attributes, &m->annotations};
+                else if (auto* u = boost::get<tagged_union>(&elem))
+                {
+                    containers[u->name] = {&u->alternatives, &u->annotations};
+                    unions.insert(u->name);
+                }
+            }
+        }
+
+        // Containers are sized after the types they hold by value. Strings and repeated attributes hold their elements
+        // on the heap, so they don't depend on the size of their element type
+        std::function<void(std::string const&)> compute = [&](std::string const& name) {
+            if (!sizes.emplace(name, memory_size{}).second)
+                return;
+
+            auto [attributes_ptr, annotations] = containers[name];
+            auto& attributes = *attributes_ptr;
+            for (auto& attribute : attributes)
+            {
+                bool const is_repeated = attribute.specifier && *attribute.specifier == "repeated";
+                if (!is_repeated && containers.count(attribute.type))
+                    compute(attribute.type);
+            }
+
+            if (find_annotation(*annotations, "split"))
+            {
+                sizes[name] = get_split_layout(attributes, *annotations, sizes).size;
+                return;
+            }
+
+            if (!unions.count(name))
+            {
+                sizes[name] = get_field_layout(attributes, optimize_field_order(attributes, sizes), sizes).size;
+                return;
+            }
+
+            // std::variant stores its largest alternative followed by a one byte index
+            memory_size size;
+            for (auto& alternative : attributes)
+            {
+                auto alternative_size = get_memory_size(alternative, sizes);
+                size.size = std::max(size.size, alternative_size.size);
+                size.alignment = std::max(size.alignment, alternative_size.alignment);
+            }
+
+            size.size = align_to(size.size + 1, size.alignment);
+            sizes[name] = size;
+        };
+
+        for (auto& [name, container] : containers)
+            compute(name);
+
+        return sizes;
+    }
+
+    bool get_soa_columns(data const& data, wire_size_table const& types,
+                         std::unordered_map<std::string, value_range> const& enum_ranges,
+                         std::vector<soa_column>& out_columns)
+    {
+        out_columns.clear();
+        if (data.attributes.empty() || find_annotation(data.annotations, "bitpacked")
+            || find_annotation(data.annotations, "split"))
+            return false;
+
+        for (auto& attribute : data.attributes)
+        {
+            if (attribute.specifier || attribute.arraySize)
+                return false;
+
+            // A column is a repeated attribute of the same type, which has to be copyable in bulk
+            auto column = attribute;
+            column.specifier = "repeated";
+
+            auto width = get_bulk_width(column, data.annotations, types, enum_ranges);
+            if (width == 0)
+                return false;
+
+            out_columns.push_back({attribute.name, attribute.type, width});
+        }
+
+        return true;
+    }
+
+    soa_column_table compute_soa_columns(std::vector<ast const*> const& asts, wire_size_table const& types,
+                                         std::unordered_map<std::string, value_range> const& enum_ranges)
+    {
+        soa_column_table columns;
+        for (auto* elements : asts)
+        {
+            for (auto& elem : *elements)
+            {
+                std::vector<soa_column> data_columns;
+                if (auto* d = boost::get<data>(&elem); d && get_soa_columns(*d, types, enum_ranges, data_columns))
+                    columns[d->name] = std::move(data_columns);
+            }
+        }
+
+        return columns;
+    }
+}
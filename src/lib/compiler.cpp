@@ -14,15 +14,29 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <flatmessage/ast/printer.hpp>
+#include <flatmessage/ast/types.hpp>
 #include <flatmessage/compiler.hpp>
 #include <flatmessage/exception.hpp>
+#include <flatmessage/file_system.hpp>
+#include <flatmessage/generation_cache.hpp>
 #include <flatmessage/generator/template_generator.hpp>
+#include <flatmessage/module_cache.hpp>
 #include <flatmessage/parser.hpp>
+#include <flatmessage/symbol_table.hpp>
+#include <flatmessage/version.hpp>
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -30,18 +44,6 @@ namespace flatmessage
 {
     namespace fs = boost::filesystem;
 
-    // Returns a list of paths with all .input files that can be found in the working_folder
-    std::vector<fs::path> get_all_files_from(fs::path const& directory)
-    {
-        std::vector<fs::path> result;
-
-        auto range = boost::make_iterator_range(fs::directory_iterator(directory), {});
-        for (auto& entry : range)
-            result.emplace_back(entry.path());
-
-        return result;
-    }
-
     // Representation of a translation unit
     struct translation_unit
     {
@@ -125,6 +127,13 @@ namespace flatmessage
                     for (auto const& attribute : data.attributes)
                         (*this)(attribute);
                 }
+                void operator()(flatmessage::ast::tagged_union const& tagged_union)
+                {
+                    exported_types.push_back(tagged_union.name);
+
+                    for (auto const& alternative : tagged_union.alternatives)
+                        (*this)(alternative);
+                }
                 void operator()(flatmessage::ast::module_decl const& module_decl) { module = module_decl.name; }
                 void operator()(flatmessage::ast::import_decl const& import_decl)
                 {
@@ -149,6 +158,71 @@ namespace flatmessage
         }
     };
 
+    // Returns an estimate of how expensive it is to generate the code of the given translation_unit
+    std::size_t render_cost(translation_unit const& translation_unit)
+    {
+        struct visitor
+        {
+            using result_type = std::size_t;
+
+            std::size_t operator()(flatmessage::ast::enumeration const& enumeration) const
+            {
+                return 1 + enumeration.values.size();
+            }
+            std::size_t operator()(flatmessage::ast::message const& message) const
+            {
+                return 1 + message.attributes.size();
+            }
+            std::size_t operator()(flatmessage::ast::data const& data) const { return 1 + data.attributes.size(); }
+            std::size_t operator()(flatmessage::ast::tagged_union const& tagged_union) const
+            {
+                return 1 + tagged_union.alternatives.size();
+            }
+            std::size_t operator()(flatmessage::ast::module_decl const&) const { return 1; }
+            std::size_t operator()(flatmessage::ast::import_decl const&) const { return 1; }
+            std::size_t operator()(flatmessage::ast::protocol_decl const&) const { return 1; }
+        } v;
+
+        std::size_t cost = 0;
+        for (auto& elem : translation_unit.ast)
+            cost += boost::apply_visitor(v, elem);
+
+        return cost;
+    }
+
+    // Distributes the translation_units that should be build across bucket_count buckets so that every bucket has
+    // roughly the same render_cost. The result only depends on the translation_units, so every process computes the
+    // same distribution. Returns the bucket of every translation unit or -1 for those that aren't build
+    std::vector<int> balance(std::vector<translation_unit> const& translation_units, int bucket_count)
+    {
+        std::vector<std::size_t> order;
+        std::vector<std::size_t> costs;
+        for (std::size_t i = 0; i < translation_units.size(); ++i)
+        {
+            costs.push_back(render_cost(translation_units[i]));
+            if (translation_units[i].build)
+                order.push_back(i);
+        }
+
+        // Longest processing time first: hand the most expensive translation unit to the least loaded bucket
+        std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+            if (costs[lhs] != costs[rhs])
+                return costs[lhs] > costs[rhs];
+            return translation_units[lhs].file_path < translation_units[rhs].file_path;
+        });
+
+        std::vector<int> buckets(translation_units.size(), -1);
+        std::vector<std::size_t> loads(bucket_count, 0);
+        for (auto index : order)
+        {
+            auto bucket = std::min_element(loads.begin(), loads.end()) - loads.begin();
+            loads[bucket] += costs[index];
+            buckets[index] = static_cast<int>(bucket);
+        }
+
+        return buckets;
+    }
+
     class compiler_impl
     {
         // Returns true if the given translation_unit's module name hasn't been encountered yet or false
@@ -188,6 +262,330 @@ namespace flatmessage
             return "";
         }
 
+        // Returns empty string if the annotations of every attribute of the given translation_unit fit the attribute,
+        // if the dirty fields of every [delta] message fit into its mask and if the alternatives of every union fit
+        // into its tag. Returns the reason why they don't otherwise
+        std::string ensure_valid_attributes(translation_unit const& translation_unit) const
+        {
+            std::string error_message;
+            auto check = [&](std::vector<ast::attribute> const& attributes,
+                             std::vector<ast::annotation> const& container_annotations) {
+                for (auto& attribute : attributes)
+                {
+                    ast::get_integer_encoding(attribute, container_annotations, error_message);
+                    if (!error_message.empty())
+                        return;
+
+                    ast::quantization quantization;
+                    ast::get_quantization(attribute, quantization, error_message);
+                    if (!error_message.empty())
+                        return;
+
+                    ast::value_range range;
+                    ast::get_range(attribute, range, error_message);
+                    if (!error_message.empty())
+                        return;
+
+                    ast::get_temperature(attribute, error_message);
+                    if (!error_message.empty())
+                        return;
+                }
+            };
+
+            for (auto& elem : translation_unit.ast)
+            {
+                if (auto* message = boost::get<ast::message>(&elem))
+                {
+                    check(message->attributes, message->annotations);
+
+                    if (error_message.empty() && ast::find_annotation(message->annotations, "delta")
+                        && message->attributes.size() > ast::max_delta_fields)
+                        error_message = fmt::format("Message '{0}' has {1} attributes but a delta message may only "
+                                                    "have up to {2}",
+                                                    message->name, message->attributes.size(), ast::max_delta_fields);
+                }
+                else if (auto* data = boost::get<ast::data>(&elem))
+                    check(data->attributes, data->annotations);
+                else if (auto* tagged_union = boost::get<ast::tagged_union>(&elem))
+                {
+                    check(tagged_union->alternatives, tagged_union->annotations);
+                    if (!error_message.empty())
+                        break;
+
+                    // The tag already tells which alternative is present and the alternatives share their storage
+                    auto const& alternatives = tagged_union->alternatives;
+                    auto invalid = std::find_if(alternatives.begin(), alternatives.end(), [](auto& alternative) {
+                        return ast::is_optional(alternative) || alternative.defaultValue;
+                    });
+
+                    if (invalid != alternatives.end())
+                        error_message = fmt::format("Alternative '{0}' of union '{1}' can neither be optional nor "
+                                                    "have a default value",
+                                                    invalid->name, tagged_union->name);
+                    else if (ast::find_annotation(tagged_union->annotations, "bitpacked"))
+                        error_message = fmt::format("Union '{0}' can't be bitpacked", tagged_union->name);
+                    else if (alternatives.size() > ast::max_union_alternatives)
+                        error_message = fmt::format("Union '{0}' has {1} alternatives but a union may only have up "
+                                                    "to {2}",
+                                                    tagged_union->name, alternatives.size(),
+                                                    ast::max_union_alternatives);
+                }
+
+                if (!error_message.empty())
+                    break;
+            }
+
+            return error_message;
+        }
+
+        // Returns empty string if every [soa] attribute of the given translation_unit is a repeated attribute of a data
+        // structure whose columns are known and that isn't part of a bitpacked container or union. Returns the reason
+        // why it isn't otherwise
+        std::string ensure_valid_soa_attributes(translation_unit const& translation_unit) const
+        {
+            std::string error_message;
+            auto check = [&](std::string const& container, std::vector<ast::attribute> const& attributes,
+                             std::vector<ast::annotation> const& container_annotations, bool is_union) {
+                for (auto& attribute : attributes)
+                {
+                    if (!ast::find_annotation(attribute.annotations, "soa"))
+                        continue;
+
+                    if (is_union || ast::find_annotation(container_annotations, "bitpacked"))
+                        error_message = fmt::format("Attribute '{0}' of '{1}' can't be stored as structure of "
+                                                    "arrays inside a {2}",
+                                                    attribute.name, container,
+                                                    is_union ? "union" : "bitpacked container");
+                    else if (!attribute.specifier || *attribute.specifier != "repeated" || attribute.arraySize)
+                        error_message = fmt::format("Attribute '{0}' of '{1}' has to be repeated to be stored as "
+                                                    "structure of arrays",
+                                                    attribute.name, container);
+                    else if (_symbols.soa_columns.find(attribute.type) == _symbols.soa_columns.end())
+                        error_message = fmt::format("Attribute '{0}' of '{1}' can't be stored as structure of "
+                                                    "arrays, since '{2}' isn't a data structure of required numbers "
+                                                    "and enums",
+                                                    attribute.name, container, attribute.type);
+
+                    if (!error_message.empty())
+                        return;
+                }
+            };
+
+            for (auto& elem : translation_unit.ast)
+            {
+                if (auto* message = boost::get<ast::message>(&elem))
+                    check(message->name, message->attributes, message->annotations, false);
+                else if (auto* data = boost::get<ast::data>(&elem))
+                    check(data->name, data->attributes, data->annotations, false);
+                else if (auto* tagged_union = boost::get<ast::tagged_union>(&elem))
+                    check(tagged_union->name, tagged_union->alternatives, tagged_union->annotations, true);
+
+                if (!error_message.empty())
+                    break;
+            }
+
+            return error_message;
+        }
+
+        // Returns the content of the given template_path followed by the content of every template it includes. Like
+        // inja, every include is resolved relative to the template that contains it
+        std::string template_closure(fs::path const& template_path)
+        {
+            if (auto itr = _template_closures.find(template_path.string()); itr != _template_closures.end())
+                return itr->second;
+
+            std::string closure;
+            std::unordered_set<std::string> visited;
+            std::vector<fs::path> pending{template_path};
+            while (!pending.empty())
+            {
+                auto path = pending.back();
+                pending.pop_back();
+
+                if (!visited.insert(path.string()).second)
+                    continue;
+
+                std::string content;
+                _file_system.read_file(path, content);
+
+                for (auto& include : generator::find_includes(content))
+                    pending.emplace_back(path.parent_path() / include);
+
+                closure += fmt::format("{0}\n{1}\n{2}\n", path.filename().string(), content.size(), content);
+            }
+
+            return _template_closures[template_path.string()] = closure;
+        }
+
+        // Returns the generation_cache key of the given translation_unit. It covers the AST of the translation_unit and
+        // of every module that it imports or whose types it references, transitively, the template it is rendered
+        // with, the given file_extension and flags, the set of known types with their ranges and sizes and the
+        // compiler's version
+        std::string cache_key(translation_unit const& translation_unit, std::string const& file_extension,
+                              compiler_flags flags)
+        {
+            std::ostringstream material;
+            material << std::setprecision(17);
+            material << VERSION << '\n' << file_extension << '\n' << static_cast<int>(flags) << '\n';
+            material << template_closure(translation_unit.template_path);
+
+            std::set<std::string> known_types{_symbols.enums.begin(), _symbols.enums.end()};
+            for (auto& type : known_types)
+            {
+                auto range = _symbols.enum_ranges.find(type);
+                material << "enum " << type << ' ' << range->second.min << ' ' << range->second.max << '\n';
+            }
+
+            known_types = {_symbols.data.begin(), _symbols.data.end()};
+            for (auto& type : known_types)
+            {
+                auto size = _symbols.wire_sizes.find(type);
+                auto memory_size = _symbols.memory_sizes.find(type);
+                material << "data " << type << ' ' << size->second.size << ' ' << size->second.is_fixed << ' '
+                         << size->second.is_bounded << ' ' << memory_size->second.size << ' '
+                         << memory_size->second.alignment << '\n';
+            }
+
+            if (auto itr = _symbols.message_ids.find(translation_unit.protocol); itr != _symbols.message_ids.end())
+            {
+                // The dispatch table lists the messages of every module of the protocol
+                auto const& modules = _symbols.message_modules.at(translation_unit.protocol);
+                std::map<std::string, int> ids{itr->second.begin(), itr->second.end()};
+                for (auto& [message, id] : ids)
+                    material << "id " << message << ' ' << id << ' ' << modules.at(message) << '\n';
+
+                if (auto owner = _symbols.dispatch_modules.find(translation_unit.protocol);
+                    owner != _symbols.dispatch_modules.end())
+                    material << "dispatch " << owner->second << '\n';
+            }
+
+            ast::print(material, translation_unit.ast);
+
+            // Types are found through the exports of every module, whether it is imported or not
+            std::vector<std::string> pending;
+            auto add_dependencies = [&](auto const& dependent) {
+                pending.insert(pending.end(), dependent.imported_modules.begin(), dependent.imported_modules.end());
+                for (auto& type : dependent.imported_types)
+                {
+                    if (auto itr = _type_modules.find(type); itr != _type_modules.end())
+                        pending.push_back(itr->second);
+                }
+            };
+
+            std::unordered_set<std::string> visited{translation_unit.module};
+            add_dependencies(translation_unit);
+            while (!pending.empty())
+            {
+                auto module = pending.back();
+                pending.pop_back();
+
+                auto itr = _modules.find(module);
+                if (itr == _modules.end() || !visited.insert(module).second)
+                    continue;
+
+                ast::print(material, itr->second.ast);
+                add_dependencies(itr->second);
+            }
+
+            return generation_cache::make_key(material.str());
+        }
+
+        // Assigns a wire id to every message of a protocol and returns whether it succeeded. A message keeps the id
+        // that its 'id' annotation pins, all others get the smallest free ids in the order of their declaration,
+        // ordered by module name. Every protocol's ids are dense and start at 0, unless pinned ids leave gaps. Also
+        // records which module declares every message and which module generates the protocol's dispatch table.
+        // Unpinned ids are only stable as long as the schema doesn't change: declaring a message or module in front of
+        // them renumbers them. Every message whose id has to stay the same across schema versions, i.e. every message
+        // that peers built from different schema versions exchange, has to pin its id with [id=N]
+        bool assign_message_ids(std::vector<translation_unit> const& translation_units)
+        {
+            std::vector<translation_unit const*> ordered;
+            for (auto& translation_unit : translation_units)
+            {
+                if (!translation_unit.protocol.empty())
+                    ordered.push_back(&translation_unit);
+            }
+
+            std::stable_sort(ordered.begin(), ordered.end(),
+                             [](auto const* lhs, auto const* rhs) { return lhs->module < rhs->module; });
+
+            // Maps the used ids to the names of their messages, by protocol name
+            std::unordered_map<std::string, std::map<int, std::string>> used_ids;
+            std::vector<std::pair<translation_unit const*, ast::message const*>> unpinned;
+
+            for (auto* translation_unit : ordered)
+            {
+                auto& ids = _symbols.message_ids[translation_unit->protocol];
+                auto& modules = _symbols.message_modules[translation_unit->protocol];
+                auto& used = used_ids[translation_unit->protocol];
+
+                if (translation_unit->build)
+                    _symbols.dispatch_modules.try_emplace(translation_unit->protocol, translation_unit->module);
+
+                for (auto& elem : translation_unit->ast)
+                {
+                    auto* message = boost::get<ast::message>(&elem);
+                    if (!message)
+                        continue;
+
+                    if (ids.find(message->name) != ids.end())
+                    {
+                        error(*translation_unit,
+                              fmt::format("Message '{0}' is declared more than once in protocol '{1}'", message->name,
+                                          translation_unit->protocol));
+                        return false;
+                    }
+
+                    modules[message->name] = translation_unit->module;
+
+                    auto annotation = std::find_if(message->annotations.begin(), message->annotations.end(),
+                                                   [](ast::annotation const& a) { return a.name == "id"; });
+                    if (annotation == message->annotations.end())
+                    {
+                        ids[message->name] = -1;
+                        unpinned.emplace_back(translation_unit, message);
+                        continue;
+                    }
+
+                    auto* id = annotation->value ? boost::get<int>(&*annotation->value) : nullptr;
+                    if (!id || *id < 0 || *id > ast::max_message_id)
+                    {
+                        error(*translation_unit,
+                              fmt::format("The id of message '{0}' must be an integer between 0 and {1}",
+                                          message->name, ast::max_message_id));
+                        return false;
+                    }
+
+                    if (auto itr = used.find(*id); itr != used.end())
+                    {
+                        error(*translation_unit,
+                              fmt::format("Message '{0}' uses id {1} which is already used by message '{2}' in "
+                                          "protocol '{3}'",
+                                          message->name, *id, itr->second, translation_unit->protocol));
+                        return false;
+                    }
+
+                    ids[message->name] = *id;
+                    used[*id] = message->name;
+                }
+            }
+
+            std::unordered_map<std::string, int> next_ids;
+            for (auto& [translation_unit, message] : unpinned)
+            {
+                auto& used = used_ids[translation_unit->protocol];
+                auto& next = next_ids[translation_unit->protocol];
+
+                while (used.find(next) != used.end())
+                    ++next;
+
+                _symbols.message_ids[translation_unit->protocol][message->name] = next;
+                used[next] = message->name;
+            }
+
+            return true;
+        }
+
         // Displays the given error_message and some information about the given translation_unit to the standard output
         void error(translation_unit const& translation_unit, std::string const& error_message)
         {
@@ -198,12 +596,27 @@ namespace flatmessage
         // Stores translation_units by their module names
         std::unordered_map<std::string, translation_unit> _modules;
 
-        // A set of known enums. These are being exported by the translation units
-        std::unordered_set<std::string> _known_enums;
-        // A set of known data types. These are being exported by the translation units
-        std::unordered_set<std::string> _known_data;
+        // Everything known about the translation units. Populated by semantic_analyze
+        symbol_table _symbols;
+
+        // Stores the names of the modules that export enums and data by the names of the types. Populated by
+        // semantic_analyze
+        std::unordered_map<std::string, std::string> _type_modules;
+
+        // Caches the result of template_closure by the template's path
+        std::unordered_map<std::string, std::string> _template_closures;
+
+        // The file system that inputs are read from and outputs are written to
+        file_system& _file_system;
+        // Shared cache of parsed files. May be nullptr
+        module_cache* _module_cache = nullptr;
 
       public:
+        compiler_impl(file_system& file_system, module_cache* module_cache)
+          : _file_system{file_system}, _module_cache{module_cache}
+        {
+        }
+
         // Parses the given list of files using the given options and returns the list of parsed translation units
         // TODO: implement threading
         std::vector<translation_unit> parse_files(std::vector<boost::filesystem::path> const& files,
@@ -214,7 +627,12 @@ namespace flatmessage
             auto parse
                 = [&](boost::filesystem::path const& path, boost::filesystem::path const& template_path, bool build) {
                       std::string error_message;
-                      auto ast = parser::parse_file(path, error_message);
+                      std::shared_ptr<ast::ast const> ast;
+                      if (_module_cache)
+                          ast = _module_cache->parse_file(_file_system, path, error_message);
+                      else if (auto parsed = parser::parse_file(_file_system, path, error_message))
+                          ast = std::make_shared<ast::ast const>(std::move(*parsed));
+
                       if (!error_message.empty())
                           throw flatmessage::exception(error_message.c_str());
 
@@ -246,7 +664,7 @@ namespace flatmessage
             };
 
             for (auto& include_directory : options.include_directories)
-                parse_files(get_all_files_from(include_directory), false);
+                parse_files(_file_system.list_directory(include_directory), false);
 
             parse_files(files, true);
 
@@ -257,6 +675,8 @@ namespace flatmessage
         bool semantic_analyze(std::vector<translation_unit> const& translation_units)
         {
             _modules.clear();
+            _symbols = {};
+            _type_modules.clear();
             std::unordered_set<std::string> exported_types;
             // First pass - this->_modules hasn't been populated yet
             for (auto& translation_unit : translation_units)
@@ -272,8 +692,23 @@ namespace flatmessage
                 exported_types.insert(translation_unit.exported_enums.begin(), translation_unit.exported_enums.end());
                 exported_types.insert(translation_unit.exported_types.begin(), translation_unit.exported_types.end());
 
-                _known_data.insert(translation_unit.exported_types.begin(), translation_unit.exported_types.end());
-                _known_enums.insert(translation_unit.exported_enums.begin(), translation_unit.exported_enums.end());
+                _symbols.data.insert(translation_unit.exported_types.begin(), translation_unit.exported_types.end());
+                _symbols.enums.insert(translation_unit.exported_enums.begin(), translation_unit.exported_enums.end());
+
+                for (auto& type : translation_unit.exported_types)
+                    _type_modules.emplace(type, translation_unit.module);
+                for (auto& type : translation_unit.exported_enums)
+                    _type_modules.emplace(type, translation_unit.module);
+
+                for (auto& elem : translation_unit.ast)
+                {
+                    if (auto* enumeration = boost::get<ast::enumeration>(&elem))
+                    {
+                        _symbols.enum_ranges[enumeration->name] = ast::get_value_range(*enumeration);
+                        if (auto values = ast::get_sparse_values(*enumeration); !values.empty())
+                            _symbols.sparse_enum_values[enumeration->name] = std::move(values);
+                    }
+                }
             }
 
             // Second pass - this->_modules has been populated
@@ -291,34 +726,187 @@ namespace flatmessage
                     return false;
 #
                 }
+
+                if (auto reason = ensure_valid_attributes(translation_unit); !reason.empty())
+                {
+                    error(translation_unit, reason);
+                    return false;
+                }
             }
 
-            return true;
+            std::vector<ast::ast const*> asts;
+            for (auto& translation_unit : translation_units)
+                asts.push_back(&translation_unit.ast);
+            _symbols.wire_sizes = ast::compute_wire_sizes(asts);
+            _symbols.memory_sizes = ast::compute_memory_sizes(asts);
+            _symbols.soa_columns = ast::compute_soa_columns(asts, _symbols.wire_sizes, _symbols.enum_ranges);
+
+            // Whether a data structure can be stored as structure of arrays depends on the types of its attributes,
+            // which may be imported
+            for (auto& translation_unit : translation_units)
+            {
+                if (auto reason = ensure_valid_soa_attributes(translation_unit); !reason.empty())
+                {
+                    error(translation_unit, reason);
+                    return false;
+                }
+            }
+
+            return assign_message_ids(translation_units);
         }
 
-        // Generates the code
-        void generate_code(std::vector<translation_unit> const& translation_units, fs::path const& output_path,
-                           std::string const& file_extension)
+        // Returns the code generated from the given translation_unit. Looks it up in the given cache under the given
+        // key first, if a cache is given
+        std::string render(translation_unit const& translation_unit, generation_cache* cache, std::string const& key)
         {
+            std::string content;
+            if (cache && cache->load(key, content))
+                return content;
+
+            std::string template_content;
+            if (!_file_system.read_file(translation_unit.template_path, template_content))
+            {
+                throw flatmessage::exception(
+                    fmt::format("Invalid template path \"{0}\"", translation_unit.template_path.string()));
+            }
+
+            flatmessage::generator::template_generator generator(translation_unit.template_path.string(),
+                                                                 std::move(template_content), _file_system);
+
+            std::ostringstream out;
+            generator.generate(out, translation_unit.ast, _symbols);
+
+            content = out.str();
+            if (cache)
+                cache->store(key, content);
+
+            return content;
+        }
+
+        // Writes the code generated from the given translation_unit into its own file and returns that file's name
+        std::string generate_unit(translation_unit const& translation_unit, compiler_options const& options,
+                                  generation_cache* cache)
+        {
+            auto file_name = fmt::format("{0}.{1}", translation_unit.file_path.stem().string(), options.file_extension);
+            boost::filesystem::path out_file_path = fmt::format("{0}/{1}", options.output_path.string(), file_name);
+
+            std::string key;
+            if (cache)
+                key = cache_key(translation_unit, options.file_extension, options.flags);
+
+            // Hits can be copied straight from the cache if the outputs go to the disk
+            if (cache && !options.file_system && cache->fetch(key, out_file_path, options.cache_hard_links))
+                return file_name;
+
+            _file_system.write_file(out_file_path, render(translation_unit, cache, key));
+            return file_name;
+        }
+
+        // Generates one file per translation_unit
+        void generate_units(std::vector<translation_unit> const& translation_units, compiler_options const& options,
+                            generation_cache* cache)
+        {
+            auto shards = balance(translation_units, options.shard_count);
+
             // TODO: implement threading
-            for (auto& translation_unit : translation_units)
+            for (std::size_t i = 0; i < translation_units.size(); ++i)
             {
-                if (!translation_unit.build)
+                if (shards[i] == options.shard_index)
+                    generate_unit(translation_units[i], options, cache);
+            }
+        }
+
+        // Generates one file per translation_unit and options.batch_count unity files that each include the files of
+        // several translation_units. The files of the translation_units stay complete, so the includes between them
+        // resolve, while the build that consumes them only compiles the unity files
+        void generate_batches(std::vector<translation_unit> const& translation_units, compiler_options const& options,
+                              generation_cache* cache)
+        {
+            auto batches = balance(translation_units, options.batch_count);
+            auto in_shard = [&](int batch) { return batch >= 0 && batch % options.shard_count == options.shard_index; };
+
+            std::vector<std::string> contents(options.batch_count);
+            for (std::size_t i = 0; i < translation_units.size(); ++i)
+            {
+                if (!in_shard(batches[i]))
+                    continue;
+
+                auto file_name = generate_unit(translation_units[i], options, cache);
+                contents[batches[i]] += fmt::format("#include \"{0}\"\n", file_name);
+            }
+
+            // Empty batches are written as well so that the set of outputs doesn't depend on the inputs
+            for (int batch = 0; batch < options.batch_count; ++batch)
+            {
+                if (!in_shard(batch))
                     continue;
 
-                auto file_name = translation_unit.file_path.stem();
                 boost::filesystem::path out_file_path
-                    = fmt::format("{0}/{1}.{2}", output_path.string(), file_name.string(), file_extension);
+                    = fmt::format("{0}/unity_{1}.{2}", options.output_path.string(), batch, options.file_extension);
+                _file_system.write_file(out_file_path, contents[batch]);
+            }
+        }
+
+        // Writes the memory size and padding of every data and message of the translation_units that are build to the
+        // given out, in their optimized memory order and in their declared order. Split types also report the size of
+        // their inline part
+        void report_layouts(std::vector<translation_unit> const& translation_units, std::ostream& out) const
+        {
+            auto report = [&](translation_unit const& translation_unit, std::string const& name,
+                              std::vector<ast::attribute> const& attributes,
+                              std::vector<ast::annotation> const& annotations) {
+                std::vector<std::size_t> declared_order(attributes.size());
+                std::iota(declared_order.begin(), declared_order.end(), std::size_t{0});
+
+                auto declared = ast::get_field_layout(attributes, declared_order, _symbols.memory_sizes);
+                auto optimized = ast::get_field_layout(
+                    attributes, ast::optimize_field_order(attributes, _symbols.memory_sizes), _symbols.memory_sizes);
+
+                out << fmt::format("{0}.{1}: {2} bytes with {3} bytes of padding, {4} bytes with {5} bytes of padding "
+                                   "as declared",
+                                   translation_unit.module, name, optimized.size.size, optimized.padding,
+                                   declared.size.size, declared.padding);
+
+                if (ast::find_annotation(annotations, "split"))
+                {
+                    auto split = ast::get_split_layout(attributes, annotations, _symbols.memory_sizes);
+                    out << fmt::format(", split into {0} bytes inline and a cold block of {1} bytes",
+                                       split.size.size, split.cold.size.size);
+                }
 
-                if (!boost::filesystem::exists(out_file_path.parent_path()))
-                    boost::filesystem::create_directory(out_file_path.parent_path());
+                out << '\n';
+            };
 
-                std::ofstream out_file(out_file_path.c_str());
+            for (auto& translation_unit : translation_units)
+            {
+                if (!translation_unit.build)
+                    continue;
 
-                flatmessage::generator::template_generator generator(translation_unit.template_path.string());
-                generator.generate(out_file, translation_unit.ast, _known_enums, _known_data);
+                for (auto& elem : translation_unit.ast)
+                {
+                    if (auto* message = boost::get<ast::message>(&elem))
+                        report(translation_unit, message->name, message->attributes, message->annotations);
+                    else if (auto* data = boost::get<ast::data>(&elem))
+                        report(translation_unit, data->name, data->attributes, data->annotations);
+                }
             }
         }
+
+        // Generates the code
+        void generate_code(std::vector<translation_unit> const& translation_units, compiler_options const& options)
+        {
+            std::optional<generation_cache> cache;
+            if (!options.cache_directory.empty())
+                cache.emplace(options.cache_directory, options.cache_max_size);
+
+            if (options.batch_count > 0)
+                generate_batches(translation_units, options, cache ? &*cache : nullptr);
+            else
+                generate_units(translation_units, options, cache ? &*cache : nullptr);
+
+            if (cache)
+                cache->evict();
+        }
     };
 
     translation_unit merge_trnalsation_units(std::vector<translation_unit> const& tus)
@@ -334,16 +922,38 @@ namespace flatmessage
         return tu;
     }
 
-    bool compiler::compile_files(std::vector<fs::path> const& files, compiler_options const& options)
+    compile_session::compile_session(compiler_options options, std::shared_ptr<module_cache> modules)
+      : _options{std::move(options)}, _modules{std::move(modules)}
     {
-        compiler_impl impl;
+        if (_options.shard_count < 1 || _options.shard_index < 0 || _options.shard_index >= _options.shard_count)
+        {
+            throw flatmessage::exception(
+                fmt::format("Invalid shard {0} of {1}", _options.shard_index, _options.shard_count));
+        }
 
-        auto translation_units = impl.parse_files(files, options);
+        if (_options.batch_count < 0)
+            throw flatmessage::exception(fmt::format("Invalid batch count {0}", _options.batch_count));
+    }
+
+    bool compile_session::compile_files(std::vector<fs::path> const& files) const
+    {
+        os_file_system os_file_system;
+        compiler_impl impl{_options.file_system ? *_options.file_system : os_file_system, _modules.get()};
+
+        auto translation_units = impl.parse_files(files, _options);
 
         if (!impl.semantic_analyze(translation_units))
             return false;
 
-        impl.generate_code(translation_units, options.output_path, options.file_extension);
+        if ((_options.flags & compiler_flags::layout_report) == compiler_flags::layout_report)
+            impl.report_layouts(translation_units, std::cout);
+
+        impl.generate_code(translation_units, _options);
         return true;
     }
+
+    bool compiler::compile_files(std::vector<fs::path> const& files, compiler_options const& options)
+    {
+        return compile_session{options}.compile_files(files);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <flatmessage/file_system.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/range/iterator_range.hpp>
+
+#include <fstream>
+
+namespace flatmessage
+{
+    namespace fs = boost::filesystem;
+
+    bool os_file_system::read_file(fs::path const& path, std::string& out_content) const
+    {
+        std::ifstream file(path.string(), std::ios::binary);
+        if (!file)
+            return false;
+
+        out_content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    std::vector<fs::path> os_file_system::list_directory(fs::path const& directory) const
+    {
+        std::vector<fs::path> result;
+
+        auto range = boost::make_iterator_range(fs::directory_iterator(directory), {});
+        for (auto& entry : range)
+            result.emplace_back(entry.path());
+
+        return result;
+    }
+
+    bool os_file_system::write_file(fs::path const& path, std::string const& content)
+    {
+        boost::system::error_code error;
+        if (path.has_parent_path())
+            fs::create_directories(path.parent_path(), error);
+
+        fs::remove(path, error);
+
+        std::ofstream file(path.string(), std::ios::binary);
+        file << content;
+        return static_cast<bool>(file);
+    }
+
+    // Returns the key that memory_file_system stores the file at the given path by
+    std::string memory_key(fs::path const& path) { return path.lexically_normal().generic_string(); }
+
+    bool memory_file_system::read_file(fs::path const& path, std::string& out_content) const
+    {
+        std::lock_guard lock{_mutex};
+
+        auto itr = _files.find(memory_key(path));
+        if (itr == _files.end())
+            return false;
+
+        out_content = itr->second;
+        return true;
+    }
+
+    std::vector<fs::path> memory_file_system::list_directory(fs::path const& directory) const
+    {
+        std::lock_guard lock{_mutex};
+
+        auto normalized = directory.lexically_normal();
+        if (normalized.filename() == ".")
+            normalized = normalized.parent_path();
+
+        std::vector<fs::path> result;
+        auto key = normalized.generic_string();
+        for (auto& [path, content] : _files)
+        {
+            if (fs::path{path}.parent_path() == key)
+                result.emplace_back(path);
+        }
+
+        return result;
+    }
+
+    bool memory_file_system::write_file(fs::path const& path, std::string const& content)
+    {
+        std::lock_guard lock{_mutex};
+        _files[memory_key(path)] = content;
+        return true;
+    }
+
+    bool memory_file_system::exists(fs::path const& path) const
+    {
+        std::lock_guard lock{_mutex};
+        return _files.find(memory_key(path)) != _files.end();
+    }
+}
@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <flatmessage/generation_cache.hpp>
+
+#include <boost/range/iterator_range.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+namespace flatmessage
+{
+    namespace fs = boost::filesystem;
+
+    generation_cache::generation_cache(fs::path const& directory, std::uintmax_t max_size)
+      : _directory{directory}, _max_size{max_size}
+    {
+        fs::create_directories(_directory);
+    }
+
+    std::string generation_cache::make_key(std::string const& key_material)
+    {
+        boost::uuids::detail::sha1 sha;
+        sha.process_bytes(key_material.data(), key_material.size());
+
+        boost::uuids::detail::sha1::digest_type digest;
+        sha.get_digest(digest);
+
+        std::string key;
+        for (auto part : digest)
+            key += fmt::format("{:08x}", part);
+
+        return key;
+    }
+
+    bool generation_cache::fetch(std::string const& key, fs::path const& destination, bool hard_link)
+    {
+        auto path = entry_path(key);
+
+        // Another process may evict the entry at any time, so every failure is treated as a miss
+        boost::system::error_code error;
+        if (!fs::exists(path, error))
+            return false;
+
+        if (destination.has_parent_path())
+            fs::create_directories(destination.parent_path(), error);
+
+        fs::remove(destination, error);
+        if (hard_link)
+            fs::create_hard_link(path, destination, error);
+
+        if (!hard_link || error)
+        {
+            error.clear();
+            fs::copy_file(path, destination, fs::copy_options::overwrite_existing, error);
+        }
+
+        if (error)
+            return false;
+
+        // Entries are evicted by their modification time, so a hit marks the entry as recently used
+        fs::last_write_time(path, std::time(nullptr), error);
+        return true;
+    }
+
+    bool generation_cache::load(std::string const& key, std::string& out_content)
+    {
+        auto path = entry_path(key);
+
+        std::ifstream file(path.string(), std::ios::binary);
+        if (!file)
+            return false;
+
+        out_content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        boost::system::error_code error;
+        fs::last_write_time(path, std::time(nullptr), error);
+        return true;
+    }
+
+    void generation_cache::store(std::string const& key, std::string const& content)
+    {
+        auto path = entry_path(key);
+        fs::create_directories(path.parent_path());
+
+        // Write to a unique file first and rename it afterwards so that concurrent readers never see a partial entry
+        auto temp_path = path.parent_path() / fs::unique_path(path.filename().string() + ".%%%%-%%%%.tmp");
+        {
+            std::ofstream out(temp_path.string(), std::ios::binary);
+            out << content;
+        }
+
+        boost::system::error_code error;
+        fs::rename(temp_path, path, error);
+        if (error)
+            fs::remove(temp_path, error);
+    }
+
+    void generation_cache::evict()
+    {
+        struct entry
+        {
+            fs::path path;
+            std::time_t last_use;
+            std::uintmax_t size;
+        };
+
+        std::vector<entry> entries;
+        std::uintmax_t total_size = 0;
+
+        boost::system::error_code error;
+        for (auto& file : boost::make_iterator_range(fs::recursive_directory_iterator(_directory, error), {}))
+        {
+            if (!fs::is_regular_file(file.path(), error))
+                continue;
+
+            entry e{file.path(), fs::last_write_time(file.path(), error), fs::file_size(file.path(), error)};
+            if (error)
+                continue;
+
+            total_size += e.size;
+            entries.emplace_back(std::move(e));
+        }
+
+        if (total_size <= _max_size)
+            return;
+
+        std::sort(entries.begin(), entries.end(),
+                  [](entry const& lhs, entry const& rhs) { return lhs.last_use < rhs.last_use; });
+
+        for (auto& e : entries)
+        {
+            if (total_size <= _max_size)
+                break;
+
+            if (fs::remove(e.path, error))
+                total_size -= e.size;
+        }
+    }
+
+    fs::path generation_cache::entry_path(std::string const& key) const
+    {
+        return _directory / key.substr(0, 2) / key.substr(2);
+    }
+}
@@ -15,15 +15,28 @@ limitations under the License.
 */
 
 #include <flatmessage/ast/ast.hpp>
+#include <flatmessage/ast/types.hpp>
+#include <flatmessage/exception.hpp>
+#include <flatmessage/file_system.hpp>
 #include <flatmessage/generator/template_generator.hpp>
 
+#include <boost/filesystem/path.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/regex.hpp>
+
+#include <fmt/format.h>
+
 // clang-format off
 #include <nlohmann/json.hpp>
 #include <inja.hpp>
 // clang-format on
 
+#include <algorithm>
 #include <filesystem>
 #include <map>
+#include <numeric>
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <variant>
 #include <optional>
@@ -34,18 +47,30 @@ struct template_generator_impl
 {
     using result_type = void;
 
-    std::string generate(std::string const& templatePath, std::unordered_set<std::string> const& exported_enums,
-                         std::unordered_set<std::string> const& exported_data);
+    std::string generate(std::string const& templatePath, std::optional<std::string> const& templateContent,
+                         flatmessage::file_system const* fileSystem, flatmessage::symbol_table const& symbols);
 
     void operator()(flatmessage::ast::enumeration const& enumeration);
     void operator()(flatmessage::ast::message const& message);
     void operator()(flatmessage::ast::data const& data);
+    void operator()(flatmessage::ast::tagged_union const& tagged_union);
     void operator()(flatmessage::ast::module_decl const& module_decl);
     void operator()(flatmessage::ast::import_decl const& import_decl);
     void operator()(flatmessage::ast::protocol_decl const& protocol_decl);
 
     nlohmann::json ast;
 
+    // The value ranges of all known enums, used to bitpack attributes of an enum type
+    std::unordered_map<std::string, flatmessage::ast::value_range> enumRanges;
+    // The values of all known enums whose values leave gaps in their range, used to validate bitpacked enums
+    std::unordered_map<std::string, std::vector<std::int64_t>> sparseEnumValues;
+    // The wire sizes of all known types, used to size attributes and their containers
+    flatmessage::ast::wire_size_table wireSizes;
+    // The memory sizes of all known types, used to lay out the generated structs
+    flatmessage::ast::memory_size_table memorySizes;
+    // The columns of all known data that can be stored as structure of arrays
+    flatmessage::ast::soa_column_table soaColumns;
+
     std::vector<flatmessage::ast::enumeration> enums;
     std::vector<flatmessage::ast::message> messages;
     std::vector<flatmessage::ast::data> data;
@@ -58,19 +83,61 @@ namespace flatmessage::generator
 {
     template_generator::template_generator(std::string const& template_file_path) : _template{template_file_path} {}
 
-    bool template_generator::generate(std::ostream& out, flatmessage::ast::ast const& ast,
-                                      std::unordered_set<std::string> const& exported_enums,
-                                      std::unordered_set<std::string> const& exported_data)
+    template_generator::template_generator(std::string const& template_file_path, std::string template_content,
+                                           file_system const& file_system)
+      : _template{template_file_path}, _content{std::move(template_content)}, _file_system{&file_system}
+    {
+    }
+
+    bool template_generator::generate(std::ostream& out, flatmessage::ast::ast const& ast, symbol_table const& symbols)
     {
         template_generator_impl v;
 
+        // Attributes may use enums that are declared after them
+        v.enumRanges = symbols.enum_ranges;
+        v.sparseEnumValues = symbols.sparse_enum_values;
+        for (auto const& ast_ : ast)
+        {
+            if (auto* enumeration = boost::get<flatmessage::ast::enumeration>(&ast_))
+            {
+                v.enumRanges[enumeration->name] = flatmessage::ast::get_value_range(*enumeration);
+                if (auto values = flatmessage::ast::get_sparse_values(*enumeration); !values.empty())
+                    v.sparseEnumValues[enumeration->name] = std::move(values);
+            }
+        }
+
+        // Sizes that the semantic analysis computed win over the ones of this ast alone, which can't see imports
+        v.wireSizes = symbols.wire_sizes;
+        for (auto&& [name, size] : flatmessage::ast::compute_wire_sizes({&ast}))
+            v.wireSizes.emplace(name, size);
+
+        v.memorySizes = symbols.memory_sizes;
+        for (auto&& [name, size] : flatmessage::ast::compute_memory_sizes({&ast}))
+            v.memorySizes.emplace(name, size);
+
+        v.soaColumns = symbols.soa_columns;
+        for (auto&& [name, columns] : flatmessage::ast::compute_soa_columns({&ast}, v.wireSizes, v.enumRanges))
+            v.soaColumns.emplace(name, columns);
+
         for (auto const& ast_ : ast)
             boost::apply_visitor(v, ast_);
 
-        out << v.generate(_template, exported_enums, exported_data);
+        out << v.generate(_template, _content, _file_system, symbols);
 
         return true;
     }
+
+    std::vector<std::string> find_includes(std::string const& template_content)
+    {
+        static boost::regex const include_pattern{R"re(\{%\s*include\s+"([^"]+)"\s*%\})re"};
+
+        std::vector<std::string> includes;
+        for (auto& match : boost::make_iterator_range(
+                 boost::sregex_iterator(template_content.begin(), template_content.end(), include_pattern), {}))
+            includes.emplace_back(match[1].str());
+
+        return includes;
+    }
 } // namespace flatmessage::generator
 
 template <typename F> auto doWithAnnotation(json annotations, std::string const& name, F&& f)
@@ -102,7 +169,15 @@ json getAnnotations(std::vector<flatmessage::ast::annotation> const& annotations
         if (annotation.value)
             boost::apply_visitor(v, *annotation.value);
 
-        annos.emplace_back(json{{"name", annotation.name}, {"value", v.myValue}});
+        json arguments = json::array();
+        for (auto&& argument : annotation.arguments)
+        {
+            type_visitor argumentVisitor;
+            boost::apply_visitor(argumentVisitor, argument);
+            arguments.push_back(argumentVisitor.myValue);
+        }
+
+        annos.emplace_back(json{{"name", annotation.name}, {"value", v.myValue}, {"arguments", arguments}});
     }
 
     return annos;
@@ -132,12 +207,133 @@ std::string toMysqlType(std::string const& type)
     return {};
 }
 
+auto explode(std::string const& str, char delim = ' ')
+{
+    std::vector<std::string> result;
+    std::istringstream ss(str);
+
+    for (std::string token; std::getline(ss, token, delim);)
+        result.push_back(std::move(token));
+
+    return result;
+}
+
+// Describes the module with the given name the same way as an import
+json toImport(std::string const& module)
+{
+    auto path = explode(module, '.');
+    return {{"fullImport", module},
+            {"importName", path.back()},
+            {"importPath", std::vector<std::string>{path.begin(), path.end() - 1}}};
+}
+
+// Returns the qualified C++ name of the message with the given name that the module with the given name declares
+std::string qualifiedName(std::string const& module, std::string const& message)
+{
+    auto path = explode(module, '.');
+    path.back() = message;
+
+    std::string result;
+    for (auto& part : path)
+        result += (result.empty() ? "" : "::") + part;
+
+    return result;
+}
+
+// Sets the id of every message in the given ast and describes the dense table that maps the ids of its protocol to
+// their messages. The table covers the messages of every module of the protocol, but only the ast of the protocol's
+// dispatch module has hasDispatchTable set, so that a protocol that is spread over several modules gets exactly one
+// dispatcher. dispatchImports lists the other modules whose messages the table refers to
+void assignMessageIds(json& ast, flatmessage::symbol_table const& symbols)
+{
+    static std::unordered_map<std::string, int> const noIds;
+    static std::unordered_map<std::string, std::string> const noModules;
+
+    auto protocol = ast["protocol"].is_string() ? ast["protocol"].get<std::string>() : std::string{};
+    auto module = ast["fullModule"].is_string() ? ast["fullModule"].get<std::string>() : std::string{};
+
+    auto idItr = symbols.message_ids.find(protocol);
+    auto const& ids = idItr != symbols.message_ids.end() ? idItr->second : noIds;
+    auto moduleItr = symbols.message_modules.find(protocol);
+    auto const& modules = moduleItr != symbols.message_modules.end() ? moduleItr->second : noModules;
+    auto ownerItr = symbols.dispatch_modules.find(protocol);
+
+    for (auto&& message : ast["messages"])
+    {
+        auto id = ids.find(message["name"].get<std::string>());
+        message["hasId"] = id != ids.end();
+        message["id"] = id != ids.end() ? json(id->second) : json{};
+    }
+
+    std::map<int, std::string> messages;
+    for (auto& [name, id] : ids)
+        messages[id] = name;
+
+    json dispatchTable = json::array();
+    std::set<std::string> dispatchModules;
+    for (auto& [id, name] : messages)
+    {
+        while (dispatchTable.size() < static_cast<std::size_t>(id))
+        {
+            dispatchTable.push_back(
+                {{"id", dispatchTable.size()}, {"hasMessage", false}, {"name", json{}}, {"qualifiedName", json{}}});
+        }
+
+        auto const& messageModule = modules.at(name);
+        dispatchTable.push_back({{"id", id},
+                                 {"hasMessage", true},
+                                 {"name", name},
+                                 {"qualifiedName", qualifiedName(messageModule, name)}});
+
+        if (messageModule != module)
+            dispatchModules.insert(messageModule);
+    }
+
+    json dispatchImports = json::array();
+    for (auto& dispatchModule : dispatchModules)
+        dispatchImports.push_back(toImport(dispatchModule));
+
+    ast["hasDispatchTable"] = ownerItr != symbols.dispatch_modules.end() && ownerItr->second == module;
+    ast["dispatchTable"] = dispatchTable;
+    ast["dispatchImports"] = dispatchImports;
+    ast["messageIdCount"] = dispatchTable.size();
+}
+
+// Reads every template that the given content of the template at the given path includes from the given fileSystem
+// and registers it with the given env, so that inja doesn't look for it on the disk. Includes are resolved relative to
+// the template that contains them and registered before the template that includes them is parsed
+void includeTemplates(inja::Environment& env, flatmessage::file_system const& fileSystem,
+                      boost::filesystem::path const& path, std::string const& content,
+                      std::unordered_set<std::string>& registered)
+{
+    for (auto& name : flatmessage::generator::find_includes(content))
+    {
+        if (!registered.insert(name).second)
+            continue;
+
+        auto includedPath = path.parent_path() / name;
+        std::string includedContent;
+        if (!fileSystem.read_file(includedPath, includedContent))
+            throw flatmessage::exception(fmt::format("Invalid template path \"{0}\"", includedPath.string()));
+
+        includeTemplates(env, fileSystem, includedPath, includedContent, registered);
+        env.include_template(name, env.parse(includedContent));
+    }
+}
+
 std::string template_generator_impl::generate(std::string const& templatePath,
-                                              std::unordered_set<std::string> const& exported_enums,
-                                              std::unordered_set<std::string> const& exported_data)
+                                              std::optional<std::string> const& templateContent,
+                                              flatmessage::file_system const* fileSystem,
+                                              flatmessage::symbol_table const& symbols)
 {
+    auto const& exported_enums = symbols.enums;
+    auto const& exported_data = symbols.data;
+
+    assignMessageIds(ast, symbols);
+
     ast["hasEnums"] = !ast["enums"].empty();
     ast["hasData"] = !ast["data"].empty();
+    ast["hasUnions"] = !ast["unions"].empty();
     ast["hasMessages"] = !ast["messages"].empty();
     ast["hasImports"] = !ast["imports"].empty();
 
@@ -225,6 +421,17 @@ std::string template_generator_impl::generate(std::string const& templatePath,
         return annotations;
     });
 
+    if (templateContent)
+    {
+        if (fileSystem)
+        {
+            std::unordered_set<std::string> registered;
+            includeTemplates(env, *fileSystem, templatePath, *templateContent, registered);
+        }
+
+        return env.render(*templateContent, ast);
+    }
+
     return env.render_file(path.filename().string(), ast);
 }
 
@@ -253,11 +460,36 @@ void template_generator_impl::operator()(flatmessage::ast::enumeration const& en
     ast["enums"].push_back(obj);
 }
 
-json convertAttributes(std::vector<flatmessage::ast::attribute> const& attributes)
+json convertAttributes(std::vector<flatmessage::ast::attribute> const& attributes,
+                       std::vector<flatmessage::ast::annotation> const& containerAnnotations,
+                       std::unordered_map<std::string, flatmessage::ast::value_range> const& enumRanges,
+                       std::unordered_map<std::string, std::vector<std::int64_t>> const& sparseEnumValues,
+                       flatmessage::ast::wire_size_table const& wireSizes,
+                       flatmessage::ast::soa_column_table const& soaColumns)
 {
     json attribs;
+    std::size_t optionalIndex = 0;
+    std::size_t appendIndex = 0;
+
+    std::size_t inPlaceSize;
+    auto inPlaceOffsets = flatmessage::ast::get_in_place_offsets(attributes, containerAnnotations, wireSizes,
+                                                                 enumRanges, inPlaceSize);
+
     for (auto&& attrib : attributes)
     {
+        auto index = attribs.size();
+
+        // Optional attributes are numbered in their order, the number is their bit in the presence bitmap
+        json presenceIndex, presenceWord, presenceBit;
+        bool isOptional = flatmessage::ast::is_optional(attrib);
+        if (isOptional)
+        {
+            presenceIndex = optionalIndex;
+            presenceWord = optionalIndex / flatmessage::ast::presence_word_bits;
+            presenceBit = optionalIndex % flatmessage::ast::presence_word_bits;
+            ++optionalIndex;
+        }
+
         json specifier;
         if (attrib.specifier)
             specifier = *attrib.specifier;
@@ -270,8 +502,105 @@ json convertAttributes(std::vector<flatmessage::ast::attribute> const& attribute
         if (attrib.defaultValue)
             boost::apply_visitor(v, *attrib.defaultValue);
 
+        std::string error;
+        auto encoding = flatmessage::ast::get_integer_encoding(attrib, containerAnnotations, error);
+
+        flatmessage::ast::quantization quantization;
+        bool isQuantized = flatmessage::ast::get_quantization(attrib, quantization, error);
+
+        flatmessage::ast::value_range range;
+        bool hasRange = flatmessage::ast::get_range(attrib, range, error);
+
+        auto temperature = flatmessage::ast::get_temperature(attrib, error);
+
+        // Split containers hide where an attribute lives behind an accessor function of the same name
+        bool const isSplit = flatmessage::ast::find_annotation(containerAnnotations, "split") != nullptr;
+
+        std::int64_t packedOffset = 0;
+        auto packedBits = flatmessage::ast::get_packed_bits(attrib, enumRanges, packedOffset);
+
+        // Decoders reject packed values above packedMax and enums of a sparse type that aren't one of its enumerators
+        std::int64_t packedMax = 0;
+        if (attrib.type == "bool")
+            packedMax = 1;
+        else if (auto itr = enumRanges.find(attrib.type); itr != enumRanges.end())
+            packedMax = itr->second.max;
+        else if (hasRange)
+            packedMax = range.max;
+
+        json enumerators = json::array();
+        if (auto itr = sparseEnumValues.find(attrib.type); itr != sparseEnumValues.end())
+            enumerators = itr->second;
+
+        // Attributes in the bitstream of a bitpacked container occupy elementBits bits per element there
+        int bitstreamBits, elementBits;
+        auto size = flatmessage::ast::get_attribute_size(attrib, containerAnnotations, wireSizes, enumRanges,
+                                                          bitstreamBits);
+        auto elementSize = flatmessage::ast::get_element_size(attrib, containerAnnotations, wireSizes, enumRanges,
+                                                              elementBits);
+
+        auto bulkWidth = flatmessage::ast::get_bulk_width(attrib, containerAnnotations, wireSizes, enumRanges);
+
+        // A [soa] attribute is stored as one contiguous column per attribute of its data type
+        json columns = json::array();
+        std::size_t rowWidth = 0;
+        bool const isSoa = flatmessage::ast::find_annotation(attrib.annotations, "soa") != nullptr;
+        if (auto itr = soaColumns.find(attrib.type); isSoa && itr != soaColumns.end())
+        {
+            for (auto& column : itr->second)
+            {
+                columns.push_back({{"name", column.name}, {"type", column.type}, {"width", column.width}});
+                rowWidth += column.width;
+            }
+        }
+
+        // Strings and repeated attributes are what makes a type unbounded, so exactly the unbounded attributes allocate
+        // when they are decoded and need an allocator to decode into an arena
+        bool const isAllocated = !size.is_bounded;
+
+        // How the attribute is borrowed from the receive buffer when a message is decoded as view
+        std::string viewKind;
+        if (attrib.type == "string" && !attrib.arraySize && specifier != "repeated")
+            viewKind = "string";
+        else if (bulkWidth != 0)
+            viewKind = "span";
+
+        // How a generated builder writes the attribute straight into the wire buffer. Builders copy integers, floats
+        // and enums at their full width, arrays and repeated attributes of them and strings. Every other attribute has
+        // no builder kind and keeps its message from getting a builder
+        auto const* builtin = flatmessage::ast::find_builtin_type(attrib.type);
+        bool const isSingle = !attrib.arraySize && specifier != "repeated";
+        bool const isPlainType
+            = builtin ? attrib.type != "bool" && builtin->size != 0 : enumRanges.count(attrib.type) != 0;
+        bool const isPlain = isPlainType && encoding == flatmessage::ast::integer_encoding::fixed && !isQuantized
+                             && elementBits == 0;
+        std::string builderKind;
+        if (isSingle && attrib.type == "string")
+            builderKind = "string";
+        else if (isSingle && isPlain)
+            builderKind = "value";
+        else if (bulkWidth != 0 && attrib.arraySize && specifier != "repeated")
+            builderKind = "array";
+        else if (bulkWidth != 0 && !attrib.arraySize)
+            builderKind = "repeated";
+
+        // How templates compute the encoded size of an attribute whose size varies. The runtime sums up varints and
+        // quantized floats of arrays and repeated attributes, other arrays and repeated attributes are summed up
+        // element by element, so only their single elements get a dedicated kind
+        bool const isSingleFixed = !attrib.arraySize && specifier != "repeated" && elementSize.is_fixed;
+        std::string sizeKind = "variable";
+        if (encoding != flatmessage::ast::integer_encoding::fixed)
+            sizeKind = flatmessage::ast::to_string(encoding);
+        else if (isSingleFixed)
+            sizeKind = "fixed";
+        else if (isQuantized && quantization.kind == flatmessage::ast::quantization_kind::fixed_point)
+            sizeKind = "fixedPoint";
+        else if (isQuantized)
+            sizeKind = "quantized";
+
         // clang-format off
         attribs.push_back({
+            {"index", index},
             {"hasSpecifier", !specifier.empty()},
             {"specifier", specifier},
             {"type", attrib.type},
@@ -280,9 +609,55 @@ json convertAttributes(std::vector<flatmessage::ast::attribute> const& attribute
             {"name", attrib.name},
             {"hasDefaultValue", !v.myValue.empty()},
             {"defaultValue", v.myValue},
+            {"defaultLiteral", v.myValue.empty() ? json{} : json(v.myValue.dump())},
             {"hasAnnotations", !attrib.annotations.empty()},
             {"annotations", getAnnotations (attrib.annotations)},
             {"mysqlType", toMysqlType(attrib.type) },
+            {"encoding", flatmessage::ast::to_string(encoding)},
+            {"isQuantized", isQuantized},
+            {"quantization", {
+                {"kind", flatmessage::ast::to_string(quantization.kind)},
+                {"min", quantization.min},
+                {"max", quantization.max},
+                {"bits", quantization.bits},
+                {"step", quantization.step},
+            }},
+            {"hasRange", hasRange},
+            {"range", {{"min", range.min}, {"max", range.max}}},
+            {"packedBits", packedBits},
+            {"packedOffset", packedOffset},
+            {"packedMax", packedMax},
+            {"hasEnumerators", !enumerators.empty()},
+            {"enumerators", enumerators},
+            {"isInBitstream", elementBits != 0},
+            {"bitstreamBits", bitstreamBits},
+            {"elementBits", elementBits},
+            {"isOptional", isOptional},
+            {"presenceIndex", presenceIndex},
+            {"presenceWord", presenceWord},
+            {"presenceBit", presenceBit},
+            {"isFixedSize", size.is_fixed},
+            {"fixedSize", size.is_fixed ? json(size.size) : json{}},
+            {"isBounded", size.is_bounded},
+            {"maxSize", size.is_bounded ? json(size.size) : json{}},
+            {"isAllocated", isAllocated},
+            {"isElementAllocated", !elementSize.is_bounded},
+            {"sizeKind", sizeKind},
+            {"elementSize", elementSize.is_fixed ? json(elementSize.size) : json{}},
+            {"isBulk", bulkWidth != 0},
+            {"bulkWidth", bulkWidth},
+            {"isInPlace", inPlaceOffsets[index].has_value()},
+            {"wireOffset", inPlaceOffsets[index] ? json(*inPlaceOffsets[index]) : json{}},
+            {"appendIndex", inPlaceOffsets[index] ? json{} : json(appendIndex++)},
+            {"isView", !viewKind.empty()},
+            {"viewKind", viewKind},
+            {"builderKind", builderKind},
+            {"temperature", flatmessage::ast::to_string(temperature)},
+            {"isInColdBlock", flatmessage::ast::is_cold_block_attribute(attrib, containerAnnotations)},
+            {"access", isSplit ? attrib.name + "()" : attrib.name},
+            {"isSoa", isSoa},
+            {"columns", columns},
+            {"rowWidth", rowWidth},
         });
         // clang-format on
     }
@@ -290,43 +665,216 @@ json convertAttributes(std::vector<flatmessage::ast::attribute> const& attribute
     return attribs;
 }
 
+// Returns whether any of the given converted attributes is borrowed from the receive buffer when decoded as view
+bool hasViews(json const& attributes)
+{
+    return std::any_of(attributes.begin(), attributes.end(),
+                       [](json const& attrib) { return attrib["isView"] == true; });
+}
+
+// Returns whether a builder can write every one of the given converted attributes
+bool isBuildable(json const& attributes)
+{
+    return std::all_of(attributes.begin(), attributes.end(),
+                       [](json const& attrib) { return attrib["builderKind"] != ""; });
+}
+
+// Returns how many bits the given converted attributes occupy in the bitstream of their container
+int countBitstreamBits(json const& attributes)
+{
+    int bits = 0;
+    for (auto&& attrib : attributes)
+        bits += attrib["bitstreamBits"].get<int>();
+
+    return bits;
+}
+
+// Adds the memory layout of a message or data with the given attributes and annotations to its json obj. The
+// attributes in memory order get a list of their own, separate from the attributes in wire order
+void addMemoryLayout(json& obj, std::vector<flatmessage::ast::attribute> const& attributes,
+                     std::vector<flatmessage::ast::annotation> const& annotations,
+                     flatmessage::ast::memory_size_table const& memorySizes)
+{
+    std::vector<std::size_t> declaredOrder(attributes.size());
+    std::iota(declaredOrder.begin(), declaredOrder.end(), std::size_t{0});
+
+    auto declared = flatmessage::ast::get_field_layout(attributes, declaredOrder, memorySizes);
+    auto layout = flatmessage::ast::get_field_layout(
+        attributes, flatmessage::ast::optimize_field_order(attributes, memorySizes), memorySizes);
+
+    json memoryAttributes = json::array();
+    for (auto index : layout.order)
+    {
+        auto size = flatmessage::ast::get_memory_size(attributes[index], memorySizes);
+
+        auto& attrib = obj["attributes"][index];
+        attrib["memoryOffset"] = layout.offsets[index];
+        attrib["memorySize"] = size.size;
+        attrib["memoryAlignment"] = size.alignment;
+        memoryAttributes.push_back(attrib);
+    }
+
+    obj["memoryAttributes"] = memoryAttributes;
+    obj["memorySize"] = layout.size.size;
+    obj["memoryAlignment"] = layout.size.alignment;
+    obj["memoryPadding"] = layout.padding;
+    obj["presenceOffset"] = layout.presence_offset;
+    obj["declaredMemorySize"] = declared.size.size;
+    obj["declaredMemoryPadding"] = declared.padding;
+    obj["memoryBytesSaved"]
+        = static_cast<std::int64_t>(declared.size.size) - static_cast<std::int64_t>(layout.size.size);
+
+    bool const isSplit = flatmessage::ast::find_annotation(annotations, "split") != nullptr;
+    obj["isSplit"] = isSplit;
+    if (!isSplit)
+        return;
+
+    // Split types describe their two parts instead, the offsets are relative to the part an attribute lives in
+    auto split = flatmessage::ast::get_split_layout(attributes, annotations, memorySizes);
+    auto describePart = [&](flatmessage::ast::field_layout const& part) {
+        json partAttributes = json::array();
+        for (auto index : part.order)
+        {
+            auto& attrib = obj["attributes"][index];
+            attrib["memoryOffset"] = part.offsets[index];
+            partAttributes.push_back(attrib);
+        }
+        return partAttributes;
+    };
+
+    obj["hotAttributes"] = describePart(split.hot);
+    obj["coldAttributes"] = describePart(split.cold);
+    obj["memoryAttributes"] = obj["hotAttributes"];
+    for (auto&& attrib : obj["coldAttributes"])
+        obj["memoryAttributes"].push_back(attrib);
+
+    obj["memoryPadding"] = split.hot.padding + split.cold.padding;
+    obj["hotMemorySize"] = split.hot.size.size;
+    obj["coldMemorySize"] = split.cold.size.size;
+    obj["memorySize"] = split.size.size;
+    obj["memoryAlignment"] = split.size.alignment;
+    obj["presenceOffset"] = split.presence_offset;
+    obj["fitsCacheLine"] = split.size.size <= flatmessage::ast::cache_line_size;
+}
+
 void template_generator_impl::operator()(flatmessage::ast::message const& message)
 {
+    auto optionalCount = flatmessage::ast::count_optionals(message.attributes);
+    auto attributes = convertAttributes(message.attributes, message.annotations, enumRanges, sparseEnumValues,
+                                        wireSizes, soaColumns);
+
+    std::size_t inPlaceSize;
+    flatmessage::ast::get_in_place_offsets(message.attributes, message.annotations, wireSizes, enumRanges, inPlaceSize);
+
+    std::size_t fixedPartSize;
+    auto size = flatmessage::ast::get_container_size(message.attributes, message.annotations, wireSizes, enumRanges,
+                                                      fixedPartSize);
+
     // clang-format off
     json obj {
         {"name", message.name},
-        {"attributes", convertAttributes(message.attributes)},
+        {"attributes", attributes},
+        {"isFixedSize", size.is_fixed},
+        {"fixedSize", size.is_fixed ? json(size.size) : json{}},
+        {"isBounded", size.is_bounded},
+        {"maxSize", size.is_bounded ? json(size.size) : json{}},
+        {"fixedPartSize", fixedPartSize},
+        {"isAllocatorAware", !size.is_bounded},
+        {"inPlaceSize", inPlaceSize},
+        {"hasOptionals", optionalCount != 0},
+        {"optionalCount", optionalCount},
+        {"presenceWords", flatmessage::ast::presence_words(optionalCount)},
+        {"hasViews", hasViews(attributes)},
+        {"isBuildable", isBuildable(attributes)},
+        {"fieldCount", message.attributes.size()},
+        {"isDelta", flatmessage::ast::find_annotation(message.annotations, "delta") != nullptr},
+        {"isBitpacked", flatmessage::ast::find_annotation(message.annotations, "bitpacked") != nullptr},
+        {"hasBitstream", countBitstreamBits(attributes) != 0},
+        {"bitstreamBits", countBitstreamBits(attributes)},
+        {"isPooled", flatmessage::ast::find_annotation(message.annotations, "pooled") != nullptr},
         {"hasAnnotations", !message.annotations.empty()},
         {"annotations", getAnnotations (message.annotations)},
     };
     // clang-format on
+    addMemoryLayout(obj, message.attributes, message.annotations, memorySizes);
 
     ast["messages"].push_back(obj);
 }
 
 void template_generator_impl::operator()(flatmessage::ast::data const& data)
 {
+    auto optionalCount = flatmessage::ast::count_optionals(data.attributes);
+    auto attributes
+        = convertAttributes(data.attributes, data.annotations, enumRanges, sparseEnumValues, wireSizes, soaColumns);
+
+    std::size_t inPlaceSize;
+    flatmessage::ast::get_in_place_offsets(data.attributes, data.annotations, wireSizes, enumRanges, inPlaceSize);
+
+    std::size_t fixedPartSize;
+    auto size = flatmessage::ast::get_container_size(data.attributes, data.annotations, wireSizes, enumRanges,
+                                                      fixedPartSize);
+
     // clang-format off
     json obj {
         {"name", data.name},
-        {"attributes", convertAttributes(data.attributes)},
+        {"attributes", attributes},
+        {"isFixedSize", size.is_fixed},
+        {"fixedSize", size.is_fixed ? json(size.size) : json{}},
+        {"isBounded", size.is_bounded},
+        {"maxSize", size.is_bounded ? json(size.size) : json{}},
+        {"fixedPartSize", fixedPartSize},
+        {"isAllocatorAware", !size.is_bounded},
+        {"inPlaceSize", inPlaceSize},
+        {"hasOptionals", optionalCount != 0},
+        {"optionalCount", optionalCount},
+        {"presenceWords", flatmessage::ast::presence_words(optionalCount)},
+        {"hasViews", hasViews(attributes)},
+        {"isBitpacked", flatmessage::ast::find_annotation(data.annotations, "bitpacked") != nullptr},
+        {"hasBitstream", countBitstreamBits(attributes) != 0},
+        {"bitstreamBits", countBitstreamBits(attributes)},
+        {"isPooled", flatmessage::ast::find_annotation(data.annotations, "pooled") != nullptr},
         {"hasAnnotations", !data.annotations.empty()},
         {"annotations", getAnnotations (data.annotations)},
     };
     // clang-format on
+    addMemoryLayout(obj, data.attributes, data.annotations, memorySizes);
 
     ast["data"].push_back(obj);
 }
 
-auto explode(std::string const& str, char delim = ' ')
+void template_generator_impl::operator()(flatmessage::ast::tagged_union const& tagged_union)
 {
-    std::vector<std::string> result;
-    std::istringstream ss(str);
+    auto alternatives = convertAttributes(tagged_union.alternatives, tagged_union.annotations, enumRanges,
+                                          sparseEnumValues, wireSizes, soaColumns);
 
-    for (std::string token; std::getline(ss, token, delim);)
-        result.push_back(std::move(token));
+    // Only the alternative that is present is written behind the tag, so none of them has a fixed offset
+    for (std::size_t i = 0; i < alternatives.size(); ++i)
+    {
+        alternatives[i]["tag"] = i + 1;
+        alternatives[i]["isInPlace"] = false;
+        alternatives[i]["wireOffset"] = json{};
+    }
 
-    return result;
+    auto size = flatmessage::ast::get_union_size(tagged_union.alternatives, tagged_union.annotations, wireSizes,
+                                                  enumRanges);
+
+    // clang-format off
+    json obj {
+        {"name", tagged_union.name},
+        {"alternatives", alternatives},
+        {"alternativeCount", alternatives.size()},
+        {"tagSize", flatmessage::ast::union_tag_size},
+        {"isFixedSize", size.is_fixed},
+        {"fixedSize", json{}},
+        {"isBounded", size.is_bounded},
+        {"maxSize", size.is_bounded ? json(size.size) : json{}},
+        {"isAllocatorAware", !size.is_bounded},
+        {"hasAnnotations", !tagged_union.annotations.empty()},
+        {"annotations", getAnnotations (tagged_union.annotations)},
+    };
+    // clang-format on
+
+    ast["unions"].push_back(obj);
 }
 
 void template_generator_impl::operator()(flatmessage::ast::module_decl const& module_decl)
@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <flatmessage/file_system.hpp>
+#include <flatmessage/module_cache.hpp>
+#include <flatmessage/parser.hpp>
+
+#include <mutex>
+
+namespace flatmessage
+{
+    namespace fs = boost::filesystem;
+
+    std::shared_ptr<ast::ast const> module_cache::parse_file(file_system const& file_system, fs::path const& file_path,
+                                                            std::string& out_error)
+    {
+        std::string content;
+        if (!file_system.read_file(file_path, content))
+        {
+            out_error = "Invalid file path \"" + file_path.string() + "\"";
+            return nullptr;
+        }
+
+        // Comparing the content is cheap compared to parsing and doesn't depend on the resolution of file times
+        auto key = fs::absolute(file_path).lexically_normal().string();
+        {
+            std::shared_lock lock{_mutex};
+            if (auto itr = _entries.find(key); itr != _entries.end() && itr->second.content == content)
+                return itr->second.ast;
+        }
+
+        // Parse without holding the lock so that sessions that parse different files don't block each other
+        auto ast = parser::parse_string(content, out_error, file_path.string());
+        if (!ast)
+            return nullptr;
+
+        auto result = std::make_shared<ast::ast const>(std::move(*ast));
+
+        std::unique_lock lock{_mutex};
+        _entries[key] = {std::move(content), result};
+
+        return result;
+    }
+
+    void module_cache::clear()
+    {
+        std::unique_lock lock{_mutex};
+        _entries.clear();
+    }
+}
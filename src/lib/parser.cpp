@@ -1,5 +1,6 @@
 #include <flatmessage/ast/printer.hpp>
 #include <flatmessage/compiler.hpp>
+#include <flatmessage/file_system.hpp>
 #include <flatmessage/generator/template_generator.hpp>
 #include <flatmessage/parser.hpp>
 #include "parser/config.hpp"
@@ -9,7 +10,6 @@
 #include <boost/filesystem.hpp>
 
 #include <sstream>
-#include <fstream>
 
 namespace flatmessage::parser
 {
@@ -27,8 +27,8 @@ namespace flatmessage::parser
         error_handler_type error_handler(iter, end, out, source);
 
         auto const parser = with<flatmessage::parser::error_handler_tag>(std::ref(error_handler))[+(
-            flatmessage::message() | flatmessage::enumeration() | flatmessage::data() | flatmessage::module_decl()
-            | flatmessage::import_decl() | flatmessage::protocol_decl())];
+            flatmessage::message() | flatmessage::enumeration() | flatmessage::data() | flatmessage::tagged_union()
+            | flatmessage::module_decl() | flatmessage::import_decl() | flatmessage::protocol_decl())];
 
         using result_type = flatmessage::ast::ast;
 
@@ -54,15 +54,19 @@ namespace flatmessage::parser
 
     std::optional<ast::ast> parse_file(boost::filesystem::path const& file_path, std::string& out_error)
     {
-        std::ifstream file(file_path.string());
-        if (!file)
+        return parse_file(os_file_system{}, file_path, out_error);
+    }
+
+    std::optional<ast::ast> parse_file(file_system const& file_system, boost::filesystem::path const& file_path,
+                                       std::string& out_error)
+    {
+        std::string content;
+        if (!file_system.read_file(file_path, content))
         {
             out_error = "Invalid file path \"" + file_path.string() + "\"";
             return {};
         }
 
-        auto content = std::string{(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
-
         return parse_string(content, out_error, file_path.string());
     }
 }
\ No newline at end of file
@@ -26,6 +26,7 @@ namespace flatmessage
     {
         struct data_class;
         struct message_class;
+        struct tagged_union_class;
         struct enumeration_class;
         struct module_decl_class;
         struct import_decl_class;
@@ -33,17 +34,19 @@ namespace flatmessage
 
         using data_type = x3::rule<data_class, ast::data>;
         using message_type = x3::rule<message_class, ast::message>;
+        using tagged_union_type = x3::rule<tagged_union_class, ast::tagged_union>;
         using enumeration_type = x3::rule<enumeration_class, ast::enumeration>;
         using module_decl_type = x3::rule<module_decl_class, ast::module_decl>;
         using import_decl_type = x3::rule<import_decl_class, ast::import_decl>;
         using protocol_decl_type = x3::rule<protocol_decl_class, ast::protocol_decl>;
 
-        BOOST_SPIRIT_DECLARE(data_type, message_type, enumeration_type, module_decl_type, import_decl_type,
-                             protocol_decl_type);
+        BOOST_SPIRIT_DECLARE(data_type, message_type, tagged_union_type, enumeration_type, module_decl_type,
+                             import_decl_type, protocol_decl_type);
     }
 
     parser::data_type const& data();
     parser::message_type const& message();
+    parser::tagged_union_type const& tagged_union();
     parser::enumeration_type const& enumeration();
     parser::module_decl_type const& module_decl();
     parser::import_decl_type const& import_decl();
@@ -52,6 +52,7 @@ namespace flatmessage::parser
 
     data_type const data = "data";
     message_type const message = "message";
+    tagged_union_type const tagged_union = "union";
     annotation_type const annotation = "annotation";
     attribute_type const attribute = "attribute";
     default_value_type const default_value = "default_value";
@@ -73,11 +74,23 @@ namespace flatmessage::parser
     auto const quoted_string = x3::rule<struct quoted_string_class, std::string>("quoted_string")
         = lexeme['"' >> +(char_ - '"') >> '"'];
 
-    auto const value_def = x3::rule<struct value_class, ast::default_value_t>("value") = (int_ | quoted_string | double_);
+    // Only accepts numbers with a fraction or an exponent, so that integers are still parsed as int
+    auto const strict_double = x3::real_parser<double, x3::strict_real_policies<double>>{};
+
+    // An inclusive range of integers as lo..hi, kept as written
+    auto const int_range = x3::rule<struct int_range_class, std::string>("int_range")
+        = raw[lexeme[int_ >> ".." >> int_]];
+
+    auto const value_def = x3::rule<struct value_class, ast::default_value_t>("value")
+        = (int_range | strict_double | int_ | quoted_string);
 
     auto const default_value_def = '=' > value_def;
 
-    auto const annotation_def = '[' > identifier > -default_value > ']';
+    auto const annotation_arguments = x3::rule<struct annotation_arguments_class, std::vector<ast::annotation_value_t>>(
+                                          "annotation_arguments")
+        = '(' > (value_def % ',') > ')';
+
+    auto const annotation_def = '[' > identifier > -default_value > -annotation_arguments > ']';
     // To Test:
     // auto const annotation_def = '[' > ((identifier > -default_value) % ',') > ']';
     // This will create a std::vector of identifier pairs that are seperated by ','
@@ -86,6 +99,8 @@ namespace flatmessage::parser
 
     auto const message_def = *annotation >> lit("message") > identifier > '{' > attribute_vector > '}';
 
+    auto const tagged_union_def = *annotation >> lit("union") > identifier > '{' > attribute_vector > '}';
+
     auto const attribute_def
         = *annotation >> -specifier >> identifier >> -('[' > int_ > ']') > identifier > -(default_value) > ';';
 
@@ -115,8 +130,8 @@ namespace flatmessage::parser
 
     auto const protocol_decl_def = lit("protocol") > identifier > ';';
 
-    BOOST_SPIRIT_DEFINE(annotation, data, message, default_value, attribute, specifier, enumeration, enum_value,
-                        module_decl, import_decl, protocol_decl);
+    BOOST_SPIRIT_DEFINE(annotation, data, message, tagged_union, default_value, attribute, specifier, enumeration,
+                        enum_value, module_decl, import_decl, protocol_decl);
 
     struct data_class : annotation_base, error_handler_base
     {
@@ -124,6 +139,9 @@ namespace flatmessage::parser
     struct message_class : annotation_base, error_handler_base
     {
     };
+    struct tagged_union_class : annotation_base, error_handler_base
+    {
+    };
     struct default_value_class : annotation_base
     {
     };
@@ -157,6 +175,7 @@ namespace flatmessage
 {
     parser::data_type const& data() { return parser::data; }
     parser::message_type const& message() { return parser::message; }
+    parser::tagged_union_type const& tagged_union() { return parser::tagged_union; }
     parser::enumeration_type const& enumeration() { return parser::enumeration; }
     parser::module_decl_type const& module_decl() { return parser::module_decl; }
     parser::import_decl_type const& import_decl() { return parser::import_decl; }
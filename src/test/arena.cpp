@@ -0,0 +1,167 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/arena.hpp>
+#include <flatmessage/runtime/view.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::BasicChat;
+    using Test::Fixtures::Chat;
+    using Test::Fixtures::ChatView;
+
+    std::vector<std::uint8_t> encode(std::string const& text, std::vector<float> const& samples)
+    {
+        Chat message;
+        message.text = text;
+        message.samples = samples;
+        message.sender = 0;
+
+        BinaryEncoder encoder;
+        encoder << message;
+        return {encoder.bytes().begin(), encoder.bytes().end()};
+    }
+
+    template <typename Allocator>
+    BasicChat<Allocator> decode(std::vector<std::uint8_t> const& buffer, Allocator const& allocator)
+    {
+        rt::view_reader reader{buffer.data(), buffer.data() + buffer.size()};
+
+        ChatView view;
+        view.text = reader.read_string();
+        view.samples = reader.read_repeated<float>();
+        view.sender = reader.read<std::uint32_t>();
+
+        return {.text = rt::to_owned(view.text, allocator),
+                .samples = rt::to_owned(view.samples, allocator),
+                .sender = view.sender};
+    }
+
+    std::vector<std::vector<std::uint8_t>> make_batch(std::size_t count)
+    {
+        std::vector<std::vector<std::uint8_t>> batch;
+        for (std::size_t i = 0; i < count; ++i)
+            batch.push_back(encode(fmt::format("player {} moved to a new position", i), std::vector<float>(16, 1.0f)));
+
+        return batch;
+    }
+}
+
+// Allocations have to be aligned and resetting has to reuse the chunks instead of allocating new ones
+DEF_TEST(arena_reuses_chunks, arena)
+{
+    rt::arena arena{1024};
+
+    for (int tick = 0; tick < 3; ++tick)
+    {
+        arena.reset();
+        for (std::size_t alignment : {1, 2, 8, 16, 64})
+        {
+            auto* memory = arena.allocate(100, alignment);
+            EXPECT(reinterpret_cast<std::uintptr_t>(memory) % alignment == 0);
+        }
+
+        // Bigger than a chunk
+        EXPECT(arena.allocate(5000, 8) != nullptr);
+        EXPECT(arena.allocated() == 5 * 100 + 5000);
+        EXPECT(arena.chunk_count() == 2);
+    }
+
+    return true;
+}
+
+// Decoding a batch into an arena must stop allocating chunks once the arena fits a tick
+DEF_TEST(arena_decodes_batch, arena)
+{
+    auto batch = make_batch(100);
+    rt::arena arena{4096};
+
+    std::size_t chunks = 0;
+    for (int tick = 0; tick < 5; ++tick)
+    {
+        arena.reset();
+        std::pmr::polymorphic_allocator<> allocator{&arena};
+
+        std::pmr::vector<BasicChat<std::pmr::polymorphic_allocator<>>> messages{allocator};
+        for (auto& buffer : batch)
+            messages.push_back(decode(buffer, allocator));
+
+        EXPECT(messages.back().text == "player 99 moved to a new position");
+        EXPECT(messages.back().samples.size() == 16);
+        EXPECT(messages.back().samples.get_allocator().resource() == &arena);
+
+        if (tick == 0)
+            chunks = arena.chunk_count();
+        EXPECT(arena.chunk_count() == chunks);
+    }
+
+    return true;
+}
+
+// Compares decoding ticks of messages with the default allocator and with an arena that is reset per tick
+DEF_TIMED_TEST(arena_versus_heap, arena)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto batch = make_batch(1000);
+    constexpr int ticks = 100;
+    std::size_t checksum = 0;
+
+    auto start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        std::vector<BasicChat<std::allocator<char>>> messages;
+        for (auto& buffer : batch)
+            messages.push_back(decode(buffer, std::allocator<char>{}));
+
+        checksum += messages.size();
+    }
+    std::chrono::duration<double, std::nano> heap_time = clock::now() - start;
+
+    rt::arena arena;
+    start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        arena.reset();
+        std::pmr::polymorphic_allocator<> allocator{&arena};
+
+        std::pmr::vector<BasicChat<std::pmr::polymorphic_allocator<>>> messages{allocator};
+        for (auto& buffer : batch)
+            messages.push_back(decode(buffer, allocator));
+
+        checksum += messages.size();
+    }
+    std::chrono::duration<double, std::nano> arena_time = clock::now() - start;
+
+    auto messages = static_cast<double>(ticks * batch.size());
+    std::cout << fmt::format("heap {:.1f} ns/message, arena {:.1f} ns/message with {} chunks ({})",
+                             heap_time.count() / messages, arena_time.count() / messages, arena.chunk_count(), checksum)
+              << std::endl;
+}
@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/batch.hpp>
+#include <flatmessage/runtime/stream_decoder.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<sys/socket.h>)
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    std::span<std::uint8_t const> bytes(std::string const& text)
+    {
+        return {reinterpret_cast<std::uint8_t const*>(text.data()), text.size()};
+    }
+
+    std::string text(std::span<std::uint8_t const> bytes)
+    {
+        return {reinterpret_cast<char const*>(bytes.data()), bytes.size()};
+    }
+
+    // Returns the batch as it arrives on the other side of a gathering write
+    std::vector<std::uint8_t> flatten(rt::frame_batch const& batch)
+    {
+        std::vector<std::uint8_t> flat;
+        for (auto& segment : batch.segments())
+            flat.insert(flat.end(), segment.begin(), segment.end());
+
+        return flat;
+    }
+}
+
+// Frames with copied and referenced pieces have to arrive in order with their ids
+DEF_TEST(batch_round_trip, batch)
+{
+    std::string large(1000, 'x');
+
+    rt::frame_batch batch;
+    batch.add(1, bytes("hello"));
+    batch.begin_frame(2);
+    batch.write(bytes("head:"));
+    batch.reference(bytes(large));
+    batch.reference(bytes("small"));
+    batch.end_frame();
+    batch.add(3, {});
+
+    EXPECT(batch.frame_count() == 3);
+    EXPECT(!batch.is_contiguous());
+    EXPECT(batch.segments().size() == 3);
+    EXPECT(batch.segments()[1].data() == bytes(large).data());
+
+    auto flat = flatten(batch);
+    EXPECT(flat.size() == batch.size());
+
+    rt::batch_reader reader{flat.data(), flat.data() + flat.size()};
+    rt::frame frame;
+    EXPECT(reader.next(frame) && frame.id == 1 && text(frame.payload) == "hello");
+    EXPECT(reader.next(frame) && frame.id == 2 && text(frame.payload) == "head:" + large + "small");
+    EXPECT(reader.next(frame) && frame.id == 3 && frame.payload.empty());
+    EXPECT(!reader.next(frame) && !reader.failed());
+
+    batch.clear();
+    batch.add(4, bytes("again"));
+    EXPECT(batch.is_contiguous() && batch.contiguous().size() == batch.size());
+
+    return true;
+}
+
+// Truncated batches must fail and batches have to be readable by a stream_decoder as well
+DEF_TEST(batch_truncated_and_streamed, batch)
+{
+    rt::frame_batch batch;
+    for (std::uint32_t id = 0; id < 10; ++id)
+        batch.add(id, bytes(fmt::format("message {}", id)));
+
+    auto flat = flatten(batch);
+
+    rt::batch_reader truncated{flat.data(), flat.data() + flat.size() - 1};
+    rt::frame frame;
+    int frames = 0;
+    while (truncated.next(frame))
+        ++frames;
+    EXPECT(frames == 9 && truncated.failed());
+
+    rt::stream_decoder decoder;
+    std::vector<std::uint32_t> ids;
+    for (std::size_t offset = 0; offset < flat.size(); offset += 7)
+    {
+        decoder.feed(std::span{flat}.subspan(offset, std::min<std::size_t>(7, flat.size() - offset)),
+                     [&](std::span<std::uint8_t const> content) {
+                         ids.push_back(rt::batch_reader::parse_frame(content).id);
+                     });
+    }
+    EXPECT((ids == std::vector<std::uint32_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+
+    return true;
+}
+
+#if __has_include(<sys/socket.h>)
+// Compares sending every message of a tick with its own write with sending the tick as one batch through a local
+// socketpair
+DEF_TIMED_TEST(batch_versus_single_writes, batch)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr int ticks = 200;
+    constexpr int messages_per_tick = 200;
+
+    std::vector<std::string> payloads;
+    for (int i = 0; i < messages_per_tick; ++i)
+        payloads.push_back(fmt::format("player {} moved to {}, {}", i, i * 3, i * 7));
+
+    auto run = [&](auto&& send_tick) {
+        int sockets[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+
+        std::size_t expected = 0;
+        for (auto& payload : payloads)
+            expected += rt::FRAME_HEADER_SIZE + rt::FRAME_ID_SIZE + payload.size();
+        expected *= ticks;
+
+        std::thread receiver{[&] {
+            std::vector<std::uint8_t> buffer(64 * 1024);
+            rt::stream_decoder decoder;
+            std::size_t received = 0;
+            while (received < expected)
+            {
+                auto result = ::read(sockets[1], buffer.data(), buffer.size());
+                if (result <= 0)
+                    break;
+
+                received += static_cast<std::size_t>(result);
+                decoder.feed(std::span{buffer}.first(static_cast<std::size_t>(result)),
+                             [](std::span<std::uint8_t const>) {});
+            }
+        }};
+
+        auto start = clock::now();
+        for (int tick = 0; tick < ticks; ++tick)
+            send_tick(sockets[0]);
+        receiver.join();
+        std::chrono::duration<double, std::micro> time = clock::now() - start;
+
+        ::close(sockets[0]);
+        ::close(sockets[1]);
+        return time.count() / ticks;
+    };
+
+    auto single_time = run([&](int socket) {
+        rt::frame_batch single;
+        for (std::uint32_t id = 0; id < payloads.size(); ++id)
+        {
+            single.clear();
+            single.add(id, bytes(payloads[id]));
+            rt::write_batch(socket, single);
+        }
+    });
+
+    rt::frame_batch batch;
+    auto batch_time = run([&](int socket) {
+        batch.clear();
+        for (std::uint32_t id = 0; id < payloads.size(); ++id)
+            batch.add(id, bytes(payloads[id]));
+        rt::write_batch(socket, batch);
+    });
+
+    std::cout << fmt::format("{} messages per tick: single writes {:.1f} us/tick, one batch {:.1f} us/tick",
+                             messages_per_tick, single_time, batch_time)
+              << std::endl;
+}
+#endif
@@ -0,0 +1,345 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/binary_stream.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::Aim;
+    using Test::Fixtures::Head;
+    using Test::Fixtures::Progress;
+    using Test::Fixtures::Route;
+    using Test::Fixtures::Status;
+    using Test::Fixtures::Vector2d;
+
+    // Returns whether both ranges hold the same vectors. The generated Vector2d has no comparison operators
+    bool equal(std::span<Vector2d const> lhs, std::span<Vector2d const> rhs)
+    {
+        return std::ranges::equal(lhs, rhs, [](auto& l, auto& r) { return l.x == r.x && l.y == r.y; });
+    }
+
+    // A row of a repeated attribute that is stored as structure of arrays
+    struct sample
+    {
+        std::uint32_t id;
+        float value;
+
+        bool operator==(sample const&) const = default;
+    };
+}
+
+// Builtins and strings have to be written at their width in little endian and read back unchanged
+DEF_TEST(binary_stream_values, binary_stream)
+{
+    BinaryEncoder encoder;
+    encoder << std::uint16_t{0x0102} << true << std::string{"abc"} << -1.5f;
+
+    auto bytes = encoder.bytes();
+    EXPECT(bytes.size() == 2 + 1 + 4 + 3 + 4);
+    EXPECT(bytes[0] == 0x02 && bytes[1] == 0x01 && bytes[2] == 1 && bytes[3] == 3);
+
+    std::uint16_t number = 0;
+    bool flag = false;
+    std::string text;
+    float real = 0;
+    BinaryDecoder decoder{bytes};
+    decoder >> number >> flag >> text >> real;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(number == 0x0102 && flag && text == "abc" && real == -1.5f);
+
+    // Running past the end of the input fails and leaves the target untouched
+    decoder >> number;
+    EXPECT(decoder.failed() && number == 0x0102);
+
+    // A bool has to be 0 or 1 and a string's length must not exceed the input
+    std::vector<std::uint8_t> corrupt{2, 0xff, 0xff, 0xff, 0x7f};
+    BinaryDecoder bool_decoder{corrupt};
+    EXPECT((bool_decoder >> flag).failed());
+    BinaryDecoder string_decoder{std::span{corrupt}.subspan(1)};
+    EXPECT((string_decoder >> text).failed() && text == "abc");
+
+    return true;
+}
+
+// The presence bitmap precedes the fields and absent optional attributes are omitted
+DEF_TEST(binary_stream_optionals, binary_stream)
+{
+    Head absent{};
+    absent.code = 7;
+    absent.size = 300;
+
+    BinaryEncoder encoder;
+    encoder << absent;
+    EXPECT(encoder.bytes().size() == 4 + 1 + 2);
+
+    auto present = absent;
+    present.crc = 0xdeadbeef;
+    present.presence.set(0);
+
+    encoder.clear();
+    encoder << present;
+    EXPECT(encoder.bytes().size() == 4 + 1 + 2 + 4);
+
+    Head decoded{};
+    BinaryDecoder decoder{encoder.bytes()};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.presence.test(0) && decoded.crc == 0xdeadbeef && decoded.code == 7 && decoded.size == 300);
+
+    // A present attribute that is missing from the input fails
+    BinaryDecoder truncated{encoder.bytes().first(encoder.bytes().size() - 1)};
+    EXPECT((truncated >> decoded).failed());
+
+    return true;
+}
+
+// Arrays are written as their elements and repeated values behind their count, both in bulk
+DEF_TEST(binary_stream_bulk, binary_stream)
+{
+    std::array<std::uint32_t, 3> array{1, 0x01020304, 0xffffffff};
+    std::vector<float> repeated{0.5f, -2.0f};
+
+    BinaryEncoder encoder;
+    encoder.write_bulk(array).write_bulk(repeated);
+    EXPECT(encoder.bytes().size() == 12 + 4 + 8);
+    EXPECT(encoder.bytes()[4] == 0x04 && encoder.bytes()[12] == 2);
+
+    std::array<std::uint32_t, 3> decoded_array{};
+    std::vector<float> decoded_repeated;
+    BinaryDecoder decoder{encoder.bytes()};
+    decoder.read_bulk(decoded_array).read_bulk(decoded_repeated);
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded_array == array && decoded_repeated == repeated);
+
+    // A count beyond the input fails
+    BinaryDecoder truncated{encoder.bytes().first(encoder.bytes().size() - 1)};
+    truncated.read_bulk(decoded_array).read_bulk(decoded_repeated);
+    EXPECT(truncated.failed());
+
+    return true;
+}
+
+// Strings and generated types in arrays and repeated attributes are written one after the other, repeated ones behind
+// their 32 bit count
+DEF_TEST(binary_stream_containers, binary_stream)
+{
+    Route route;
+    route.names = {"north", "", "gate"};
+    route.points = {{1.0f, 2.0f}, {-3.0f, 0.5f}};
+    route.corners = {{{0.0f, 0.0f}, {4.0f, 0.0f}, {4.0f, 4.0f}, {0.0f, 4.0f}}};
+
+    BinaryEncoder encoder;
+    encoder << route;
+    auto const bytes = encoder.bytes();
+    EXPECT(bytes.size() == route.encoded_size());
+    EXPECT(bytes.size() == 4 + (4 + 5) + 4 + (4 + 4) + 4 + 2 * 8 + 4 * 8);
+    EXPECT(bytes[0] == 3 && bytes[4] == 5 && bytes[8] == 'n' && bytes[13] == 0 && bytes[25] == 2);
+
+    Route decoded;
+    BinaryDecoder decoder{bytes};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.names == route.names && equal(decoded.points, route.points));
+    EXPECT(equal(decoded.corners, route.corners));
+
+    // A count beyond the input fails before anything is allocated
+    std::vector<std::uint8_t> corrupt{0xff, 0xff, 0xff, 0x7f, 0};
+    BinaryDecoder corrupt_decoder{corrupt};
+    EXPECT((corrupt_decoder >> decoded).failed());
+
+    BinaryDecoder truncated_decoder{bytes.first(bytes.size() - 1)};
+    EXPECT((truncated_decoder >> decoded).failed());
+
+    return true;
+}
+
+// Structures of arrays are written as their count followed by one column after the other
+DEF_TEST(binary_stream_columns, binary_stream)
+{
+    rt::soa_vector<sample, &sample::id, &sample::value> samples;
+    samples.push_back({1, 0.5f});
+    samples.push_back({2, -1.0f});
+
+    BinaryEncoder encoder;
+    encoder.write_columns(samples);
+    EXPECT(encoder.bytes().size() == 4 + 2 * 8);
+    EXPECT(encoder.bytes()[4] == 1 && encoder.bytes()[8] == 2);
+
+    decltype(samples) decoded;
+    BinaryDecoder decoder{encoder.bytes()};
+    decoder.read_columns(decoded);
+    EXPECT(!decoder.failed() && decoder.remaining() == 0 && decoded == samples);
+
+    BinaryDecoder truncated{encoder.bytes().first(encoder.bytes().size() - 1)};
+    EXPECT(truncated.read_columns(decoded).failed());
+
+    return true;
+}
+
+// Attributes with a varint or zigzag encoding have to be written as varints, take exactly their encoded_size() and
+// fail to decode if they don't fit their type
+DEF_TEST(binary_stream_varints, binary_stream)
+{
+    Progress small{};
+    small.tick = 5;
+    small.delta = -3;
+    small.offset = 7;
+    small.ids = {1, 2, 300};
+
+    BinaryEncoder encoder;
+    encoder << small;
+    EXPECT(encoder.bytes().size() == small.encoded_size());
+    EXPECT(encoder.bytes().size() == 1 + 1 + 1 + 4 + 1 + 1 + 2);
+
+    Progress decoded{};
+    BinaryDecoder decoder{encoder.bytes()};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.tick == 5 && decoded.delta == -3 && decoded.offset == 7);
+    EXPECT((decoded.ids == std::vector<std::uint16_t>{1, 2, 300}));
+
+    // Negative varints are sign extended, extremes take the full width
+    Progress large{};
+    large.tick = 0xffffffff;
+    large.delta = std::numeric_limits<std::int32_t>::min();
+    large.offset = -1;
+
+    encoder.clear();
+    encoder << large;
+    EXPECT(encoder.bytes().size() == large.encoded_size());
+    EXPECT(encoder.bytes().size() == 5 + 5 + rt::MAX_VARINT_SIZE + 4);
+
+    BinaryDecoder large_decoder{encoder.bytes()};
+    large_decoder >> decoded;
+    EXPECT(!large_decoder.failed() && large_decoder.remaining() == 0);
+    EXPECT(decoded.tick == large.tick && decoded.delta == large.delta && decoded.offset == -1 && decoded.ids.empty());
+
+    // A tick beyond 32 bits, a truncated varint and a count beyond the input all fail
+    std::vector<std::uint8_t> corrupt{0x80, 0x80, 0x80, 0x80, 0x10};
+    BinaryDecoder wide_decoder{corrupt};
+    EXPECT((wide_decoder >> decoded).failed());
+
+    auto const bytes = encoder.bytes();
+    BinaryDecoder truncated_decoder{bytes.first(bytes.size() - 5)};
+    EXPECT((truncated_decoder >> decoded).failed());
+
+    std::vector<std::uint8_t> counted{1, 1, 1, 0xff, 0xff, 0, 0};
+    BinaryDecoder count_decoder{counted};
+    EXPECT((count_decoder >> decoded).failed());
+
+    return true;
+}
+
+// Quantized floats have to be written as their quantized integers, take exactly their encoded_size() and come back
+// within half a step
+DEF_TEST(binary_stream_quantized, binary_stream)
+{
+    Aim aim{};
+    aim.yaw = 90.3f;
+    aim.height = 1.234f;
+    aim.weights = {0.0f, 0.25f, 1.0f};
+
+    BinaryEncoder encoder;
+    encoder << aim;
+    EXPECT(encoder.bytes().size() == aim.encoded_size());
+    EXPECT(encoder.bytes().size() == 2 + 2 + 4 + 3);
+
+    Aim decoded{};
+    BinaryDecoder decoder{encoder.bytes()};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(std::abs(decoded.yaw - aim.yaw) <= 360.0f / 4095 / 2);
+    EXPECT(std::abs(decoded.height - aim.height) <= 0.005f);
+    EXPECT(decoded.weights.size() == 3 && decoded.weights[0] == 0.0f && decoded.weights[2] == 1.0f);
+    EXPECT(std::abs(decoded.weights[1] - 0.25f) <= 1.0f / 255 / 2);
+
+    // A fixed point number grows with its magnitude
+    aim.height = -1000.0f;
+    encoder.clear();
+    encoder << aim;
+    EXPECT(encoder.bytes().size() == aim.encoded_size());
+    EXPECT(encoder.bytes().size() == 2 + 3 + 4 + 3);
+
+    // Bits beyond the quantized ones are invalid
+    std::vector<std::uint8_t> corrupt{0xff, 0x1f, 0, 0, 0, 0, 0};
+    BinaryDecoder corrupt_decoder{corrupt};
+    EXPECT((corrupt_decoder >> decoded).failed());
+
+    return true;
+}
+
+// The bools, ranged integers and quantized floats of a bitpacked container have to share one bitstream behind the
+// other attributes that takes exactly the bits that encoded_size() counts
+DEF_TEST(binary_stream_bitpacked, binary_stream)
+{
+    Status status{};
+    status.alive = true;
+    status.health = 100;
+    status.lean = -10;
+    status.charge = 0.25f;
+    status.score = 0x01020304;
+
+    BinaryEncoder encoder;
+    encoder << status;
+    auto const bytes = encoder.bytes();
+    EXPECT(bytes.size() == status.encoded_size() && bytes.size() == 4 + 3);
+    EXPECT(bytes[0] == 0x04 && bytes[3] == 0x01);
+
+    // alive in bit 0, health in bits 1 to 7 and lean as distance to its minimum in bits 8 to 12
+    EXPECT(bytes[4] == (1 | 100 << 1) && (bytes[5] & 0x1f) == 0);
+
+    Status decoded{};
+    BinaryDecoder decoder{bytes};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.alive && decoded.health == 100 && decoded.lean == -10 && decoded.score == status.score);
+    EXPECT(std::abs(decoded.charge - 0.25f) <= 1.0f / 1023 / 2);
+
+    status.alive = false;
+    status.lean = 10;
+    encoder.clear();
+    encoder << status;
+    BinaryDecoder lean_decoder{encoder.bytes()};
+    lean_decoder >> decoded;
+    EXPECT(!lean_decoder.failed() && !decoded.alive && decoded.lean == 10);
+
+    // A truncated bitstream fails and leaves the bitpacked attributes untouched
+    BinaryDecoder truncated_decoder{encoder.bytes().first(5)};
+    EXPECT((truncated_decoder >> decoded).failed() && decoded.lean == 10);
+
+    // A health of 127 fits into its 7 bits but lies outside of [range=0..100]
+    std::vector<std::uint8_t> out_of_range{encoder.bytes().begin(), encoder.bytes().end()};
+    out_of_range[4] |= 0xfe;
+    BinaryDecoder range_decoder{out_of_range};
+    EXPECT((range_decoder >> decoded).failed());
+
+    return true;
+}
@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/bit_stream.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // Returns count values of random widths between 0 and 64 bits together with their width
+    std::vector<std::pair<std::uint64_t, int>> make_values(std::size_t count)
+    {
+        std::mt19937_64 random{7};
+        std::vector<std::pair<std::uint64_t, int>> values;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            int bits = static_cast<int>(random() % 65);
+            values.emplace_back(random() & rt::low_bits(bits), bits);
+        }
+
+        return values;
+    }
+}
+
+// Values of every width have to come back in the order they were written, across word boundaries
+DEF_TEST(bit_stream_round_trip, bit_stream)
+{
+    auto values = make_values(1000);
+
+    std::vector<std::uint8_t> buffer(values.size() * 8);
+    rt::bit_writer writer{buffer.data()};
+    std::size_t total_bits = 0;
+    for (auto [value, bits] : values)
+    {
+        writer.write(value, bits);
+        total_bits += bits;
+    }
+
+    auto size = writer.finish();
+    EXPECT(size == (total_bits + 7) / 8);
+
+    rt::bit_reader reader{buffer.data(), buffer.data() + size};
+    for (auto [value, bits] : values)
+        EXPECT(reader.read(bits) == value);
+
+    EXPECT(!reader.failed());
+    reader.read(8);
+    EXPECT(reader.failed());
+
+    return true;
+}
+
+// A bitpacked message stores bools in one bit, an enum Color { Red = 1, Green = 2, Blue = 3 } as distance to Red in
+// two bits and a [range=0..100] integer in seven bits
+DEF_TEST(bit_stream_packed_fields, bit_stream)
+{
+    bool const flags[] = {true, false, true, true, false};
+    int const color = 3;
+    std::uint32_t const health = 87;
+
+    std::uint8_t buffer[16] = {};
+    rt::bit_writer writer{buffer};
+    for (auto flag : flags)
+        writer.write(flag);
+    writer.write(static_cast<std::uint64_t>(color - 1), 2);
+    writer.write(health, 7);
+    EXPECT(writer.finish() == 2);
+
+    rt::bit_reader reader{buffer, buffer + 2};
+    for (auto flag : flags)
+        EXPECT(reader.read_bool() == flag);
+    EXPECT(static_cast<int>(reader.read(2)) + 1 == color);
+    EXPECT(reader.read(7) == health);
+    EXPECT(!reader.failed());
+
+    return true;
+}
+
+// Unpacking rejects values above the declared maximum and enums that aren't one of their enumerators, even though
+// the bits can hold them
+DEF_TEST(bit_stream_unpack_validates, bit_stream)
+{
+    enum class Color : std::uint8_t { Red = 1, Green = 2, Blue = 3 };
+    enum class Level : std::int8_t { Low = -1, High = 4 };
+
+    std::uint8_t buffer[16] = {};
+    rt::bit_writer writer{buffer};
+    rt::pack(writer, std::uint8_t{100}, 0, 7);
+    rt::pack(writer, Color::Blue, 1, 2);
+    rt::pack(writer, Level::High, -1, 3);
+    auto size = writer.finish();
+
+    std::uint8_t health = 0;
+    Color color{};
+    Level level{};
+    rt::bit_reader reader{buffer, buffer + size};
+    rt::unpack(reader, health, 0, 100, 7);
+    rt::unpack(reader, color, 1, 3, 2);
+    rt::unpack(reader, level, -1, {-1, 4}, 3);
+    EXPECT(!reader.failed() && health == 100 && color == Color::Blue && level == Level::High);
+
+    // 127 fits into 7 bits but not into [range=0..100]
+    writer = rt::bit_writer{buffer};
+    writer.write(127, 7);
+    size = writer.finish();
+    rt::bit_reader range_reader{buffer, buffer + size};
+    rt::unpack(range_reader, health, 0, 100, 7);
+    EXPECT(range_reader.failed() && health == 100);
+
+    // Distance 3 fits into the 2 bits of Color but is one past Blue
+    writer = rt::bit_writer{buffer};
+    writer.write(3, 2);
+    size = writer.finish();
+    rt::bit_reader color_reader{buffer, buffer + size};
+    rt::unpack(color_reader, color, 1, 3, 2);
+    EXPECT(color_reader.failed() && color == Color::Blue);
+
+    // 0 lies between Low and High but isn't an enumerator
+    writer = rt::bit_writer{buffer};
+    writer.write(1, 3);
+    size = writer.finish();
+    rt::bit_reader level_reader{buffer, buffer + size};
+    rt::unpack(level_reader, level, -1, {-1, 4}, 3);
+    EXPECT(level_reader.failed() && level == Level::High);
+
+    return true;
+}
+
+// Measures the bit writer and reader on fields of mixed widths
+DEF_TIMED_TEST(bit_stream_throughput, bit_stream)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto values = make_values(1 << 20);
+    std::vector<std::uint8_t> buffer(values.size() * 8);
+
+    auto start = clock::now();
+    rt::bit_writer writer{buffer.data()};
+    for (auto [value, bits] : values)
+        writer.write(value, bits);
+    auto size = writer.finish();
+    std::chrono::duration<double, std::nano> write_time = clock::now() - start;
+
+    start = clock::now();
+    std::uint64_t checksum = 0;
+    rt::bit_reader reader{buffer.data(), buffer.data() + size};
+    for (auto [value, bits] : values)
+        checksum += reader.read(bits);
+    std::chrono::duration<double, std::nano> read_time = clock::now() - start;
+
+    std::cout << fmt::format("{} fields in {} bytes: write {:.2f} ns/field, read {:.2f} ns/field (checksum {})",
+                             values.size(), size, write_time.count() / values.size(),
+                             read_time.count() / values.size(), checksum)
+              << std::endl;
+}
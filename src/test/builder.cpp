@@ -0,0 +1,178 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/builder.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::PlayerUpdate;
+    using Test::Fixtures::PlayerUpdateBuilder;
+    using Test::Fixtures::Snapshot;
+    using Test::Fixtures::SnapshotBuilder;
+
+    PlayerUpdate make_update(std::uint32_t id)
+    {
+        PlayerUpdate update;
+        update.id = id;
+        update.x = 1.5f;
+        update.y = -2.5f;
+        update.health = 100;
+        update.name = "player";
+        update.path = {1.0f, 2.0f, 3.0f};
+        update.presence.set(0);
+        return update;
+    }
+
+    // Returns the bytes that the generated codec encodes the given message to
+    template <typename Message> std::vector<std::uint8_t> encode(Message const& message)
+    {
+        BinaryEncoder encoder;
+        encoder << message;
+        return {encoder.bytes().begin(), encoder.bytes().end()};
+    }
+}
+
+// Setting the in place attributes in any order has to produce the encoding of the generated codec, which has to
+// decode it back to the same message
+DEF_TEST(builder_matches_struct_encoding, builder)
+{
+    auto update = make_update(7);
+
+    std::array<std::uint8_t, 256> buffer;
+    auto encoded = PlayerUpdateBuilder{buffer}
+                       .y(update.y)
+                       .id(update.id)
+                       .x(update.x)
+                       .health(update.health)
+                       .name(update.name)
+                       .path(update.path)
+                       .finish();
+
+    EXPECT((std::vector<std::uint8_t>{encoded.begin(), encoded.end()} == encode(update)));
+
+    PlayerUpdate decoded;
+    BinaryDecoder decoder{encoded};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.id == update.id && decoded.x == update.x && decoded.y == update.y);
+    EXPECT(decoded.presence.test(0) && decoded.health == update.health);
+    EXPECT(decoded.name == update.name && decoded.path == update.path);
+
+    // Without the optional health its presence bit stays clear
+    update.presence = {};
+    encoded = PlayerUpdateBuilder{buffer}.id(7).x(1.5f).y(-2.5f).name("player").path(update.path).finish();
+    EXPECT((std::vector<std::uint8_t>{encoded.begin(), encoded.end()} == encode(update)));
+
+    return true;
+}
+
+// Arrays are set in place and repeated attributes appended behind their count
+DEF_TEST(builder_arrays, builder)
+{
+    Snapshot snapshot;
+    for (std::size_t i = 0; i < snapshot.digest.size(); ++i)
+        snapshot.digest[i] = static_cast<std::uint8_t>(i);
+    snapshot.origin = {0.5f, 1.5f, 2.5f};
+    snapshot.counters = {3, 2, 1};
+
+    std::array<std::uint8_t, 128> buffer;
+    auto encoded = SnapshotBuilder{buffer}
+                       .origin(snapshot.origin)
+                       .digest(snapshot.digest)
+                       .counters(snapshot.counters)
+                       .finish();
+
+    EXPECT((std::vector<std::uint8_t>{encoded.begin(), encoded.end()} == encode(snapshot)));
+
+    return true;
+}
+
+// Appended attributes that are set out of order or twice must fail the builder, skipping one is fine
+DEF_TEST(builder_append_order, builder)
+{
+    std::array<std::uint8_t, 256> buffer;
+    EXPECT(!PlayerUpdateBuilder{buffer}.id(1).name("skips health").path({}).finish().empty());
+    EXPECT(PlayerUpdateBuilder{buffer}.name("before health").health(100).finish().empty());
+    EXPECT(PlayerUpdateBuilder{buffer}.name("twice").name("twice").finish().empty());
+
+    return true;
+}
+
+// A builder whose buffer is too small must fail instead of writing past it
+DEF_TEST(builder_overflow, builder)
+{
+    std::array<std::uint8_t, 24> buffer;
+    PlayerUpdateBuilder builder{buffer};
+    builder.id(1).health(2).name("a name that doesn't fit");
+    EXPECT(builder.finish().empty());
+
+    std::array<std::uint8_t, 8> tiny;
+    rt::wire_builder too_small{tiny, 16};
+    EXPECT(too_small.failed());
+
+    return true;
+}
+
+// Compares building messages in place with filling a struct and encoding it afterwards
+DEF_TIMED_TEST(builder_versus_struct, builder)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr std::uint32_t count = 1000000;
+
+    std::vector<float> path{1.0f, 2.0f, 3.0f, 4.0f};
+    std::size_t checksum = 0;
+
+    BinaryEncoder encoder;
+    auto start = clock::now();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        auto update = make_update(i);
+        update.path = path;
+        encoder.clear();
+        encoder << update;
+        checksum += encoder.bytes().size();
+    }
+    std::chrono::duration<double, std::nano> struct_time = clock::now() - start;
+
+    std::array<std::uint8_t, 256> buffer;
+    start = clock::now();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        PlayerUpdateBuilder builder{buffer};
+        builder.id(i).x(1.5f).y(-2.5f).health(100).name("player").path(path);
+        checksum += builder.finish().size();
+    }
+    std::chrono::duration<double, std::nano> builder_time = clock::now() - start;
+
+    std::cout << fmt::format("struct then encode {:.1f} ns/message, builder {:.1f} ns/message ({})",
+                             struct_time.count() / count, builder_time.count() / count, checksum)
+              << std::endl;
+}
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/bulk.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+using Test::Fixtures::Snapshot;
+
+namespace
+{
+    enum class material : std::uint16_t
+    {
+        stone = 1,
+        wood = 2,
+    };
+
+    // Returns count samples of a smooth signal, like the payload of an audio or telemetry message
+    std::vector<float> make_samples(std::size_t count)
+    {
+        std::vector<float> samples(count);
+        for (std::size_t i = 0; i < count; ++i)
+            samples[i] = std::sin(static_cast<float>(i) * 0.01f);
+
+        return samples;
+    }
+
+    // Writes the given values one element at a time like the codecs did before bulk copies
+    std::size_t encode_each(std::vector<float> const& values, std::uint8_t* out)
+    {
+        std::size_t size = 0;
+        for (auto value : values)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (std::size_t byte = 0; byte < sizeof(bits); ++byte)
+                out[size++] = static_cast<std::uint8_t>(bits >> (8 * byte));
+        }
+
+        return size;
+    }
+}
+
+// Arrays have to be written as their little endian bytes and read back unchanged
+DEF_TEST(bulk_arrays, bulk)
+{
+    std::array<std::uint32_t, 3> values{1, 0x01020304, 0xffffffff};
+    std::uint8_t buffer[sizeof(values)];
+    EXPECT(rt::encode_bulk(std::span<std::uint32_t const>{values}, buffer) == sizeof(values));
+    EXPECT(buffer[4] == 0x04 && buffer[7] == 0x01);
+
+    std::array<std::uint32_t, 3> decoded{};
+    EXPECT(rt::decode_bulk(buffer, buffer + sizeof(buffer), std::span<std::uint32_t>{decoded}) == sizeof(values));
+    EXPECT(decoded == values);
+    EXPECT(rt::decode_bulk(buffer, buffer + sizeof(buffer) - 1, std::span<std::uint32_t>{decoded}) == 0);
+
+    std::array<material, 2> materials{material::wood, material::stone};
+    std::array<material, 2> decoded_materials{};
+    rt::encode_bulk(std::span<material const>{materials}, buffer);
+    EXPECT(rt::decode_bulk(buffer, buffer + 4, std::span<material>{decoded_materials}) == 4);
+    EXPECT(decoded_materials == materials);
+
+    static_assert(!rt::bulk_element<bool>);
+    static_assert(!rt::bulk_element<long double>);
+
+    return true;
+}
+
+// The byte swapping path of big endian hosts has to reverse every element on its own
+DEF_TEST(bulk_swap_bytes, bulk)
+{
+    std::uint8_t in[]{1, 2, 3, 4, 5, 6, 7, 8};
+    std::uint8_t out[sizeof(in)];
+
+    rt::swap_bytes<2>(in, 4, out);
+    EXPECT((std::array{out[0], out[1], out[6], out[7]} == std::array<std::uint8_t, 4>{2, 1, 8, 7}));
+
+    rt::swap_bytes<4>(in, 2, out);
+    EXPECT((std::array{out[0], out[3], out[4], out[7]} == std::array<std::uint8_t, 4>{4, 1, 8, 5}));
+
+    rt::swap_bytes<8>(in, 1, out);
+    EXPECT(out[0] == 8 && out[7] == 1);
+
+    return true;
+}
+
+// Repeated values are preceded by their count, which must not be trusted beyond the input
+DEF_TEST(bulk_repeated, bulk)
+{
+    auto samples = make_samples(100);
+    std::vector<std::uint8_t> buffer(4 + samples.size() * sizeof(float));
+    EXPECT(rt::encode_repeated_bulk(samples, buffer.data()) == buffer.size());
+
+    std::vector<float> decoded;
+    EXPECT(rt::decode_repeated_bulk(buffer.data(), buffer.data() + buffer.size(), decoded) == buffer.size());
+    EXPECT(decoded == samples);
+
+    EXPECT(rt::decode_repeated_bulk(buffer.data(), buffer.data() + buffer.size() - 1, decoded) == 0);
+
+    std::uint8_t corrupt[]{0xff, 0xff, 0xff, 0x7f, 0, 0, 0, 0};
+    EXPECT(rt::decode_repeated_bulk(corrupt, corrupt + sizeof(corrupt), decoded) == 0);
+
+    std::vector<std::int64_t> empty;
+    std::vector<std::int64_t> decoded_empty{1, 2};
+    rt::encode_repeated_bulk(empty, buffer.data());
+    EXPECT(rt::decode_repeated_bulk(buffer.data(), buffer.data() + 4, decoded_empty) == 4);
+    EXPECT(decoded_empty.empty());
+
+    return true;
+}
+
+// The arrays and repeated numbers of a generated message have to take the bulk path: arrays as their elements without
+// a count, repeated values behind their 32 bit count
+DEF_TEST(bulk_generated, bulk)
+{
+    Snapshot snapshot;
+    for (std::size_t i = 0; i < snapshot.digest.size(); ++i)
+        snapshot.digest[i] = static_cast<std::uint8_t>(i * 17);
+    snapshot.origin = {1.5f, -2.0f, 1e6f};
+    snapshot.counters = {1, 0x01020304, 0xffffffff};
+
+    BinaryEncoder encoder;
+    encoder << snapshot;
+    auto const bytes = encoder.bytes();
+    EXPECT(bytes.size() == snapshot.encoded_size() && bytes.size() == 16 + 3 * 4 + 4 + 3 * 4);
+    EXPECT(bytes[1] == 17 && bytes[15] == 255);
+    EXPECT(bytes[28] == 3 && bytes[36] == 0x04 && bytes[39] == 0x01);
+
+    Snapshot decoded;
+    BinaryDecoder decoder{bytes};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.digest == snapshot.digest && decoded.origin == snapshot.origin);
+    EXPECT(decoded.counters == snapshot.counters);
+
+    // A fixed size array can't be cut short
+    BinaryDecoder truncated_decoder{bytes.first(15)};
+    EXPECT((truncated_decoder >> decoded).failed());
+
+    return true;
+}
+
+// Compares writing a large float array element by element with the bulk copy and the byte swapping path
+DEF_TIMED_TEST(bulk_versus_per_element, bulk)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto samples = make_samples(1 << 22);
+    std::vector<std::uint8_t> buffer(samples.size() * sizeof(float));
+
+    auto start = clock::now();
+    encode_each(samples, buffer.data());
+    std::chrono::duration<double, std::micro> each_time = clock::now() - start;
+
+    start = clock::now();
+    rt::encode_bulk(std::span<float const>{samples}, buffer.data());
+    std::chrono::duration<double, std::micro> bulk_time = clock::now() - start;
+
+    std::vector<std::uint8_t> swapped(buffer.size());
+    start = clock::now();
+    rt::swap_bytes<sizeof(float)>(buffer.data(), samples.size(), swapped.data());
+    std::chrono::duration<double, std::micro> swap_time = clock::now() - start;
+
+    auto megabytes = static_cast<double>(buffer.size()) / (1 << 20);
+    std::cout << fmt::format("{:.0f} MiB of floats: per element {:.0f} us, bulk {:.0f} us ({:.1f}x), byte swapped "
+                             "{:.0f} us",
+                             megabytes, each_time.count(), bulk_time.count(), each_time.count() / bulk_time.count(),
+                             swap_time.count())
+              << std::endl;
+}
@@ -19,8 +19,20 @@ limitations under the License.
 #include <testinator.h>
 
 #include <boost/range/iterator_range.hpp>
+#include <boost/regex.hpp>
 
 #include <flatmessage/compiler.hpp>
+#include <flatmessage/file_system.hpp>
+#include <flatmessage/module_cache.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
 
 namespace fs = boost::filesystem;
 
@@ -158,4 +170,570 @@ DEF_TEST(compiler_include_directories, compiler)
     EXPECT(test::load(working_folder / "include_test/nested/Include.hpp").empty());
     
     return true;
-}
\ No newline at end of file
+}
+
+// Compiling with a generation cache should generate the same files whether they are cached or not
+DEF_TEST(compiler_generation_cache, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto files = get_test_files();
+    auto cache_directory = working_folder / "cache";
+    fs::remove_all(cache_directory);
+
+    flatmessage::compiler_options options{working_folder / "cpp.template", 1, working_folder, "cpp", cf::none};
+    options.cache_directory = cache_directory;
+
+    // The first compilation populates the cache, the second one is served from it
+    for (int i = 0; i < 2; ++i)
+    {
+        for (auto& file : files)
+            fs::remove(working_folder / (file.stem().string() + ".cpp"));
+
+        EXPECT(compile_with(files, options));
+        EXPECT(test_output(files, {"cpp"}));
+    }
+
+    // Entries that exceed the cache's size are evicted
+    auto is_cached = [](fs::directory_entry const& entry) { return fs::is_regular_file(entry.path()); };
+    auto range = boost::make_iterator_range(fs::recursive_directory_iterator(cache_directory), {});
+    EXPECT(std::count_if(range.begin(), range.end(), is_cached) == static_cast<std::ptrdiff_t>(files.size()));
+
+    options.cache_max_size = 0;
+    EXPECT(compile_with(files, options));
+
+    range = boost::make_iterator_range(fs::recursive_directory_iterator(cache_directory), {});
+    EXPECT(std::none_of(range.begin(), range.end(), is_cached));
+
+    return true;
+}
+
+// Changing a template that is included from another included template has to invalidate the generation cache, even
+// if that template lives in a different directory than the root template
+DEF_TEST(compiler_generation_cache_includes, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "template_includes";
+    fs::remove_all(directory);
+
+    flatmessage::os_file_system file_system;
+    file_system.write_file(directory / "root.template", R"({% include "parts/header.template" %})");
+    file_system.write_file(directory / "parts/header.template", R"({% include "version.template" %})");
+    file_system.write_file(directory / "parts/version.template", "version 1");
+
+    flatmessage::compiler_options options{directory / "root.template", 1, directory, "txt", cf::none};
+    options.cache_directory = directory / "cache";
+    EXPECT(compile_with({working_folder / "Base.input"}, options));
+    EXPECT(test::load(directory / "Base.txt") == "version 1");
+
+    file_system.write_file(directory / "parts/version.template", "version 2");
+    EXPECT(compile_with({working_folder / "Base.input"}, options));
+    EXPECT(test::load(directory / "Base.txt") == "version 2");
+
+    fs::remove_all(directory);
+    return true;
+}
+
+// Changing a module whose types are used without importing it has to invalidate the generation cache of the modules
+// that use them
+DEF_TEST(compiler_generation_cache_referenced_types, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+    using cf = flatmessage::compiler_flags;
+
+    auto cache_directory = working_folder / "referenced_types_cache";
+    fs::remove_all(cache_directory);
+
+    auto memory = std::make_shared<flatmessage::memory_file_system>();
+    memory->write_file("hpp.template", test::load(working_folder / "hpp.template"));
+    memory->write_file("schemas/Math.input", "module Test.Math;\ndata Vector\n{\n    float x;\n    float y;\n}\n");
+    memory->write_file("schemas/Scene.input", "module Test.Scene;\ndata Scene\n{\n    [soa]\n    repeated Vector "
+                                              "positions;\n}\n");
+
+    flatmessage::compiler_options options{"hpp.template", 1, "out", "hpp", cf::none};
+    options.file_system = memory;
+    options.cache_directory = cache_directory;
+
+    std::vector<fs::path> inputs{"schemas/Math.input", "schemas/Scene.input"};
+    std::string output;
+    EXPECT(compile_with(inputs, options));
+    EXPECT(memory->read_file("out/Scene.hpp", output));
+    EXPECT(output.find("&Vector::x") != std::string::npos);
+
+    // Renaming a column keeps every size the same
+    memory->write_file("schemas/Math.input", "module Test.Math;\ndata Vector\n{\n    float u;\n    float y;\n}\n");
+    EXPECT(compile_with(inputs, options));
+    EXPECT(memory->read_file("out/Scene.hpp", output));
+    EXPECT(output.find("&Vector::u") != std::string::npos);
+
+    fs::remove_all(cache_directory);
+    return true;
+}
+
+// Compiling every shard of a sharded compilation should generate the same files as an unsharded compilation
+DEF_TEST(compiler_shards, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto files = get_test_files();
+    for (auto& file : files)
+        fs::remove(working_folder / (file.stem().string() + ".cpp"));
+
+    flatmessage::compiler_options options{working_folder / "cpp.template", 1, working_folder, "cpp", cf::none};
+    options.shard_count = 2;
+
+    std::size_t generated = 0;
+    for (options.shard_index = 0; options.shard_index < options.shard_count; ++options.shard_index)
+    {
+        EXPECT(compile_with(files, options));
+
+        // Every shard generates at least one file and no file is generated twice
+        auto exists = [](fs::path const& file) { return fs::exists(working_folder / (file.stem().string() + ".cpp")); };
+        auto count = static_cast<std::size_t>(std::count_if(files.begin(), files.end(), exists));
+        EXPECT(count > generated);
+        generated = count;
+    }
+
+    EXPECT(generated == files.size());
+    EXPECT(test_output(files, {"cpp"}));
+
+    return true;
+}
+
+// Compiles the given file_paths concurrently in session_count sessions that share a module_cache. Every session
+// compiles them repetitions times into its own output directory. Returns whether all compilations succeeded
+bool compile_concurrently(std::vector<fs::path> const& file_paths, int session_count, int repetitions)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto modules = std::make_shared<flatmessage::module_cache>();
+    std::atomic<bool> success = true;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < session_count; ++i)
+    {
+        auto output_path = working_folder / "sessions" / std::to_string(i);
+        fs::create_directories(output_path);
+
+        threads.emplace_back([&, output_path] {
+            flatmessage::compile_session session{{working_folder / "cpp.template", 1, output_path, "cpp", cf::none},
+                                                 modules};
+
+            for (int n = 0; n < repetitions; ++n)
+            {
+                if (!session.compile_files(file_paths))
+                    success = false;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return success;
+}
+
+// Concurrent sessions should generate the same files as a single compilation
+DEF_TEST(compiler_concurrent_sessions, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+
+    auto files = get_test_files();
+    EXPECT(compile_concurrently(files, 4, 4));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        for (auto& file : files)
+        {
+            auto file_name = file.stem().string() + ".cpp";
+            auto output = test::load(working_folder / "sessions" / std::to_string(i) / file_name);
+            EXPECT(output == test::load(working_folder / (file_name + ".expected")));
+        }
+    }
+
+    return true;
+}
+
+// Measures how many compilations per second concurrent sessions achieve
+DEF_TIMED_TEST(compiler_session_throughput, compiler)
+{
+    auto files = get_test_files();
+    int const session_count = std::max(1u, std::thread::hardware_concurrency());
+    int const repetitions = 20;
+
+    auto start = std::chrono::steady_clock::now();
+    compile_concurrently(files, session_count, repetitions);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << fmt::format("{} sessions: {:.1f} compilations/s", session_count,
+                             session_count * repetitions / elapsed.count())
+              << std::endl;
+}
+
+// Compiling inside a memory_file_system should generate the same files without touching the disk
+DEF_TEST(compiler_memory_file_system, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+    using cf = flatmessage::compiler_flags;
+
+    auto memory = std::make_shared<flatmessage::memory_file_system>();
+    memory->write_file("templates/hpp.template", test::load(working_folder / "hpp.template"));
+
+    auto files = get_test_files();
+    std::vector<fs::path> inputs;
+    for (auto& file : files)
+    {
+        inputs.emplace_back(fs::path{"schemas"} / file.filename());
+        memory->write_file(inputs.back(), test::load(file));
+    }
+
+    flatmessage::compiler_options options{"templates/hpp.template", 1, "out", "hpp", cf::none};
+    options.file_system = memory;
+    EXPECT(compile_with(inputs, options));
+
+    for (auto& file : files)
+    {
+        auto file_name = file.stem().string() + ".hpp";
+
+        std::string output;
+        EXPECT(memory->read_file(fs::path{"out"} / file_name, output));
+        EXPECT(output == test::load(working_folder / (file_name + ".expected")));
+    }
+
+    EXPECT(!fs::exists("out"));
+
+    return true;
+}
+
+// Templates that are included from a template inside a memory_file_system have to be read from it as well, relative to
+// the template that includes them
+DEF_TEST(compiler_memory_file_system_includes, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto memory = std::make_shared<flatmessage::memory_file_system>();
+    memory->write_file("templates/root.template", R"({% include "parts/header.template" %})");
+    memory->write_file("templates/parts/header.template", R"(module {% include "name.template" %})");
+    memory->write_file("templates/parts/name.template", "{{ moduleName }}");
+    memory->write_file("schemas/Base.input", "module Playground.Net.Base;\n");
+
+    flatmessage::compiler_options options{"templates/root.template", 1, "out", "txt", cf::none};
+    options.file_system = memory;
+    EXPECT(compile_with({"schemas/Base.input"}, options));
+
+    std::string output;
+    EXPECT(memory->read_file("out/Base.txt", output));
+    EXPECT(output == "module Base");
+    EXPECT(!fs::exists("templates") && !fs::exists("out"));
+
+    return true;
+}
+
+// Matches the includes of generated C++ files and captures the included file
+boost::regex const include_pattern{R"re(#include "([^"]+)")re"};
+
+// Compiling into unity batches should write the output of every translation unit and the requested amount of unity
+// files that include every output exactly once. Outputs that import each other have to include files that exist
+DEF_TEST(compiler_unity_batches, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+    using cf = flatmessage::compiler_flags;
+
+    auto memory = std::make_shared<flatmessage::memory_file_system>();
+    auto files = get_test_files();
+
+    flatmessage::compiler_options options{working_folder / "hpp.template", 1, "out", "hpp", cf::none};
+    options.batch_count = 2;
+    options.file_system = memory;
+
+    std::vector<fs::path> inputs;
+    for (auto& file : files)
+    {
+        inputs.emplace_back(fs::path{"schemas"} / file.filename());
+        memory->write_file(inputs.back(), test::load(file));
+    }
+    memory->write_file(options.template_file, test::load(options.template_file));
+
+    EXPECT(compile_with(inputs, options));
+
+    std::string batches[2];
+    EXPECT(memory->read_file("out/unity_0.hpp", batches[0]));
+    EXPECT(memory->read_file("out/unity_1.hpp", batches[1]));
+    EXPECT(!batches[0].empty() && !batches[1].empty());
+
+    std::size_t expected_size = 0;
+    for (auto& file : files)
+    {
+        auto file_name = file.stem().string() + ".hpp";
+        auto include = fmt::format("#include \"{0}\"\n", file_name);
+        expected_size += include.size();
+
+        auto in_batch = [&](std::string const& batch) { return batch.find(include) != std::string::npos; };
+        EXPECT(in_batch(batches[0]) != in_batch(batches[1]));
+
+        std::string output;
+        EXPECT(memory->read_file(fs::path{"out"} / file_name, output));
+        EXPECT(output == test::load(working_folder / (file_name + ".expected")));
+
+        for (auto& match :
+             boost::make_iterator_range(boost::sregex_iterator(output.begin(), output.end(), include_pattern), {}))
+            EXPECT(memory->exists(fs::path{"out"} / match[1].str()));
+    }
+
+    EXPECT(batches[0].size() + batches[1].size() == expected_size);
+
+    return true;
+}
+
+// Measures how long the system's C++ compiler takes to build the outputs of a synthetic schema set one by one and as
+// unity batches, and reports how evenly the batches are filled
+DEF_TIMED_TEST(compiler_unity_batch_build_time, compiler)
+{
+    namespace test = boost::spirit::x3::testing;
+    using cf = flatmessage::compiler_flags;
+    using clock = std::chrono::steady_clock;
+
+    auto directory = working_folder / "unity_build";
+    fs::remove_all(directory);
+
+    flatmessage::os_file_system file_system;
+    file_system.write_file(directory / "cpp.template", R"(#include <cstdint>
+#include <string>
+#include <vector>
+## for dat in data
+struct {{ dat/name }}
+{
+## for attrib in dat/attributes
+    std::uint32_t {{ attrib/name }};
+## endfor
+    std::vector<std::string> tags;
+};
+## endfor
+)");
+
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> attribute_counts{1, 40};
+
+    std::vector<fs::path> inputs;
+    for (int i = 0; i < 200; ++i)
+    {
+        auto schema = fmt::format("module Synthetic.Schema{0};\n", i);
+        for (int type = 0; type < 4; ++type)
+        {
+            schema += fmt::format("data Type{0}_{1}\n{{\n", i, type);
+            for (int attribute = attribute_counts(random); attribute > 0; --attribute)
+                schema += fmt::format("    uint32 field{0};\n", attribute);
+            schema += "}\n";
+        }
+
+        inputs.emplace_back(directory / fmt::format("schemas/Schema{0}.input", i));
+        file_system.write_file(inputs.back(), schema);
+    }
+
+    flatmessage::compiler_options options{directory / "cpp.template", 1, directory / "out", "cpp", cf::none};
+    options.batch_count = std::max(1u, std::thread::hardware_concurrency());
+    compile_with(inputs, options);
+
+    // Compiles the given sources on as many threads as there are batches and returns how long it took
+    auto build = [&](std::vector<fs::path> const& sources) {
+        auto const* compiler = std::getenv("CXX");
+        std::atomic<std::size_t> next = 0;
+        std::atomic<bool> success = true;
+
+        auto start = clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < options.batch_count; ++i)
+        {
+            threads.emplace_back([&] {
+                for (auto n = next++; n < sources.size(); n = next++)
+                {
+                    auto object = fs::path{sources[n]}.replace_extension(".o");
+                    auto command = fmt::format("{0} -std=c++17 -c \"{1}\" -o \"{2}\"", compiler ? compiler : "c++",
+                                               sources[n].string(), object.string());
+                    if (std::system(command.c_str()) != 0)
+                        success = false;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        return success ? elapsed.count() : -1.0;
+    };
+
+    std::vector<fs::path> units, batches;
+    std::vector<std::size_t> sizes;
+    for (auto& input : inputs)
+        units.emplace_back(options.output_path / (input.stem().string() + ".cpp"));
+    for (int batch = 0; batch < options.batch_count; ++batch)
+    {
+        batches.emplace_back(options.output_path / fmt::format("unity_{0}.cpp", batch));
+
+        std::size_t size = 0;
+        auto content = test::load(batches.back());
+        for (auto& match : boost::make_iterator_range(
+                 boost::sregex_iterator(content.begin(), content.end(), include_pattern), {}))
+            size += fs::file_size(options.output_path / match[1].str());
+        sizes.push_back(size);
+    }
+
+    auto unit_time = build(units);
+    auto batch_time = build(batches);
+
+    auto [smallest, largest] = std::minmax_element(sizes.begin(), sizes.end());
+    std::cout << fmt::format("{} schemas on {} threads: {:.2f}s one by one, {:.2f}s in {} batches of {}..{} bytes",
+                             inputs.size(), options.batch_count, unit_time, batch_time, options.batch_count,
+                             *smallest, *largest)
+              << std::endl;
+
+    fs::remove_all(directory);
+}
+
+// Messages of a protocol should get their ids and a dense dispatch table, which covers every module of the protocol
+// and is generated only once. Pinned ids must not collide and must fit the dispatch table
+DEF_TEST(compiler_message_ids, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "message_ids";
+    flatmessage::compiler_options options{directory / "dispatch.template", 1, directory, "hpp", cf::none};
+
+    EXPECT(compile_with({directory / "Ids.input", directory / "IdsChat.input"}, options));
+    EXPECT(test_one(directory / "Ids.input", "hpp"));
+    EXPECT(test_one(directory / "IdsChat.input", "hpp"));
+
+    EXPECT(!compile_with({directory / "Collision.input"}, options));
+    EXPECT(!compile_with({directory / "TooLarge.input"}, options));
+
+    return true;
+}
+
+// Integer encodings have to fit the type they are applied to and must not contradict each other
+DEF_TEST(compiler_integer_encodings, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "encoding";
+    flatmessage::compiler_options options{working_folder / "hpp.template", 1, fs::temp_directory_path(), "hpp",
+                                          cf::none};
+
+    EXPECT(compile_with({directory / "Valid.input"}, options));
+    EXPECT(!compile_with({directory / "Unsigned.input"}, options));
+    EXPECT(!compile_with({directory / "Float.input"}, options));
+    EXPECT(!compile_with({directory / "Conflict.input"}, options));
+
+    return true;
+}
+
+// Quantization is only valid on floats and needs a non-empty range, a supported bit width or a positive step
+DEF_TEST(compiler_quantization, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "quantize";
+    flatmessage::compiler_options options{working_folder / "hpp.template", 1, fs::temp_directory_path(), "hpp",
+                                          cf::none};
+
+    EXPECT(compile_with({directory / "Valid.input"}, options));
+    for (auto name : {"Integer", "Range", "Bits", "Arguments", "Step"})
+        EXPECT(!compile_with({directory / (std::string{name} + ".input")}, options));
+
+    return true;
+}
+
+// Ranges are only valid on integers and have to be ordered and fit into their type
+DEF_TEST(compiler_ranges, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "range";
+    flatmessage::compiler_options options{working_folder / "hpp.template", 1, fs::temp_directory_path(), "hpp",
+                                          cf::none};
+
+    EXPECT(compile_with({directory / "Valid.input"}, options));
+    for (auto name : {"Float", "Inverted", "Overflow", "Unsigned", "Malformed"})
+        EXPECT(!compile_with({directory / (std::string{name} + ".input")}, options));
+
+    return true;
+}
+
+// The dirty fields of a delta message have to fit into a 64 bit mask
+DEF_TEST(compiler_delta_field_limit, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    flatmessage::compiler_options options{working_folder / "hpp.template", 1, fs::temp_directory_path(), "hpp",
+                                          cf::none};
+    EXPECT(!compile_with({working_folder / "delta" / "TooManyFields.input"}, options));
+
+    return true;
+}
+
+// Every type has to be classified as fixed size, bounded or unbounded, including the types it contains
+DEF_TEST(compiler_wire_sizes, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "sizes";
+    flatmessage::compiler_options options{directory / "sizes.template", 1, directory, "hpp", cf::none};
+
+    EXPECT(compile_with({directory / "Sizes.input"}, options));
+    EXPECT(test_one(directory / "Sizes.input", "hpp"));
+
+    return true;
+}
+
+// Unions have to be sized by their largest alternative and their alternatives can neither be optional nor have a
+// default value
+DEF_TEST(compiler_unions, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "union";
+    flatmessage::compiler_options options{directory / "union.template", 1, directory, "hpp", cf::none};
+
+    EXPECT(compile_with({directory / "Shapes.input"}, options));
+    EXPECT(test_one(directory / "Shapes.input", "hpp"));
+
+    for (auto name : {"Optional", "Default", "Bitpacked"})
+        EXPECT(!compile_with({directory / (std::string{name} + ".input")}, options));
+
+    return true;
+}
+
+// The attributes of data and messages have to be ordered by temperature and alignment in memory and can't be hot and
+// cold at once
+DEF_TEST(compiler_memory_layouts, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "layout";
+    flatmessage::compiler_options options{directory / "layout.template", 1, directory, "hpp", cf::layout_report};
+
+    EXPECT(compile_with({directory / "Layout.input"}, options));
+    EXPECT(test_one(directory / "Layout.input", "hpp"));
+    EXPECT(!compile_with({directory / "HotAndCold.input"}, options));
+
+    return true;
+}
+
+// Only repeated attributes of data structures of required numbers and enums can be stored as structure of arrays
+DEF_TEST(compiler_soa_attributes, compiler)
+{
+    using cf = flatmessage::compiler_flags;
+
+    auto directory = working_folder / "soa";
+    flatmessage::compiler_options options{directory / "soa.template", 1, directory, "hpp", cf::none};
+
+    EXPECT(compile_with({directory / "Physics.input"}, options));
+    EXPECT(test_one(directory / "Physics.input", "hpp"));
+
+    for (auto name : {"NotRepeated", "NotPlain", "Varint"})
+        EXPECT(!compile_with({directory / (std::string{name} + ".input")}, options));
+
+    return true;
+}
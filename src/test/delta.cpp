@@ -0,0 +1,293 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/delta.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::PlayerState;
+    using Test::Fixtures::PlayerStateTracker;
+
+    constexpr std::size_t field_count = 8;
+
+    // The generated types don't compare, so states are compared by their encoding
+    bool same_state(PlayerState const& a, PlayerState const& b)
+    {
+        BinaryEncoder left, right;
+        left << a;
+        right << b;
+
+        return std::ranges::equal(left.bytes(), right.bytes());
+    }
+
+    // The result of simulating a stream of player updates
+    struct stream_result
+    {
+        bool consistent = true;
+        std::size_t messages = 0;
+        std::size_t full_bytes = 0;
+        std::size_t delta_bytes = 0;
+        double encode_ns = 0;
+        double decode_ns = 0;
+    };
+
+    // Simulates ticks updates of a moving player that are sent over a connection that drops loss_rate of the
+    // messages and acknowledges them ack_delay ticks later. Checks that the receiver always ends up with the state
+    // that was sent
+    stream_result simulate_player_stream(int ticks, double loss_rate, int ack_delay)
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> chance{0, 1};
+        std::uniform_real_distribution<float> step{-0.5f, 0.5f};
+
+        PlayerStateTracker player{};
+        player.set_health(100);
+        player.set_ammo(30);
+        player.dirty().mark_all();
+
+        rt::delta_sender<> sender;
+        rt::delta_receiver<PlayerState> receiver;
+        std::deque<std::pair<int, std::uint32_t>> acks;
+
+        stream_result result;
+        BinaryEncoder encoder;
+        BinaryEncoder full_encoder;
+        for (int tick = 0; tick < ticks; ++tick)
+        {
+            auto const& state = player.state();
+            player.set_x(state.x + step(random));
+            player.set_z(state.z + step(random));
+            if (chance(random) < 0.5)
+                player.set_orientation(state.orientation + step(random));
+            if (chance(random) < 0.1)
+                player.set_y(state.y + step(random));
+            if (chance(random) < 0.1)
+                player.set_ammo(static_cast<std::uint16_t>(state.ammo - 1));
+            if (chance(random) < 0.05)
+                player.set_health(state.health - 1);
+            if (chance(random) < 0.02)
+                player.set_score(state.score + 10);
+            if (chance(random) < 0.01)
+                player.set_weapon(static_cast<std::uint8_t>(state.weapon + 1));
+
+            while (!acks.empty() && acks.front().first <= tick)
+            {
+                sender.acknowledge(acks.front().second);
+                acks.pop_front();
+            }
+
+            auto start = clock::now();
+            auto frame = sender.next(player.dirty().take(), rt::dirty_fields<field_count>::all);
+            encoder.clear();
+            encode_delta(encoder, frame, state);
+            result.encode_ns += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+            full_encoder.clear();
+            encode_delta(full_encoder, {frame.sequence, 0, rt::dirty_fields<field_count>::all}, state);
+            result.delta_bytes += encoder.bytes().size();
+            result.full_bytes += full_encoder.bytes().size();
+            ++result.messages;
+
+            if (chance(random) < loss_rate)
+                continue;
+
+            start = clock::now();
+            BinaryDecoder decoder{encoder.bytes()};
+            auto ack = decode_delta(decoder, receiver);
+            result.decode_ns += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+            result.consistent = result.consistent && ack != 0 && same_state(receiver.latest(), state);
+            acks.emplace_back(tick + ack_delay, ack);
+        }
+
+        return result;
+    }
+}
+
+// The dirty mask has to follow the setters and be cleared when it is taken
+DEF_TEST(delta_dirty_fields, delta)
+{
+    PlayerStateTracker player{};
+    EXPECT(player.dirty().mask() == 0);
+
+    player.set_health(50);
+    player.set_score(10);
+    EXPECT(player.dirty().is_dirty(4) && player.dirty().is_dirty(7) && !player.dirty().is_dirty(0));
+    EXPECT(player.dirty().take() == ((1u << 4) | (1u << 7)));
+    EXPECT(player.dirty().mask() == 0);
+
+    std::vector<std::size_t> indices;
+    rt::for_each_field(0b10010010, [&](std::size_t index) { indices.push_back(index); });
+    EXPECT((indices == std::vector<std::size_t>{1, 4, 7}));
+
+    std::uint8_t buffer[8];
+    std::uint64_t mask = 0;
+    auto* end = rt::write_presence(0x1ff, 9, buffer);
+    EXPECT(end == buffer + 2);
+    EXPECT(rt::read_presence(buffer, end, 9, mask) == end && mask == 0x1ff);
+    EXPECT(rt::read_presence(buffer, end - 1, 9, mask) == nullptr);
+
+    return true;
+}
+
+// Deltas have to be relative to the newest acknowledged send and have to cover every change since then
+DEF_TEST(delta_baseline, delta)
+{
+    rt::delta_sender<4> sender;
+
+    auto frame = sender.next(0b1, 0b111);
+    EXPECT(frame.sequence == 1 && frame.baseline == 0 && frame.fields == 0b111);
+
+    sender.next(0b10, 0b111);
+    sender.acknowledge(1);
+    frame = sender.next(0b100, 0b111);
+    EXPECT(frame.sequence == 3 && frame.baseline == 1 && frame.fields == 0b110);
+
+    // Old and unknown acknowledgements are ignored
+    sender.acknowledge(7);
+    sender.acknowledge(3);
+    sender.acknowledge(2);
+    EXPECT(sender.acknowledged() == 3);
+
+    // Once the baseline is older than the history everything is sent again
+    sender.next(0, 0b111);
+    sender.next(0, 0b111);
+    sender.next(0, 0b111);
+    frame = sender.next(0, 0b111);
+    EXPECT(frame.baseline == 0 && frame.fields == 0b111);
+
+    return true;
+}
+
+// A reordered send that is older than the history must not evict the newest state
+DEF_TEST(delta_reordered_stream, delta)
+{
+    rt::delta_receiver<PlayerState, 4> receiver;
+
+    PlayerState state{};
+    for (std::uint32_t sequence = 1; sequence <= 8; ++sequence)
+    {
+        state.score = sequence;
+        EXPECT(receiver.store(sequence, state) == sequence);
+    }
+
+    PlayerState stale{};
+    stale.score = 4;
+    EXPECT(receiver.store(4, stale) == 8);
+    EXPECT(receiver.baseline(8) != nullptr);
+    EXPECT(receiver.baseline(4) == nullptr);
+    EXPECT(receiver.latest().score == 8);
+
+    // Reordered sends within the history are still kept
+    stale.score = 6;
+    EXPECT(receiver.store(6, stale) == 8);
+    EXPECT(receiver.baseline(6) != nullptr && receiver.baseline(6)->score == 6);
+    EXPECT(receiver.latest().score == 8);
+
+    return true;
+}
+
+// A frame has to carry exactly the fields in its mask behind its sequence, baseline and mask, and a frame that is
+// corrupt or refers to an unknown baseline must not be applied
+DEF_TEST(delta_frames, delta)
+{
+    PlayerState state{};
+    state.x = 1.5f;
+    state.health = 0x01020304;
+
+    BinaryEncoder encoder;
+    encode_delta(encoder, {3, 0, (1u << 0) | (1u << 4)}, state);
+    std::vector<std::uint8_t> const bytes{encoder.bytes().begin(), encoder.bytes().end()};
+    EXPECT(bytes.size() == 1 + 1 + 1 + 4 + 4);
+    EXPECT(bytes[0] == 3 && bytes[1] == 0 && bytes[2] == 0b10001 && bytes[7] == 0x04 && bytes[10] == 0x01);
+
+    rt::delta_receiver<PlayerState> receiver;
+    BinaryDecoder decoder{bytes};
+    EXPECT(decode_delta(decoder, receiver) == 3 && decoder.remaining() == 0);
+    EXPECT(same_state(receiver.latest(), state));
+
+    // Only the score changes relative to sequence 3
+    auto next = state;
+    next.score = 8;
+    encoder.clear();
+    encode_delta(encoder, {4, 3, 1u << 7}, next);
+    BinaryDecoder delta_decoder{encoder.bytes()};
+    EXPECT(encoder.bytes().size() == 1 + 1 + 1 + 4);
+    EXPECT(decode_delta(delta_decoder, receiver) == 4 && same_state(receiver.latest(), next));
+
+    encoder.clear();
+    encode_delta(encoder, {5, 2, 1u << 7}, next);
+    BinaryDecoder unknown_decoder{encoder.bytes()};
+    EXPECT(decode_delta(unknown_decoder, receiver) == 0);
+
+    BinaryDecoder truncated_decoder{std::span{bytes}.first(bytes.size() - 1)};
+    EXPECT(decode_delta(truncated_decoder, receiver) == 0 && truncated_decoder.failed());
+
+    // A frame without baseline and fields resets the state
+    std::vector<std::uint8_t> empty{6, 0, 0};
+    BinaryDecoder empty_decoder{empty};
+    EXPECT(decode_delta(empty_decoder, receiver) == 6);
+    EXPECT(receiver.latest().score == 0 && receiver.latest().x == 0.0f);
+
+    // Bits beyond the fields of a message are corrupt
+    std::vector<std::uint8_t> mask{0b1001};
+    std::uint64_t fields = 0;
+    BinaryDecoder mask_decoder{mask};
+    EXPECT(mask_decoder.read_presence(fields, 3).failed() && fields == 0);
+
+    return true;
+}
+
+// The receiver has to end up with the sent state even if messages get lost
+DEF_TEST(delta_lossy_stream, delta)
+{
+    EXPECT(simulate_player_stream(5000, 0.0, 0).consistent);
+    EXPECT(simulate_player_stream(5000, 0.05, 3).consistent);
+    EXPECT(simulate_player_stream(5000, 0.3, 10).consistent);
+
+    return true;
+}
+
+// Compares the size and speed of delta encoded player updates with full updates
+DEF_TIMED_TEST(delta_player_stream, delta)
+{
+    auto result = simulate_player_stream(200000, 0.05, 3);
+
+    std::cout << fmt::format("{} updates: full {:.1f} bytes/update, delta {:.1f} bytes/update ({:.1f}%), "
+                             "encode {:.1f} ns/update, decode {:.1f} ns/update",
+                             result.messages, double(result.full_bytes) / result.messages,
+                             double(result.delta_bytes) / result.messages,
+                             100.0 * result.delta_bytes / result.full_bytes, result.encode_ns / result.messages,
+                             result.decode_ns / result.messages)
+              << std::endl;
+}
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/binary_stream.hpp>
+#include <flatmessage/runtime/encoded_size.hpp>
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::Head;
+    using Test::Fixtures::Vector2d;
+
+    enum class color : std::uint8_t
+    {
+        red = 1,
+    };
+}
+
+// Builtins, generated types, strings, arrays and repeated values have to report their size on the wire
+DEF_TEST(encoded_size_of_values, encoded_size)
+{
+    static_assert(rt::encoded_size(std::uint16_t{}) == 2);
+    static_assert(rt::encoded_size(color::red) == 1);
+    static_assert(rt::encoded_size(Vector2d{}) == 8);
+    static_assert(rt::encoded_size(std::array<Vector2d, 4>{}) == 32);
+
+    Head h{};
+    EXPECT(rt::encoded_size(h) == 7);
+    h.presence.set(0);
+    EXPECT(rt::encoded_size(h) == 11);
+    EXPECT(rt::encoded_size(h) <= Head::max_size);
+
+    EXPECT(rt::encoded_size(std::string{"hello"}) == rt::LENGTH_PREFIX_SIZE + 5);
+    EXPECT(rt::encoded_size(std::vector<float>(3)) == rt::LENGTH_PREFIX_SIZE + 12);
+    EXPECT(rt::encoded_size(std::vector<Head>(2, h)) == rt::LENGTH_PREFIX_SIZE + 22);
+    EXPECT(rt::encoded_size(std::vector<std::string>{"a", "bc"}) == rt::LENGTH_PREFIX_SIZE + 5 + 6);
+
+    return true;
+}
+
+// A union has to count its tag and only the alternative it holds
+DEF_TEST(encoded_size_of_unions, encoded_size)
+{
+    std::variant<std::monostate, Vector2d, std::string, Head> shape;
+    EXPECT(rt::encoded_size(shape) == rt::UNION_TAG_SIZE);
+
+    shape = Vector2d{};
+    EXPECT(rt::encoded_size(shape) == rt::UNION_TAG_SIZE + 8);
+
+    shape = std::string{"abc"};
+    EXPECT(rt::encoded_size(shape) == rt::UNION_TAG_SIZE + rt::LENGTH_PREFIX_SIZE + 3);
+
+    std::vector<decltype(shape)> shapes{std::monostate{}, Head{}};
+    EXPECT(rt::encoded_size(shapes) == rt::LENGTH_PREFIX_SIZE + 2 * rt::UNION_TAG_SIZE + 7);
+
+    return true;
+}
+
+// The encoded size has to be the amount of bytes the encoder actually writes
+DEF_TEST(encoded_size_matches_encoder, encoded_size)
+{
+    Head h{};
+    rt::binary_encoder encoder;
+    encoder << h;
+    EXPECT(rt::encoded_size(h) == encoder.bytes().size());
+
+    h.presence.set(0);
+    encoder.clear();
+    encoder << h;
+    EXPECT(rt::encoded_size(h) == encoder.bytes().size());
+    EXPECT(encoder.bytes().size() == Head::max_size);
+
+    return true;
+}
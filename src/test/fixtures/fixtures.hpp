@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#pragma once
+
+// The types that the sample templates in compiler_expression and generate_expression generate from Samples.input. The
+// build generates them before the tests are compiled, so the runtime tests run against the code that a schema actually
+// compiles to
+
+#include <flatmessage.hpp>
+
+#include "Samples.hpp"
+#include "Samples.delta.hpp"
+#include "Samples.views.hpp"
+#include "Samples.arena.hpp"
+#include "Samples.builder.hpp"
+
+// The sample cpp.template defines the codecs next to their types without declaring them in a header, fixtures.cpp
+// compiles them
+namespace Test::Fixtures
+{
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Head& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Head& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Vector2d& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Vector2d& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const PlayerState& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, PlayerState& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Chat& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Chat& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Progress& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Progress& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Aim& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Aim& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Status& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Status& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Snapshot& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Snapshot& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const Route& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, Route& data);
+    BinaryEncoder& operator<<(BinaryEncoder& encoder, const PlayerUpdate& data);
+    BinaryDecoder& operator>>(BinaryDecoder& decoder, PlayerUpdate& data);
+}
@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#pragma once
+
+// Stands in for the <flatmessage.hpp> that the code of the sample templates includes: the builtin types under their
+// schema names, the binary codec and the runtime that the generated types use
+
+#include <flatmessage/runtime/binary_stream.hpp>
+#include <flatmessage/runtime/builder.hpp>
+#include <flatmessage/runtime/delta.hpp>
+#include <flatmessage/runtime/encoded_size.hpp>
+#include <flatmessage/runtime/presence.hpp>
+#include <flatmessage/runtime/view.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using byte = std::uint8_t;
+using uint8 = std::uint8_t;
+using int8 = std::int8_t;
+using uint16 = std::uint16_t;
+using int16 = std::int16_t;
+using uint32 = std::uint32_t;
+using int32 = std::int32_t;
+using uint64 = std::uint64_t;
+using int64 = std::int64_t;
+using string = std::string;
+
+using BinaryEncoder = flatmessage::runtime::binary_encoder;
+using BinaryDecoder = flatmessage::runtime::binary_decoder;
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/pool.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // What the generator emits for a [pooled] message with a default value. Like every generated type it has no
+    // default member initializers, the default value is only assigned by reset
+    struct chat
+    {
+        std::string text;
+        std::vector<std::uint32_t> recipients;
+        float volume;
+        std::uint32_t sender;
+
+        void reset()
+        {
+            rt::reset_value(text);
+            rt::reset_value(recipients);
+            rt::reset_value(volume, 0.5f);
+            rt::reset_value(sender);
+        }
+    };
+
+    // Fills the given message the way a decoder would
+    void fill(chat& message, int i)
+    {
+        message.text.assign("a message that is long enough to allocate");
+        message.recipients.assign(16, static_cast<std::uint32_t>(i));
+        message.volume = 1.0f;
+        message.sender = static_cast<std::uint32_t>(i);
+    }
+}
+
+// A released object has to come back reset but with its storage
+DEF_TEST(pool_reuse, pool)
+{
+    using chat_pool = rt::pool<chat>;
+    chat_pool::trim();
+
+    auto message = chat_pool::acquire();
+    EXPECT(message->volume == 0.5f && chat_pool::free_count() == 0);
+
+    fill(*message, 7);
+    auto* address = message.get();
+    auto* text = message->text.data();
+    message.reset();
+    EXPECT(chat_pool::free_count() == 1);
+
+    auto reused = chat_pool::acquire();
+    EXPECT(reused.get() == address && chat_pool::free_count() == 0);
+    EXPECT(reused->text.empty() && reused->recipients.empty() && reused->sender == 0 && reused->volume == 0.5f);
+    EXPECT(reused->text.data() == text && reused->recipients.capacity() >= 16);
+
+    return true;
+}
+
+// The free list must not grow beyond max_free and every thread has to use its own list
+DEF_TEST(pool_limits, pool)
+{
+    using chat_pool = rt::pool<chat>;
+    chat_pool::trim();
+
+    {
+        std::vector<chat_pool::handle> messages;
+        for (std::size_t i = 0; i < chat_pool::max_free + 10; ++i)
+            messages.push_back(chat_pool::acquire());
+    }
+    EXPECT(chat_pool::free_count() == chat_pool::max_free);
+
+    std::size_t other_count = 1;
+    std::thread{[&] {
+        other_count = chat_pool::free_count();
+        auto message = chat_pool::acquire();
+    }}.join();
+    EXPECT(other_count == 0);
+
+    chat_pool::trim();
+    EXPECT(chat_pool::free_count() == 0);
+
+    return true;
+}
+
+// Compares allocating every received message with new and delete against taking it from a pool
+DEF_TIMED_TEST(pool_versus_new, pool)
+{
+    using clock = std::chrono::steady_clock;
+    using chat_pool = rt::pool<chat>;
+    constexpr int ticks = 1000;
+    constexpr int messages_per_tick = 32;
+    std::size_t checksum = 0;
+
+    auto start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        std::vector<std::unique_ptr<chat>> messages;
+        for (int i = 0; i < messages_per_tick; ++i)
+        {
+            messages.push_back(std::make_unique<chat>());
+            fill(*messages.back(), i);
+        }
+
+        for (auto& message : messages)
+            checksum += message->sender;
+    }
+    std::chrono::duration<double, std::nano> heap_time = clock::now() - start;
+
+    start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        std::vector<chat_pool::handle> messages;
+        for (int i = 0; i < messages_per_tick; ++i)
+        {
+            messages.push_back(chat_pool::acquire());
+            fill(*messages.back(), i);
+        }
+
+        for (auto& message : messages)
+            checksum += message->sender;
+    }
+    std::chrono::duration<double, std::nano> pool_time = clock::now() - start;
+
+    constexpr int count = ticks * messages_per_tick;
+    std::cout << fmt::format("new/delete {:.1f} ns/message, pool {:.1f} ns/message ({})", heap_time.count() / count,
+                             pool_time.count() / count, checksum)
+              << std::endl;
+}
@@ -0,0 +1,95 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/presence.hpp>
+
+#include <boost/optional.hpp>
+
+#include <fmt/format.h>
+
+#include <cstring>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // The layout of the sample hpp.template: one boost::optional per optional attribute
+    struct optional_profile
+    {
+        std::uint32_t id;
+        boost::optional<std::uint32_t> clan;
+        boost::optional<std::uint32_t> guild;
+        boost::optional<float> rating;
+        boost::optional<std::uint16_t> level;
+        boost::optional<std::uint8_t> title;
+    };
+
+    // The same attributes with their presence kept in a bitmap
+    struct compact_profile
+    {
+        std::uint32_t id;
+        std::uint32_t clan;
+        std::uint32_t guild;
+        float rating;
+        std::uint16_t level;
+        std::uint8_t title;
+        rt::presence_bits<5> presence;
+    };
+}
+
+// Presence bits have to survive the wire in every word and bits of absent attributes must not leak in
+DEF_TEST(presence_round_trip, presence)
+{
+    rt::presence_bits<40> bits;
+    static_assert(rt::presence_bits<40>::words == 2 && rt::presence_bits<40>::size == 8);
+
+    for (std::size_t i : {0, 3, 31, 32, 39})
+        bits.set(i);
+    bits.set(3, false);
+    bits.reset(31);
+    EXPECT(bits.test(0) && !bits.test(3) && !bits.test(31) && bits.test(32) && bits.test(39));
+    EXPECT(bits.count() == 3);
+
+    std::uint8_t buffer[rt::presence_bits<40>::size];
+    EXPECT(bits.encode(buffer) == buffer + sizeof(buffer));
+
+    // A bit behind the last optional attribute is ignored
+    buffer[7] |= 0x80;
+
+    rt::presence_bits<40> decoded;
+    EXPECT(decoded.decode(buffer, buffer + sizeof(buffer)) == buffer + sizeof(buffer));
+    EXPECT(decoded.count() == 3);
+    for (std::size_t i = 0; i < 40; ++i)
+        EXPECT(decoded.test(i) == bits.test(i));
+
+    EXPECT(decoded.decode(buffer, buffer + sizeof(buffer) - 1) == nullptr);
+
+    return true;
+}
+
+// Keeping presence in a bitmap has to be smaller than one boost::optional per field
+DEF_TEST(presence_layout_size, presence)
+{
+    std::cout << fmt::format("boost::optional per field: {} bytes, presence bitmap: {} bytes", sizeof(optional_profile),
+                             sizeof(compact_profile))
+              << std::endl;
+
+    EXPECT(sizeof(compact_profile) < sizeof(optional_profile));
+
+    return true;
+}
@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/bit_stream.hpp>
+#include <flatmessage/runtime/quantize.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // The body that most player messages carry, see compiler_expression/PlayerInteraction.input
+    struct player_update_body
+    {
+        float x, y, z;
+        float orientation;
+    };
+
+    // The quantization a schema would declare with [quantize(-4096, 4096, 20)] for the position and
+    // [quantize(0, 6.2832, 12)] for the orientation
+    constexpr float position_min = -4096, position_max = 4096;
+    constexpr int position_bits = 20;
+    constexpr float orientation_min = 0, orientation_max = 6.2832f;
+    constexpr int orientation_bits = 12;
+    constexpr std::size_t quantized_size = (3 * position_bits + orientation_bits + 7) / 8;
+
+    void encode(rt::bit_writer& writer, player_update_body const& body)
+    {
+        writer.write(rt::quantize(body.x, position_min, position_max, position_bits), position_bits);
+        writer.write(rt::quantize(body.y, position_min, position_max, position_bits), position_bits);
+        writer.write(rt::quantize(body.z, position_min, position_max, position_bits), position_bits);
+        writer.write(rt::quantize(body.orientation, orientation_min, orientation_max, orientation_bits),
+                     orientation_bits);
+    }
+
+    void decode(rt::bit_reader& reader, player_update_body& body)
+    {
+        body.x = rt::dequantize(reader.read(position_bits), position_min, position_max, position_bits);
+        body.y = rt::dequantize(reader.read(position_bits), position_min, position_max, position_bits);
+        body.z = rt::dequantize(reader.read(position_bits), position_min, position_max, position_bits);
+        body.orientation
+            = rt::dequantize(reader.read(orientation_bits), orientation_min, orientation_max, orientation_bits);
+    }
+
+    std::vector<player_update_body> make_bodies(std::size_t count)
+    {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> position{position_min, position_max};
+        std::uniform_real_distribution<float> orientation{orientation_min, orientation_max};
+
+        std::vector<player_update_body> bodies(count);
+        for (auto& body : bodies)
+            body = {position(random), position(random), position(random), orientation(random)};
+
+        return bodies;
+    }
+}
+
+// Quantized values have to stay within half a step of the original and out of range values have to be clamped
+DEF_TEST(quantize_range, quantize)
+{
+    float const step = (position_max - position_min) / ((1 << position_bits) - 1);
+    for (auto& body : make_bodies(1000))
+    {
+        auto value = rt::dequantize(rt::quantize(body.x, position_min, position_max, position_bits), position_min,
+                                    position_max, position_bits);
+        EXPECT(std::abs(value - body.x) <= step / 2 + 1e-3f);
+    }
+
+    EXPECT(rt::quantize(-10000, position_min, position_max, position_bits) == 0);
+    EXPECT(rt::quantize(10000, position_min, position_max, position_bits) == (1u << position_bits) - 1);
+    EXPECT(rt::quantize(std::numeric_limits<float>::quiet_NaN(), position_min, position_max, position_bits) == 0);
+    EXPECT(rt::quantize(1, 0, 1, 32) == 0xffffffffu);
+
+    return true;
+}
+
+// Fixed point values are multiples of their step
+DEF_TEST(quantize_fixed_point, quantize)
+{
+    EXPECT(rt::to_fixed_point(1.234f, 0.01) == 123);
+    EXPECT(rt::to_fixed_point(-1.236f, 0.01) == -124);
+    EXPECT(std::abs(rt::from_fixed_point(123, 0.01) - 1.23f) < 1e-6f);
+
+    // Multiples beyond int64 are clamped instead of being undefined
+    auto const max = std::numeric_limits<std::int64_t>::max();
+    auto const min = std::numeric_limits<std::int64_t>::min();
+    EXPECT(rt::to_fixed_point(std::numeric_limits<float>::infinity(), 0.01) == max);
+    EXPECT(rt::to_fixed_point(-std::numeric_limits<float>::infinity(), 0.01) == min);
+    EXPECT(rt::to_fixed_point(3e38f, 1e-30) == max);
+    EXPECT(rt::to_fixed_point(-3e38f, 1e-30) == min);
+    EXPECT(rt::to_fixed_point(std::numeric_limits<float>::quiet_NaN(), 0.01) == 0);
+
+    return true;
+}
+
+// Compares the size and speed of quantized player updates with updates at full precision
+DEF_TIMED_TEST(quantize_player_update, quantize)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto bodies = make_bodies(1 << 18);
+    std::vector<std::uint8_t> buffer(bodies.size() * sizeof(player_update_body));
+    std::vector<player_update_body> decoded(bodies.size());
+
+    auto start = clock::now();
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+        std::memcpy(buffer.data() + i * sizeof(player_update_body), &bodies[i], sizeof(player_update_body));
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+        std::memcpy(&decoded[i], buffer.data() + i * sizeof(player_update_body), sizeof(player_update_body));
+    std::chrono::duration<double, std::nano> full_time = clock::now() - start;
+
+    // Every message is packed on its own, so that messages stay independently decodable
+    start = clock::now();
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        rt::bit_writer writer{buffer.data() + i * quantized_size};
+        encode(writer, bodies[i]);
+        writer.finish();
+    }
+    std::chrono::duration<double, std::nano> encode_time = clock::now() - start;
+
+    start = clock::now();
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        auto* in = buffer.data() + i * quantized_size;
+        rt::bit_reader reader{in, in + quantized_size};
+        decode(reader, decoded[i]);
+    }
+    std::chrono::duration<double, std::nano> decode_time = clock::now() - start;
+
+    std::cout << fmt::format("full precision: {} bytes, {:.2f} ns/message; quantized: {} bytes ({} saved), "
+                             "encode {:.2f} ns/message, decode {:.2f} ns/message",
+                             sizeof(player_update_body), full_time.count() / bodies.size(), quantized_size,
+                             sizeof(player_update_body) - quantized_size, encode_time.count() / bodies.size(),
+                             decode_time.count() / bodies.size())
+              << std::endl;
+}
@@ -0,0 +1,236 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/ring_buffer.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // A message whose generated type has a fixed size
+    struct position_update
+    {
+        std::uint32_t entity;
+        std::uint32_t sequence;
+        float x;
+        float y;
+        float z;
+
+        static constexpr std::size_t fixed_size = 20;
+    };
+
+    constexpr std::uint32_t message_count = 1 << 20;
+
+    // Runs producers that push message_count messages in total and a consumer that pops them and checks that every
+    // producer's messages arrive in order. Returns the time it took in nanoseconds per message
+    template <typename Push, typename Pop> double transfer(int producers, Push&& push, Pop&& pop, bool& out_ordered)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int producer = 0; producer < producers; ++producer)
+        {
+            threads.emplace_back([&, producer] {
+                for (std::uint32_t sequence = 0; sequence < message_count / producers; ++sequence)
+                {
+                    position_update update{static_cast<std::uint32_t>(producer), sequence, 1.0f, 2.0f, 3.0f};
+                    while (!push(update))
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        std::vector<std::uint32_t> next(producers, 0);
+        out_ordered = true;
+        for (std::uint32_t received = 0; received < message_count / producers * producers;)
+        {
+            position_update update;
+            if (!pop(update))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            out_ordered = out_ordered && update.sequence == next[update.entity]++;
+            ++received;
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+        return time.count() / message_count;
+    }
+}
+
+// Queues have to report full and empty and keep the order of their values
+DEF_TEST(ring_buffer_single_thread, ring_buffer)
+{
+    auto spsc = std::make_unique<rt::spsc_queue<int, 4>>();
+    for (int i = 0; i < 4; ++i)
+        EXPECT(spsc->try_push(i));
+    EXPECT(!spsc->try_push(4));
+
+    int value;
+    for (int i = 0; i < 4; ++i)
+        EXPECT(spsc->try_pop(value) && value == i);
+    EXPECT(!spsc->try_pop(value));
+
+    auto mpsc = std::make_unique<rt::mpsc_queue<int, 4>>();
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 4; ++i)
+            EXPECT(mpsc->try_push(i));
+        EXPECT(!mpsc->try_push(4));
+
+        for (int i = 0; i < 4; ++i)
+            EXPECT(mpsc->try_pop(value) && value == i);
+        EXPECT(!mpsc->try_pop(value));
+    }
+
+    return true;
+}
+
+// Frames of different sizes have to survive wrapping around the end of the ring
+DEF_TEST(ring_buffer_frames, ring_buffer)
+{
+    auto frames = std::make_unique<rt::spsc_frame_queue<64>>();
+    EXPECT(!frames->try_push(std::vector<std::uint8_t>(rt::spsc_frame_queue<64>::max_frame_size + 1)));
+
+    for (std::uint8_t size = 0; size < 28; ++size)
+    {
+        std::vector<std::uint8_t> frame(size, size);
+        EXPECT(frames->try_push(frame));
+
+        std::vector<std::uint8_t> popped;
+        EXPECT(frames->try_pop([&](auto bytes) { popped.assign(bytes.begin(), bytes.end()); }));
+        EXPECT(popped == frame);
+    }
+
+    std::vector<std::uint8_t> frame(20);
+    int pushed = 0;
+    while (frames->try_push(frame))
+        ++pushed;
+    EXPECT(pushed == 2);
+
+    return true;
+}
+
+// Messages of several producers have to arrive in the order of each producer
+DEF_TEST(ring_buffer_threads, ring_buffer)
+{
+    bool ordered;
+    auto spsc = std::make_unique<rt::spsc_queue<position_update, 1024>>();
+    transfer(
+        1, [&](auto& update) { return spsc->try_push(update); }, [&](auto& update) { return spsc->try_pop(update); },
+        ordered);
+    EXPECT(ordered);
+
+    auto mpsc = std::make_unique<rt::mpsc_queue<position_update, 1024>>();
+    transfer(
+        4, [&](auto& update) { return mpsc->try_push(update); }, [&](auto& update) { return mpsc->try_pop(update); },
+        ordered);
+    EXPECT(ordered);
+
+    return true;
+}
+
+// Compares the queues with a mutex guarded deque across threads, and measures the round trip latency of a ping pong
+DEF_TIMED_TEST(ring_buffer_throughput, ring_buffer)
+{
+    bool ordered;
+
+    std::mutex mutex;
+    std::deque<position_update> deque;
+    auto deque_time = transfer(
+        1,
+        [&](auto& update) {
+            std::lock_guard lock{mutex};
+            deque.push_back(update);
+            return true;
+        },
+        [&](auto& update) {
+            std::lock_guard lock{mutex};
+            if (deque.empty())
+                return false;
+            update = deque.front();
+            deque.pop_front();
+            return true;
+        },
+        ordered);
+
+    auto spsc = std::make_unique<rt::spsc_queue<position_update, 4096>>();
+    auto spsc_time = transfer(
+        1, [&](auto& update) { return spsc->try_push(update); }, [&](auto& update) { return spsc->try_pop(update); },
+        ordered);
+
+    auto mpsc = std::make_unique<rt::mpsc_queue<position_update, 4096>>();
+    auto mpsc_time = transfer(
+        1, [&](auto& update) { return mpsc->try_push(update); }, [&](auto& update) { return mpsc->try_pop(update); },
+        ordered);
+
+    auto frames = std::make_unique<rt::spsc_frame_queue<1 << 16>>();
+    auto frame_time = transfer(
+        1,
+        [&](auto& update) {
+            return frames->try_push({reinterpret_cast<std::uint8_t const*>(&update), sizeof(update)});
+        },
+        [&](auto& update) {
+            return frames->try_pop([&](auto bytes) { std::memcpy(&update, bytes.data(), bytes.size()); });
+        },
+        ordered);
+
+    // Ping pong between two threads through a pair of queues
+    constexpr int round_trips = 10000;
+    auto pings = std::make_unique<rt::spsc_queue<int, 64>>();
+    auto pongs = std::make_unique<rt::spsc_queue<int, 64>>();
+    std::thread echo{[&] {
+        for (int i = 0, value; i < round_trips; ++i)
+        {
+            while (!pings->try_pop(value))
+                std::this_thread::yield();
+            pongs->try_push(value);
+        }
+    }};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0, value; i < round_trips; ++i)
+    {
+        pings->try_push(i);
+        while (!pongs->try_pop(value))
+            std::this_thread::yield();
+    }
+    std::chrono::duration<double, std::nano> round_trip_time = std::chrono::steady_clock::now() - start;
+    echo.join();
+
+    std::cout << fmt::format("mutex deque {:.1f} ns/message, spsc {:.1f} ns/message, mpsc {:.1f} ns/message, frames "
+                             "{:.1f} ns/message, spsc round trip {:.0f} ns",
+                             deque_time, spsc_time, mpsc_time, frame_time, round_trip_time.count() / round_trips)
+              << std::endl;
+}
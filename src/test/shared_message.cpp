@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/builder.hpp>
+#include <flatmessage/runtime/shared_message.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // Encodes a world state message of the given amount of entities into out and returns its size
+    std::size_t encode_state(std::span<std::uint8_t> out, std::vector<float> const& positions)
+    {
+        rt::wire_builder builder{out, 8};
+        builder.set(0, std::uint32_t{42});
+        builder.set(4, static_cast<std::uint32_t>(positions.size()));
+        builder.append_array(std::span<float const>{positions});
+        builder.append(std::string_view{"world state"});
+        return builder.finish().size();
+    }
+}
+
+// Copies have to share the bytes and the last one has to free them
+DEF_TEST(shared_message_sharing, shared_message)
+{
+    std::uint8_t payload[]{1, 2, 3};
+    auto message = rt::shared_message::copy_of(payload);
+    EXPECT(message.bytes().size() == 3 && message.bytes()[2] == 3);
+    EXPECT(message.use_count() == 1);
+
+    {
+        auto copy = message;
+        EXPECT(copy.bytes().data() == message.bytes().data());
+        EXPECT(message.use_count() == 2);
+
+        auto moved = std::move(copy);
+        EXPECT(!copy && moved && message.use_count() == 2);
+    }
+
+    EXPECT(message.use_count() == 1);
+
+    rt::shared_message empty;
+    EXPECT(!empty && empty.bytes().empty() && empty.use_count() == 0);
+
+    auto encoded = rt::shared_message::encode(100, [](std::span<std::uint8_t> out) {
+        out[0] = 7;
+        return std::size_t{1};
+    });
+    EXPECT(encoded.bytes().size() == 1 && encoded.bytes()[0] == 7);
+
+    return true;
+}
+
+// Threads that copy and drop the same message concurrently must leave a consistent count behind
+DEF_TEST(shared_message_threads, shared_message)
+{
+    std::vector<float> positions(64, 1.0f);
+    auto message = rt::shared_message::encode(1024, [&](auto out) { return encode_state(out, positions); });
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([message] {
+            std::vector<rt::shared_message> copies;
+            for (int n = 0; n < 10000; ++n)
+            {
+                copies.push_back(message);
+                if (copies.size() > 16)
+                    copies.clear();
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT(message.use_count() == 1);
+
+    return true;
+}
+
+// Compares encoding a broadcast message once per recipient with encoding it once and sharing it
+DEF_TIMED_TEST(shared_message_broadcast, shared_message)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr int recipients = 500;
+    constexpr int ticks = 100;
+
+    std::vector<float> positions(256, 1.0f);
+    std::size_t checksum = 0;
+
+    std::vector<std::vector<std::uint8_t>> outboxes(recipients);
+    auto start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        for (auto& outbox : outboxes)
+        {
+            outbox.resize(2048);
+            outbox.resize(encode_state(outbox, positions));
+            checksum += outbox.size();
+        }
+    }
+    std::chrono::duration<double, std::micro> encode_time = clock::now() - start;
+
+    std::vector<rt::shared_message> shared_outboxes(recipients);
+    start = clock::now();
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        auto message = rt::shared_message::encode(2048, [&](auto out) { return encode_state(out, positions); });
+        for (auto& outbox : shared_outboxes)
+        {
+            outbox = message;
+            checksum += outbox.bytes().size();
+        }
+    }
+    std::chrono::duration<double, std::micro> shared_time = clock::now() - start;
+
+    std::cout << fmt::format("{} recipients: encode per recipient {:.1f} us/tick, encode once and share {:.1f} "
+                             "us/tick ({})",
+                             recipients, encode_time.count() / ticks, shared_time.count() / ticks, checksum)
+              << std::endl;
+}
@@ -0,0 +1,194 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/encoded_size.hpp>
+#include <flatmessage/runtime/soa.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    enum class team : std::uint8_t
+    {
+        red = 1,
+        blue = 2,
+    };
+
+    // What the generator emits for data of required numbers and enums
+    struct unit
+    {
+        std::uint32_t id;
+        team side;
+        float x;
+        float y;
+    };
+
+    // What the generator emits for a '[soa] repeated unit' attribute
+    using units = rt::soa_vector<unit, &unit::id, &unit::side, &unit::x, &unit::y>;
+
+    static_assert(sizeof(units) == sizeof(std::vector<unit>));
+
+    unit make_unit(std::size_t i)
+    {
+        return {static_cast<std::uint32_t>(i), i % 2 ? team::red : team::blue, static_cast<float>(i),
+                static_cast<float>(i) * 0.5f};
+    }
+
+    bool operator==(unit const& lhs, unit const& rhs)
+    {
+        return lhs.id == rhs.id && lhs.side == rhs.side && lhs.x == rhs.x && lhs.y == rhs.y;
+    }
+}
+
+// The container has to behave like the std::vector of rows it replaces while storing every attribute in a column
+DEF_TEST(soa_facade, soa)
+{
+    units values;
+    EXPECT(values.empty() && values.column<&unit::x>().empty());
+
+    for (std::size_t i = 0; i < 100; ++i)
+        values.push_back(make_unit(i));
+
+    EXPECT(values.size() == 100 && values[42] == make_unit(42) && values.back() == make_unit(99));
+
+    values[7] = make_unit(1000);
+    values[8].get<&unit::y>() = 3.0f;
+    EXPECT(values[7] == make_unit(1000) && values[8].get<&unit::y>() == 3.0f);
+
+    auto x = values.column<&unit::x>();
+    EXPECT(x.size() == 100 && x[9] == 9.0f && &x[1] == &x[0] + 1);
+    EXPECT(reinterpret_cast<std::uintptr_t>(x.data()) % units::column_alignment == 0);
+
+    // Every odd unit is red, but unit 7 has been replaced by unit 1000
+    std::size_t count = 0;
+    for (unit value : values)
+        count += value.side == team::red;
+    EXPECT(count == 49);
+
+    // Assigning one element to another copies it
+    values[0] = values[1];
+    EXPECT(values[0] == make_unit(1) && values[1] == make_unit(1));
+
+    auto copy = values;
+    EXPECT(copy == values && copy.column<&unit::id>().data() != values.column<&unit::id>().data());
+
+    copy.resize(120);
+    EXPECT(copy.size() == 120 && copy[110] == unit{} && copy[99] == make_unit(99));
+
+    auto moved = std::move(copy);
+    EXPECT(moved.size() == 120 && copy.empty());
+
+    return true;
+}
+
+// Encoding writes the count followed by the columns, which have to decode into the same values
+DEF_TEST(soa_encode_decode, soa)
+{
+    units values;
+    for (std::size_t i = 0; i < 10; ++i)
+        values.push_back(make_unit(i));
+
+    std::vector<std::uint8_t> buffer(rt::encoded_size(values));
+    EXPECT(buffer.size() == 4 + 10 * 13);
+    EXPECT(rt::encode_columns(values, buffer.data()) == buffer.size());
+
+    // The first id column follows the count, the side column follows all ids
+    EXPECT(buffer[0] == 10 && buffer[4] == 0 && buffer[8] == 1 && buffer[4 + 40] == static_cast<int>(team::blue));
+
+    units decoded;
+    EXPECT(rt::decode_columns(buffer.data(), buffer.data() + buffer.size(), decoded) == buffer.size());
+    EXPECT(decoded == values);
+
+    EXPECT(rt::decode_columns(buffer.data(), buffer.data() + buffer.size() - 1, decoded) == 0);
+
+    buffer[3] = 0xff;
+    EXPECT(rt::decode_columns(buffer.data(), buffer.data() + buffer.size(), decoded) == 0);
+
+    return true;
+}
+
+// Compares moving every unit and encoding all of them as array of structs against structure of arrays
+DEF_TIMED_TEST(soa_versus_aos, soa)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr std::size_t count = 100000;
+    constexpr int frames = 100;
+
+    std::vector<unit> aos;
+    units soa;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        aos.push_back(make_unit(i));
+        soa.push_back(make_unit(i));
+    }
+
+    auto start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (auto& value : aos)
+            value.x += value.y * 0.01f;
+    }
+    std::chrono::duration<double, std::nano> aos_update = clock::now() - start;
+
+    start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        auto x = soa.column<&unit::x>();
+        auto y = soa.column<&unit::y>();
+        for (std::size_t i = 0; i < x.size(); ++i)
+            x[i] += y[i] * 0.01f;
+    }
+    std::chrono::duration<double, std::nano> soa_update = clock::now() - start;
+
+    // Without columns every attribute of every row is written on its own
+    std::vector<std::uint8_t> buffer(rt::encoded_size(soa));
+    start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        auto* out = buffer.data() + 4;
+        for (auto const& value : aos)
+        {
+            std::memcpy(out, &value.id, 4);
+            std::memcpy(out + 4, &value.side, 1);
+            std::memcpy(out + 5, &value.x, 4);
+            std::memcpy(out + 9, &value.y, 4);
+            out += 13;
+        }
+    }
+    std::chrono::duration<double, std::nano> aos_encode = clock::now() - start;
+
+    start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+        rt::encode_columns(soa, buffer.data());
+    std::chrono::duration<double, std::nano> soa_encode = clock::now() - start;
+
+    constexpr auto rows = static_cast<double>(count * frames);
+    std::cout << fmt::format("update: aos {:.2f} ns/row, soa {:.2f} ns/row; encode: aos {:.2f} ns/row, soa {:.2f} "
+                             "ns/row ({})",
+                             aos_update.count() / rows, soa_update.count() / rows, aos_encode.count() / rows,
+                             soa_encode.count() / rows, aos[count - 1].x - soa.back().x + buffer[5])
+              << std::endl;
+}
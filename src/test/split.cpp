@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/cold_block.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // An entity as it is generated without [split]: the per frame attributes share their cache lines with everything
+    // else
+    struct flat_entity
+    {
+        std::string name;
+        std::string description;
+        std::vector<std::uint32_t> inventory;
+        std::array<std::uint64_t, 16> statistics{};
+        float x{};
+        float y{};
+        float velocity_x{};
+        float velocity_y{};
+    };
+
+    // The same entity as it is generated with [split] and the four per frame attributes marked as [hot]
+    struct split_entity
+    {
+        struct hot_fields
+        {
+            float x{};
+            float y{};
+            float velocity_x{};
+            float velocity_y{};
+        };
+
+        struct cold_fields
+        {
+            std::string name;
+            std::string description;
+            std::vector<std::uint32_t> inventory;
+            std::array<std::uint64_t, 16> statistics{};
+        };
+
+        float& x() { return hot.x; }
+        float const& x() const { return hot.x; }
+        std::string& name() { return cold.get().name; }
+        std::string const& name() const { return cold.get().name; }
+
+        hot_fields hot;
+        rt::cold_block<cold_fields> cold;
+    };
+}
+
+// Reading never allocates the block, writing allocates it once and copies are deep
+DEF_TEST(cold_block_allocation, split)
+{
+    split_entity entity;
+    auto const& view = entity;
+    EXPECT(view.name().empty() && !entity.cold.is_allocated());
+
+    entity.name() = "player";
+    EXPECT(entity.cold.is_allocated() && view.name() == "player");
+
+    auto copy = entity;
+    copy.name() = "copy";
+    EXPECT(entity.name() == "player" && copy.name() == "copy");
+
+    split_entity assigned;
+    assigned = copy;
+    EXPECT(assigned.name() == "copy" && &assigned.cold.get() != &copy.cold.get());
+
+    auto moved = std::move(copy);
+    EXPECT(moved.name() == "copy" && !copy.cold.is_allocated());
+
+    entity.cold.reset();
+    EXPECT(!entity.cold.is_allocated() && view.name().empty());
+
+    return true;
+}
+
+// A block that was never written copies without allocating
+DEF_TEST(cold_block_copy_unallocated, split)
+{
+    split_entity entity;
+    entity.x() = 1.0f;
+
+    auto copy = entity;
+    EXPECT(copy.x() == 1.0f && !copy.cold.is_allocated());
+
+    return true;
+}
+
+// Compares a per frame update of the hot attributes of flat entities against split ones
+DEF_TIMED_TEST(split_versus_flat, split)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr std::size_t count = 100000;
+    constexpr int frames = 20;
+
+    std::vector<flat_entity> flat(count);
+    std::vector<split_entity> split(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        flat[i].velocity_x = split[i].hot.velocity_x = static_cast<float>(i % 7);
+        flat[i].velocity_y = split[i].hot.velocity_y = static_cast<float>(i % 5);
+        flat[i].name = split[i].cold->name = fmt::format("entity {}", i);
+    }
+
+    auto start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (auto& entity : flat)
+        {
+            entity.x += entity.velocity_x;
+            entity.y += entity.velocity_y;
+        }
+    }
+    std::chrono::duration<double, std::nano> flat_time = clock::now() - start;
+
+    start = clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (auto& entity : split)
+        {
+            entity.hot.x += entity.hot.velocity_x;
+            entity.hot.y += entity.hot.velocity_y;
+        }
+    }
+    std::chrono::duration<double, std::nano> split_time = clock::now() - start;
+
+    float checksum = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        checksum += flat[i].x - split[i].hot.x;
+
+    constexpr auto updates = static_cast<double>(count * frames);
+    std::cout << fmt::format("flat {} bytes {:.2f} ns/entity, split {} bytes {:.2f} ns/entity ({})",
+                             sizeof(flat_entity), flat_time.count() / updates, sizeof(split_entity),
+                             split_time.count() / updates, checksum)
+              << std::endl;
+}
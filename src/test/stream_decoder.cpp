@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/stream_decoder.hpp>
+#include <flatmessage/runtime/view.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // Returns a stream of frames that each contain a single string of the given texts
+    std::vector<std::uint8_t> make_stream(std::vector<std::string> const& texts)
+    {
+        std::vector<std::uint8_t> stream;
+        for (auto& text : texts)
+        {
+            auto offset = stream.size();
+            stream.resize(offset + 2 * rt::FRAME_HEADER_SIZE + text.size());
+            rt::write_frame_header(static_cast<std::uint32_t>(rt::FRAME_HEADER_SIZE + text.size()), &stream[offset]);
+            rt::write_frame_header(static_cast<std::uint32_t>(text.size()), &stream[offset + rt::FRAME_HEADER_SIZE]);
+            auto const content = offset + 2 * rt::FRAME_HEADER_SIZE;
+            std::copy(text.begin(), text.end(), stream.begin() + static_cast<std::ptrdiff_t>(content));
+        }
+
+        return stream;
+    }
+
+    // Feeds the given stream in chunks of chunk_size bytes and returns the texts of the decoded frames
+    std::vector<std::string> decode_in_chunks(rt::stream_decoder& decoder, std::vector<std::uint8_t> const& stream,
+                                              std::size_t chunk_size, std::size_t& out_borrowed)
+    {
+        std::vector<std::string> texts;
+        for (std::size_t offset = 0; offset < stream.size(); offset += chunk_size)
+        {
+            std::span<std::uint8_t const> chunk{stream.data() + offset, std::min(chunk_size, stream.size() - offset)};
+            decoder.feed(chunk, [&](std::span<std::uint8_t const> frame) {
+                if (frame.data() >= chunk.data() && frame.data() < chunk.data() + chunk.size())
+                    ++out_borrowed;
+
+                rt::view_reader reader{frame.data(), frame.data() + frame.size()};
+                texts.emplace_back(reader.read_string());
+            });
+        }
+
+        return texts;
+    }
+}
+
+// Frames have to be reassembled no matter where the chunk boundaries fall
+DEF_TEST(stream_decoder_chunk_boundaries, stream_decoder)
+{
+    std::vector<std::string> texts{"hello", "", "a longer frame that spans several small chunks", "x"};
+    auto stream = make_stream(texts);
+
+    for (std::size_t chunk_size = 1; chunk_size <= stream.size(); ++chunk_size)
+    {
+        rt::stream_decoder decoder;
+        std::size_t borrowed = 0;
+        EXPECT(decode_in_chunks(decoder, stream, chunk_size, borrowed) == texts);
+        EXPECT(decoder.buffered() == 0);
+    }
+
+    return true;
+}
+
+// Frames that arrive in one piece must not be copied
+DEF_TEST(stream_decoder_zero_copy, stream_decoder)
+{
+    std::vector<std::string> texts(100, "some payload");
+    auto stream = make_stream(texts);
+
+    rt::stream_decoder decoder;
+    std::size_t borrowed = 0;
+    EXPECT(decode_in_chunks(decoder, stream, stream.size(), borrowed) == texts);
+    EXPECT(borrowed == texts.size());
+
+    // With chunks of 1000 bytes only the frames that straddle a boundary are assembled
+    borrowed = 0;
+    EXPECT(decode_in_chunks(decoder, stream, 1000, borrowed) == texts);
+    EXPECT(borrowed >= texts.size() - stream.size() / 1000 - 1);
+
+    return true;
+}
+
+// A frame that is larger than allowed marks the stream as corrupt until the decoder is reset
+DEF_TEST(stream_decoder_oversized_frame, stream_decoder)
+{
+    rt::stream_decoder decoder{16};
+    auto stream = make_stream({"this text is longer than sixteen bytes"});
+
+    int frames = 0;
+    auto count = [&](std::span<std::uint8_t const>) { ++frames; };
+    EXPECT(!decoder.feed(stream, count));
+    EXPECT(!decoder.feed(make_stream({"ok"}), count));
+    EXPECT(frames == 0);
+
+    decoder.reset();
+    EXPECT(decoder.feed(make_stream({"ok"}), count));
+    EXPECT(frames == 1);
+
+    return true;
+}
+
+// Measures the throughput of the decoder when reads deliver typical TCP segment sizes
+DEF_TIMED_TEST(stream_decoder_throughput, stream_decoder)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::vector<std::string> texts;
+    for (int i = 0; i < 100000; ++i)
+        texts.push_back(fmt::format("player {} moved somewhere", i));
+    auto stream = make_stream(texts);
+
+    for (std::size_t chunk_size : {std::size_t{1460}, std::size_t{65536}})
+    {
+        rt::stream_decoder decoder;
+        std::size_t borrowed = 0;
+
+        auto start = clock::now();
+        auto decoded = decode_in_chunks(decoder, stream, chunk_size, borrowed);
+        std::chrono::duration<double, std::nano> time = clock::now() - start;
+
+        std::cout << fmt::format("chunks of {} bytes: {:.1f} ns/frame, {:.2f}% of frames copied", chunk_size,
+                                 time.count() / decoded.size(), 100.0 - 100.0 * borrowed / decoded.size())
+                  << std::endl;
+    }
+}
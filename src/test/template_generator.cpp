@@ -39,8 +39,8 @@ auto template_generate = [](std::string const& source, fs::path inputPath) {
         flatmessage::generator::template_generator generator((path / fileName).string());
         std::stringstream out;
 
-        std::unordered_set<std::string> exported_stuff;
-        generator.generate(out, *ast, exported_stuff, exported_stuff);
+        flatmessage::symbol_table symbols;
+        generator.generate(out, *ast, symbols);
         return out.str();
     }
 
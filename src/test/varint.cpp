@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/varint.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    // Returns count values that resemble the content of typical messages: mostly small counters and ids, some medium
+    // sized values and a few that need the full width
+    std::vector<std::uint32_t> make_realistic_values(std::size_t count)
+    {
+        std::mt19937 random{42};
+        std::uniform_int_distribution<int> bucket{0, 99};
+        std::uniform_int_distribution<std::uint32_t> small{0, 127};
+        std::uniform_int_distribution<std::uint32_t> medium{128, 16383};
+        std::uniform_int_distribution<std::uint32_t> large{16384, std::numeric_limits<std::uint32_t>::max()};
+
+        std::vector<std::uint32_t> values(count);
+        for (auto& value : values)
+        {
+            auto b = bucket(random);
+            value = b < 70 ? small(random) : b < 95 ? medium(random) : large(random);
+        }
+
+        return values;
+    }
+}
+
+// Values at every length boundary have to survive a round trip through both the word and the byte wise decoder
+DEF_TEST(varint_round_trip, varint)
+{
+    std::vector<std::uint64_t> values{0, 1, 127, 128, 16383, 16384, (1ull << 56) - 1, 1ull << 56,
+                                      std::numeric_limits<std::uint64_t>::max()};
+
+    for (auto value : values)
+    {
+        // Padding makes sure that the word wise path is taken
+        std::uint8_t buffer[rt::MAX_VARINT_SIZE + 8] = {};
+        auto size = rt::encode_varint(value, buffer);
+        EXPECT(size == rt::varint_size(value));
+
+        std::uint64_t padded = 0;
+        EXPECT(rt::decode_varint(buffer, buffer + sizeof(buffer), padded) == size);
+        EXPECT(padded == value);
+
+        std::uint64_t exact = 0;
+        EXPECT(rt::decode_varint(buffer, buffer + size, exact) == size);
+        EXPECT(exact == value);
+    }
+
+    return true;
+}
+
+// Decoding has to fail instead of reading past the end of the input
+DEF_TEST(varint_truncated, varint)
+{
+    std::uint8_t buffer[rt::MAX_VARINT_SIZE];
+    auto size = rt::encode_varint(1ull << 40, buffer);
+
+    std::uint64_t value = 0;
+    EXPECT(rt::decode_varint(buffer, buffer + size - 1, value) == 0);
+
+    std::uint8_t overlong[12];
+    std::memset(overlong, 0x80, sizeof(overlong));
+    EXPECT(rt::decode_varint(overlong, overlong + sizeof(overlong), value) == 0);
+
+    return true;
+}
+
+// A 10th byte above 1 sets bits beyond the 64th and has to be rejected instead of being truncated
+DEF_TEST(varint_overflow, varint)
+{
+    std::uint8_t buffer[rt::MAX_VARINT_SIZE + 8] = {};
+    auto size = rt::encode_varint(std::numeric_limits<std::uint64_t>::max(), buffer);
+    EXPECT(size == rt::MAX_VARINT_SIZE);
+
+    std::uint64_t value = 0;
+    buffer[rt::MAX_VARINT_SIZE - 1] = 0x02;
+    EXPECT(rt::decode_varint(buffer, buffer + sizeof(buffer), value) == 0);
+    EXPECT(rt::decode_varint(buffer, buffer + size, value) == 0);
+
+    // An overlong encoding of 1
+    std::uint8_t overlong[rt::MAX_VARINT_SIZE] = {0x81, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x7f};
+    EXPECT(rt::decode_varint(overlong, overlong + sizeof(overlong), value) == 0);
+
+    return true;
+}
+
+// Values that don't fit into the element type have to be rejected instead of being narrowed
+DEF_TEST(varint_out_of_range, varint)
+{
+    std::uint8_t buffer[rt::MAX_VARINT_SIZE * 2] = {};
+
+    auto size = rt::encode_varint(256, buffer);
+    std::uint8_t byte = 0;
+    EXPECT(rt::decode_varints(buffer, buffer + size, std::span{&byte, 1}) == 0);
+
+    std::int8_t const minus_one[] = {-1};
+    std::int64_t const wide[] = {-129};
+    size = rt::encode_varints(std::span<std::int64_t const>{wide}, buffer);
+    std::int8_t narrow = 0;
+    EXPECT(rt::decode_varints(buffer, buffer + size, std::span{&narrow, 1}) == 0);
+    size = rt::encode_varints(std::span<std::int8_t const>{minus_one}, buffer);
+    EXPECT(rt::decode_varints(buffer, buffer + size, std::span{&narrow, 1}) == size);
+    EXPECT(narrow == -1);
+
+    std::int64_t const deltas[] = {40000, -40000};
+    std::int16_t delta = 0;
+    for (auto value : deltas)
+    {
+        size = rt::encode_zigzags(std::span<std::int64_t const>{&value, 1}, buffer);
+        EXPECT(rt::decode_zigzags(buffer, buffer + size, std::span{&delta, 1}) == 0);
+    }
+
+    return true;
+}
+
+// Signed values of a small magnitude have to stay small
+DEF_TEST(varint_zigzag, varint)
+{
+    EXPECT(rt::zigzag_encode(0) == 0);
+    EXPECT(rt::zigzag_encode(-1) == 1);
+    EXPECT(rt::zigzag_encode(1) == 2);
+    EXPECT(rt::zigzag_encode(-64) == 127);
+
+    for (std::int64_t value : {std::int64_t{0}, std::int64_t{-1}, std::int64_t{63}, std::int64_t{-64},
+                               std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max()})
+        EXPECT(rt::zigzag_decode(rt::zigzag_encode(value)) == value);
+
+    return true;
+}
+
+// Repeated values mix runs of single byte values, which are decoded 8 at a time, with longer ones
+DEF_TEST(varint_repeated, varint)
+{
+    auto values = make_realistic_values(1000);
+    std::vector<std::uint8_t> buffer(values.size() * rt::MAX_VARINT_SIZE);
+    auto size = rt::encode_varints(std::span<std::uint32_t const>{values}, buffer.data());
+
+    std::vector<std::uint32_t> decoded(values.size());
+    EXPECT(rt::decode_varints(buffer.data(), buffer.data() + size, std::span{decoded}) == size);
+    EXPECT(decoded == values);
+
+    std::vector<std::int16_t> deltas{0, -1, 1, -300, 300, 5, -5, 7, -7, std::numeric_limits<std::int16_t>::min()};
+    size = rt::encode_zigzags(std::span<std::int16_t const>{deltas}, buffer.data());
+
+    std::vector<std::int16_t> decoded_deltas(deltas.size());
+    EXPECT(rt::decode_zigzags(buffer.data(), buffer.data() + size, std::span{decoded_deltas}) == size);
+    EXPECT(decoded_deltas == deltas);
+
+    return true;
+}
+
+// Compares size and speed of varints with fixed width integers on a realistic distribution of values
+DEF_TIMED_TEST(varint_versus_fixed, varint)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto values = make_realistic_values(1 << 20);
+    std::vector<std::uint8_t> buffer(values.size() * rt::MAX_VARINT_SIZE);
+    std::vector<std::uint32_t> decoded(values.size());
+
+    auto start = clock::now();
+    std::memcpy(buffer.data(), values.data(), values.size() * sizeof(std::uint32_t));
+    std::memcpy(decoded.data(), buffer.data(), values.size() * sizeof(std::uint32_t));
+    std::chrono::duration<double, std::nano> fixed_time = clock::now() - start;
+
+    start = clock::now();
+    auto varint_bytes = rt::encode_varints(std::span<std::uint32_t const>{values}, buffer.data());
+    std::chrono::duration<double, std::nano> encode_time = clock::now() - start;
+
+    start = clock::now();
+    rt::decode_varints(buffer.data(), buffer.data() + varint_bytes, std::span{decoded});
+    std::chrono::duration<double, std::nano> decode_time = clock::now() - start;
+
+    auto fixed_bytes = values.size() * sizeof(std::uint32_t);
+    std::cout << fmt::format("fixed: {} bytes, {:.2f} ns/value; varint: {} bytes ({:.1f}%), encode {:.2f} ns/value, "
+                             "decode {:.2f} ns/value",
+                             fixed_bytes, fixed_time.count() / values.size(), varint_bytes,
+                             100.0 * varint_bytes / fixed_bytes, encode_time.count() / values.size(),
+                             decode_time.count() / values.size())
+              << std::endl;
+}
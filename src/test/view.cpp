@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2016 Dennis Werner Garske (DWG)
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "fixtures.hpp"
+
+#include <testinator.h>
+
+#include <flatmessage/runtime/view.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rt = flatmessage::runtime;
+
+namespace
+{
+    using Test::Fixtures::Chat;
+    using Test::Fixtures::ChatView;
+
+    Chat make_chat(std::string text, std::vector<float> samples, std::uint32_t sender)
+    {
+        Chat message;
+        message.text = std::move(text);
+        message.samples = std::move(samples);
+        message.sender = sender;
+        return message;
+    }
+
+    std::vector<std::uint8_t> encode(Chat const& message)
+    {
+        BinaryEncoder encoder;
+        encoder << message;
+        return {encoder.bytes().begin(), encoder.bytes().end()};
+    }
+
+    ChatView decode_view(std::vector<std::uint8_t> const& buffer, bool& out_failed)
+    {
+        rt::view_reader reader{buffer.data(), buffer.data() + buffer.size()};
+
+        ChatView view;
+        view.text = reader.read_string();
+        view.samples = reader.read_repeated<float>();
+        view.sender = reader.read<std::uint32_t>();
+
+        out_failed = reader.failed();
+        return view;
+    }
+
+    Chat decode_owned(std::vector<std::uint8_t> const& buffer)
+    {
+        bool failed;
+        auto view = decode_view(buffer, failed);
+        return make_chat(rt::to_owned(view.text), rt::to_owned(view.samples), view.sender);
+    }
+}
+
+// Views have to point into the buffer they were decoded from instead of copying it
+DEF_TEST(view_borrows_buffer, view)
+{
+    auto message = make_chat("hello world", {1.5f, -2.0f, 3.25f}, 42);
+    auto buffer = encode(message);
+
+    bool failed;
+    auto view = decode_view(buffer, failed);
+    EXPECT(!failed);
+    EXPECT(view.text == "hello world");
+    EXPECT(reinterpret_cast<std::uint8_t const*>(view.text.data()) == buffer.data() + 4);
+    EXPECT(view.samples.size() == 3 && view.samples[1] == -2.0f);
+    EXPECT((std::vector<float>{view.samples.begin(), view.samples.end()} == message.samples));
+    EXPECT(view.samples.bytes().data() == buffer.data() + 4 + 11 + 4);
+    EXPECT(view.sender == 42);
+
+    auto owned = decode_owned(buffer);
+    EXPECT(owned.text == message.text && owned.samples == message.samples && owned.sender == message.sender);
+
+    // The view has to read what the generated decoder reads
+    Chat decoded;
+    BinaryDecoder decoder{buffer};
+    decoder >> decoded;
+    EXPECT(!decoder.failed() && decoder.remaining() == 0);
+    EXPECT(decoded.text == owned.text && decoded.samples == owned.samples && decoded.sender == owned.sender);
+
+    return true;
+}
+
+// Lengths beyond the end of the input must fail instead of producing views past the buffer
+DEF_TEST(view_truncated_input, view)
+{
+    auto buffer = encode(make_chat("hello", {1.0f, 2.0f}, 7));
+
+    for (std::size_t size = 0; size < buffer.size(); ++size)
+    {
+        std::vector<std::uint8_t> truncated{buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(size)};
+
+        bool failed;
+        decode_view(truncated, failed);
+        EXPECT(failed);
+    }
+
+    std::uint8_t corrupt[]{0xff, 0xff, 0xff, 0xff, 'a'};
+    rt::view_reader reader{corrupt, corrupt + sizeof(corrupt)};
+    EXPECT(reader.read_string().empty());
+    EXPECT(reader.failed());
+
+    return true;
+}
+
+// Compares decoding into owning types with decoding into views of the receive buffer
+DEF_TIMED_TEST(view_versus_owned, view)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::vector<std::vector<std::uint8_t>> buffers;
+    for (int i = 0; i < 100000; ++i)
+        buffers.push_back(encode(make_chat(fmt::format("player {} says hello to everyone", i),
+                                           std::vector<float>(32, 1.0f), static_cast<std::uint32_t>(i))));
+
+    std::size_t checksum = 0;
+    auto start = clock::now();
+    for (auto& buffer : buffers)
+        checksum += decode_owned(buffer).text.size();
+    std::chrono::duration<double, std::nano> owned_time = clock::now() - start;
+
+    start = clock::now();
+    for (auto& buffer : buffers)
+    {
+        bool failed;
+        checksum += decode_view(buffer, failed).text.size();
+    }
+    std::chrono::duration<double, std::nano> view_time = clock::now() - start;
+
+    std::cout << fmt::format("owned {:.1f} ns/message, view {:.1f} ns/message ({})",
+                             owned_time.count() / buffers.size(), view_time.count() / buffers.size(), checksum)
+              << std::endl;
+}